@@ -0,0 +1,879 @@
+/**
+ * @file adaptive_radix_tree.cpp
+ * @brief 自适应基数树（Adaptive Radix Tree，ART）索引：Node4/16/48/256 四种内部节点、路径压缩、
+ *        Node16 的 SIMD 子节点查找、有序遍历与前缀扫描，支持字符串键与整数键。
+ */
+
+// 基数树（radix tree）按键的字节逐层向下查找：第 d 层用键的第 d 个字节选择子节点，查找的代价只取决于
+// 键的长度，与树中有多少个键无关，而且按字节序遍历就得到有序的结果（std::unordered_map 做不到这一点）。
+// 普通的基数树每个节点都有 256 个子指针，绝大多数是空的，非常浪费内存。ART（Leis 等，ICDE 2013）
+// 根据子节点数目在四种节点之间自适应地切换：
+// - Node4：最多 4 个子节点，keys_ 与 children_ 两个数组按字节有序存放，线性查找；
+// - Node16：最多 16 个子节点，同样有序存放，用一条 SSE2 指令把要找的字节与 16 个键同时比较；
+// - Node48：256 字节的 child_index_ 把字节映射到 48 个子指针中的某一个；
+// - Node256：直接用字节下标访问 256 个子指针。
+// 节点满了就换成大一号的节点，删除后子节点太少就换成小一号的节点。
+// 另外两个技巧让树更矮：
+// - 路径压缩：只有一个子节点的内部节点被合并进它的子节点，被跳过的字节保存在子节点的 prefix_ 中；
+// - 惰性展开：只有一个键的子树直接用叶子表示，叶子保存完整的键，查找到叶子时再比较整个键。
+// 一个键可能是另一个键的前缀（例如 "ab" 与 "abc"），所以内部节点还有一个 value_leaf_，
+// 存放恰好在这个节点结束的键。
+// 整数键用 EncodeKey 转成大端字节序，这样字节序就等于数值大小的顺序。
+// 与 unordered_maps.cpp 和 maps.cpp 中的容器一样，对外提供 insert / find / erase，另外提供
+// for_each（按键的顺序遍历）与 scan_prefix（遍历以某个前缀开头的所有键）。
+
+// 包含 mallinfo2（用于统计堆内存的使用量）。
+#include <malloc.h>
+
+#if defined(__SSE2__)
+// 包含 SSE2 指令（_mm_cmpeq_epi8 等）。
+#include <emmintrin.h>
+#endif
+
+// 包含 std::shuffle。
+#include <algorithm>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 std::exit。
+#include <cstdlib>
+// 包含 std::memcmp。
+#include <cstring>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::map。
+#include <map>
+// 包含 std::mt19937_64（用于生成随机键）。
+#include <random>
+// 包含 std::string。
+#include <string>
+// 包含 std::string_view。
+#include <string_view>
+// 包含 std::unordered_map。
+#include <unordered_map>
+// 包含 std::move。
+#include <utility>
+// 包含 std::vector。
+#include <vector>
+
+template <typename V>
+class AdaptiveRadixTree {
+ public:
+  AdaptiveRadixTree() = default;
+  ~AdaptiveRadixTree() { Free(root_); }
+
+  AdaptiveRadixTree(const AdaptiveRadixTree &) = delete;
+  AdaptiveRadixTree &operator=(const AdaptiveRadixTree &) = delete;
+
+  // 插入一个键值对。键已经存在时不修改，返回 false。
+  bool insert(std::string_view key, V value) {
+    bool inserted = Insert(&root_, key, 0, std::move(value));
+    size_ += inserted;
+    return inserted;
+  }
+
+  // 返回键对应的值，不存在时返回 nullptr。
+  V *find(std::string_view key) const {
+    Node *node = root_;
+    size_t depth = 0;
+    while (node != nullptr) {
+      if (node->type_ == NodeType::kLeaf) {
+        auto *leaf = static_cast<Leaf *>(node);
+        return leaf->key_ == key ? &leaf->value_ : nullptr;
+      }
+      auto *inner = static_cast<Inner *>(node);
+      if (MatchPrefix(inner, key, depth) != inner->prefix_.size()) {
+        return nullptr;
+      }
+      depth += inner->prefix_.size();
+      if (depth == key.size()) {
+        return inner->value_leaf_ == nullptr ? nullptr : &inner->value_leaf_->value_;
+      }
+      Node **child = FindChild(inner, static_cast<uint8_t>(key[depth]));
+      node = child == nullptr ? nullptr : *child;
+      depth++;
+    }
+    return nullptr;
+  }
+
+  // 删除一个键，返回是否删除了。
+  bool erase(std::string_view key) {
+    bool erased = Erase(&root_, key, 0);
+    size_ -= erased;
+    return erased;
+  }
+
+  size_t size() const { return size_; }
+
+  // 按键的字节序（与 std::map<std::string> 的顺序相同）对每个键值对调用 fn(key, value)。
+  template <typename Fn>
+  void for_each(Fn &&fn) const {
+    Visit(root_, fn);
+  }
+
+  // 对所有以 prefix 开头的键调用 fn(key, value)，同样按顺序。
+  template <typename Fn>
+  void scan_prefix(std::string_view prefix, Fn &&fn) const {
+    Node *node = root_;
+    size_t depth = 0;
+    while (node != nullptr) {
+      if (node->type_ == NodeType::kLeaf) {
+        auto *leaf = static_cast<Leaf *>(node);
+        if (std::string_view(leaf->key_).substr(0, prefix.size()) == prefix) {
+          fn(std::string_view(leaf->key_), leaf->value_);
+        }
+        return;
+      }
+      auto *inner = static_cast<Inner *>(node);
+      size_t matched = MatchPrefix(inner, prefix, depth);
+      if (depth + matched == prefix.size()) {
+        // 查询的前缀在这个节点的压缩路径内（或恰好在这里）结束：整棵子树都匹配。
+        Visit(node, fn);
+        return;
+      }
+      if (matched != inner->prefix_.size()) {
+        return;
+      }
+      depth += matched;
+      Node **child = FindChild(inner, static_cast<uint8_t>(prefix[depth]));
+      node = child == nullptr ? nullptr : *child;
+      depth++;
+    }
+  }
+
+  // 各种节点的数目，用于演示节点类型的自适应。
+  struct NodeCounts {
+    size_t leaves_{0};
+    size_t node4_{0};
+    size_t node16_{0};
+    size_t node48_{0};
+    size_t node256_{0};
+  };
+
+  NodeCounts CountNodes() const {
+    NodeCounts counts;
+    Count(root_, &counts);
+    return counts;
+  }
+
+ private:
+  enum class NodeType : uint8_t { kLeaf, kNode4, kNode16, kNode48, kNode256 };
+
+  struct Node {
+    explicit Node(NodeType type) : type_(type) {}
+    NodeType type_;
+  };
+
+  struct Leaf : Node {
+    Leaf(std::string_view key, V value) : Node(NodeType::kLeaf), key_(key), value_(std::move(value)) {}
+    std::string key_;
+    V value_;
+  };
+
+  struct Inner : Node {
+    explicit Inner(NodeType type) : Node(type) {}
+    uint16_t num_children_{0};
+    // 被路径压缩跳过的字节。
+    std::string prefix_;
+    // 恰好在这个节点结束的键。
+    Leaf *value_leaf_{nullptr};
+  };
+
+  struct Node4 : Inner {
+    Node4() : Inner(NodeType::kNode4) {}
+    uint8_t keys_[4];
+    Node *children_[4];
+  };
+
+  struct Node16 : Inner {
+    Node16() : Inner(NodeType::kNode16) {}
+    uint8_t keys_[16];
+    Node *children_[16];
+  };
+
+  struct Node48 : Inner {
+    Node48() : Inner(NodeType::kNode48) {}
+    // child_index_[b] 为 0 表示没有字节 b 对应的子节点，否则子节点是 children_[child_index_[b] - 1]。
+    uint8_t child_index_[256] = {};
+    Node *children_[48] = {};
+  };
+
+  struct Node256 : Inner {
+    Node256() : Inner(NodeType::kNode256) {}
+    Node *children_[256] = {};
+  };
+
+  static void Free(Node *node) {
+    if (node == nullptr) {
+      return;
+    }
+    if (node->type_ == NodeType::kLeaf) {
+      delete static_cast<Leaf *>(node);
+      return;
+    }
+    auto *inner = static_cast<Inner *>(node);
+    delete inner->value_leaf_;
+    ForEachChild(inner, [](uint8_t, Node *child) { Free(child); });
+    DeleteInner(inner);
+  }
+
+  static void DeleteInner(Inner *inner) {
+    switch (inner->type_) {
+      case NodeType::kNode4:
+        delete static_cast<Node4 *>(inner);
+        break;
+      case NodeType::kNode16:
+        delete static_cast<Node16 *>(inner);
+        break;
+      case NodeType::kNode48:
+        delete static_cast<Node48 *>(inner);
+        break;
+      case NodeType::kNode256:
+        delete static_cast<Node256 *>(inner);
+        break;
+      case NodeType::kLeaf:
+        break;
+    }
+  }
+
+  // 按字节从小到大对每个子节点调用 fn(byte, child)。
+  template <typename Fn>
+  static void ForEachChild(Inner *inner, Fn &&fn) {
+    switch (inner->type_) {
+      case NodeType::kNode4: {
+        auto *n = static_cast<Node4 *>(inner);
+        for (int i = 0; i < n->num_children_; i++) {
+          fn(n->keys_[i], n->children_[i]);
+        }
+        break;
+      }
+      case NodeType::kNode16: {
+        auto *n = static_cast<Node16 *>(inner);
+        for (int i = 0; i < n->num_children_; i++) {
+          fn(n->keys_[i], n->children_[i]);
+        }
+        break;
+      }
+      case NodeType::kNode48: {
+        auto *n = static_cast<Node48 *>(inner);
+        for (int b = 0; b < 256; b++) {
+          if (n->child_index_[b] != 0) {
+            fn(static_cast<uint8_t>(b), n->children_[n->child_index_[b] - 1]);
+          }
+        }
+        break;
+      }
+      case NodeType::kNode256: {
+        auto *n = static_cast<Node256 *>(inner);
+        for (int b = 0; b < 256; b++) {
+          if (n->children_[b] != nullptr) {
+            fn(static_cast<uint8_t>(b), n->children_[b]);
+          }
+        }
+        break;
+      }
+      case NodeType::kLeaf:
+        break;
+    }
+  }
+
+  // 返回 inner->prefix_ 与 key[depth..] 共同前缀的长度。
+  static size_t MatchPrefix(const Inner *inner, std::string_view key, size_t depth) {
+    size_t limit = std::min(inner->prefix_.size(), key.size() - depth);
+    size_t i = 0;
+    while (i < limit && inner->prefix_[i] == key[depth + i]) {
+      i++;
+    }
+    return i;
+  }
+
+  // 返回存放字节 b 对应子节点的槽位，没有时返回 nullptr。
+  static Node **FindChild(Inner *inner, uint8_t b) {
+    switch (inner->type_) {
+      case NodeType::kNode4: {
+        auto *n = static_cast<Node4 *>(inner);
+        for (int i = 0; i < n->num_children_; i++) {
+          if (n->keys_[i] == b) {
+            return &n->children_[i];
+          }
+        }
+        return nullptr;
+      }
+      case NodeType::kNode16: {
+        auto *n = static_cast<Node16 *>(inner);
+#if defined(__SSE2__)
+        // 16 个键同时与 b 比较，得到一个 16 位的掩码；只保留前 num_children_ 位。
+        __m128i matches =
+            _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(b)), _mm_loadu_si128(reinterpret_cast<__m128i *>(n->keys_)));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(matches)) & ((1U << n->num_children_) - 1);
+        return mask == 0 ? nullptr : &n->children_[__builtin_ctz(mask)];
+#else
+        for (int i = 0; i < n->num_children_; i++) {
+          if (n->keys_[i] == b) {
+            return &n->children_[i];
+          }
+        }
+        return nullptr;
+#endif
+      }
+      case NodeType::kNode48: {
+        auto *n = static_cast<Node48 *>(inner);
+        return n->child_index_[b] == 0 ? nullptr : &n->children_[n->child_index_[b] - 1];
+      }
+      case NodeType::kNode256: {
+        auto *n = static_cast<Node256 *>(inner);
+        return n->children_[b] == nullptr ? nullptr : &n->children_[b];
+      }
+      case NodeType::kLeaf:
+        break;
+    }
+    return nullptr;
+  }
+
+  static void MoveHeader(Inner *to, Inner *from) {
+    to->num_children_ = from->num_children_;
+    to->prefix_ = std::move(from->prefix_);
+    to->value_leaf_ = from->value_leaf_;
+  }
+
+  // 在有序的 keys_/children_ 数组中插入一个子节点（Node4 与 Node16）。
+  template <typename N>
+  static void InsertSorted(N *n, uint8_t b, Node *child) {
+    int pos = 0;
+    while (pos < n->num_children_ && n->keys_[pos] < b) {
+      pos++;
+    }
+    for (int i = n->num_children_; i > pos; i--) {
+      n->keys_[i] = n->keys_[i - 1];
+      n->children_[i] = n->children_[i - 1];
+    }
+    n->keys_[pos] = b;
+    n->children_[pos] = child;
+    n->num_children_++;
+  }
+
+  template <typename N>
+  static void RemoveSorted(N *n, uint8_t b) {
+    int pos = 0;
+    while (n->keys_[pos] != b) {
+      pos++;
+    }
+    for (int i = pos; i + 1 < n->num_children_; i++) {
+      n->keys_[i] = n->keys_[i + 1];
+      n->children_[i] = n->children_[i + 1];
+    }
+    n->num_children_--;
+  }
+
+  // 给 *ref 指向的内部节点加一个子节点，节点满了就换成大一号的节点（*ref 随之改变）。
+  static void AddChild(Node **ref, uint8_t b, Node *child) {
+    auto *inner = static_cast<Inner *>(*ref);
+    switch (inner->type_) {
+      case NodeType::kNode4: {
+        auto *n = static_cast<Node4 *>(inner);
+        if (n->num_children_ < 4) {
+          InsertSorted(n, b, child);
+          return;
+        }
+        auto *grown = new Node16();
+        MoveHeader(grown, n);
+        std::copy(n->keys_, n->keys_ + 4, grown->keys_);
+        std::copy(n->children_, n->children_ + 4, grown->children_);
+        delete n;
+        *ref = grown;
+        InsertSorted(grown, b, child);
+        return;
+      }
+      case NodeType::kNode16: {
+        auto *n = static_cast<Node16 *>(inner);
+        if (n->num_children_ < 16) {
+          InsertSorted(n, b, child);
+          return;
+        }
+        auto *grown = new Node48();
+        MoveHeader(grown, n);
+        for (int i = 0; i < 16; i++) {
+          grown->children_[i] = n->children_[i];
+          grown->child_index_[n->keys_[i]] = static_cast<uint8_t>(i + 1);
+        }
+        delete n;
+        *ref = grown;
+        AddChild(ref, b, child);
+        return;
+      }
+      case NodeType::kNode48: {
+        auto *n = static_cast<Node48 *>(inner);
+        if (n->num_children_ < 48) {
+          int slot = 0;
+          while (n->children_[slot] != nullptr) {
+            slot++;
+          }
+          n->children_[slot] = child;
+          n->child_index_[b] = static_cast<uint8_t>(slot + 1);
+          n->num_children_++;
+          return;
+        }
+        auto *grown = new Node256();
+        MoveHeader(grown, n);
+        for (int k = 0; k < 256; k++) {
+          if (n->child_index_[k] != 0) {
+            grown->children_[k] = n->children_[n->child_index_[k] - 1];
+          }
+        }
+        delete n;
+        *ref = grown;
+        AddChild(ref, b, child);
+        return;
+      }
+      case NodeType::kNode256: {
+        auto *n = static_cast<Node256 *>(inner);
+        n->children_[b] = child;
+        n->num_children_++;
+        return;
+      }
+      case NodeType::kLeaf:
+        break;
+    }
+  }
+
+  // 删除字节 b 对应的子节点，子节点太少时换成小一号的节点。阈值比扩容的阈值低一些，
+  // 避免在边界附近反复扩容、缩容。
+  static void RemoveChild(Node **ref, uint8_t b) {
+    auto *inner = static_cast<Inner *>(*ref);
+    switch (inner->type_) {
+      case NodeType::kNode4:
+        RemoveSorted(static_cast<Node4 *>(inner), b);
+        return;
+      case NodeType::kNode16: {
+        auto *n = static_cast<Node16 *>(inner);
+        RemoveSorted(n, b);
+        if (n->num_children_ == 3) {
+          auto *shrunk = new Node4();
+          MoveHeader(shrunk, n);
+          std::copy(n->keys_, n->keys_ + 3, shrunk->keys_);
+          std::copy(n->children_, n->children_ + 3, shrunk->children_);
+          delete n;
+          *ref = shrunk;
+        }
+        return;
+      }
+      case NodeType::kNode48: {
+        auto *n = static_cast<Node48 *>(inner);
+        n->children_[n->child_index_[b] - 1] = nullptr;
+        n->child_index_[b] = 0;
+        n->num_children_--;
+        if (n->num_children_ == 12) {
+          auto *shrunk = new Node16();
+          MoveHeader(shrunk, n);
+          shrunk->num_children_ = 0;
+          for (int k = 0; k < 256; k++) {
+            if (n->child_index_[k] != 0) {
+              InsertSorted(shrunk, static_cast<uint8_t>(k), n->children_[n->child_index_[k] - 1]);
+            }
+          }
+          delete n;
+          *ref = shrunk;
+        }
+        return;
+      }
+      case NodeType::kNode256: {
+        auto *n = static_cast<Node256 *>(inner);
+        n->children_[b] = nullptr;
+        n->num_children_--;
+        if (n->num_children_ == 37) {
+          auto *shrunk = new Node48();
+          MoveHeader(shrunk, n);
+          shrunk->num_children_ = 0;
+          for (int k = 0; k < 256; k++) {
+            if (n->children_[k] != nullptr) {
+              shrunk->children_[shrunk->num_children_] = n->children_[k];
+              shrunk->child_index_[k] = static_cast<uint8_t>(++shrunk->num_children_);
+            }
+          }
+          delete n;
+          *ref = shrunk;
+        }
+        return;
+      }
+      case NodeType::kLeaf:
+        break;
+    }
+  }
+
+  // 删除之后恢复路径压缩：没有子节点的内部节点换成它的 value_leaf_（或者直接删掉），
+  // 只有一个子节点、又没有 value_leaf_ 的 Node4 与子节点合并。
+  static void Compact(Node **ref) {
+    auto *inner = static_cast<Inner *>(*ref);
+    if (inner->num_children_ == 0) {
+      *ref = inner->value_leaf_;
+      DeleteInner(inner);
+      return;
+    }
+    if (inner->type_ != NodeType::kNode4 || inner->num_children_ != 1 || inner->value_leaf_ != nullptr) {
+      return;
+    }
+    auto *n = static_cast<Node4 *>(inner);
+    Node *child = n->children_[0];
+    if (child->type_ != NodeType::kLeaf) {
+      auto *child_inner = static_cast<Inner *>(child);
+      child_inner->prefix_ = n->prefix_ + static_cast<char>(n->keys_[0]) + child_inner->prefix_;
+    }
+    *ref = child;
+    delete n;
+  }
+
+  static bool Insert(Node **ref, std::string_view key, size_t depth, V value) {
+    if (*ref == nullptr) {
+      *ref = new Leaf(key, std::move(value));
+      return true;
+    }
+    if ((*ref)->type_ == NodeType::kLeaf) {
+      auto *leaf = static_cast<Leaf *>(*ref);
+      if (leaf->key_ == key) {
+        return false;
+      }
+      // 惰性展开：两个键在这里分开，用一个 Node4 代替原来的叶子，两者共同的字节成为它的 prefix_。
+      std::string_view existing = leaf->key_;
+      size_t common = 0;
+      while (depth + common < existing.size() && depth + common < key.size() &&
+             existing[depth + common] == key[depth + common]) {
+        common++;
+      }
+      auto *split = new Node4();
+      split->prefix_ = std::string(key.substr(depth, common));
+      Node *split_node = split;
+      size_t d = depth + common;
+      PlaceLeaf(&split_node, leaf, d);
+      PlaceLeaf(&split_node, new Leaf(key, std::move(value)), d);
+      *ref = split_node;
+      return true;
+    }
+
+    auto *inner = static_cast<Inner *>(*ref);
+    size_t matched = MatchPrefix(inner, key, depth);
+    if (matched < inner->prefix_.size()) {
+      // 新键在压缩路径中间分叉：拆开压缩路径。
+      auto *split = new Node4();
+      split->prefix_ = inner->prefix_.substr(0, matched);
+      auto branch = static_cast<uint8_t>(inner->prefix_[matched]);
+      inner->prefix_.erase(0, matched + 1);
+      Node *split_node = split;
+      AddChild(&split_node, branch, inner);
+      PlaceLeaf(&split_node, new Leaf(key, std::move(value)), depth + matched);
+      *ref = split_node;
+      return true;
+    }
+    depth += matched;
+    if (depth == key.size()) {
+      if (inner->value_leaf_ != nullptr) {
+        return false;
+      }
+      inner->value_leaf_ = new Leaf(key, std::move(value));
+      return true;
+    }
+    Node **child = FindChild(inner, static_cast<uint8_t>(key[depth]));
+    if (child != nullptr) {
+      return Insert(child, key, depth + 1, std::move(value));
+    }
+    AddChild(ref, static_cast<uint8_t>(key[depth]), new Leaf(key, std::move(value)));
+    return true;
+  }
+
+  // 把叶子放到内部节点 *ref 下：键在深度 depth 结束时作为 value_leaf_，否则作为字节 key[depth] 的子节点。
+  static void PlaceLeaf(Node **ref, Leaf *leaf, size_t depth) {
+    if (leaf->key_.size() == depth) {
+      static_cast<Inner *>(*ref)->value_leaf_ = leaf;
+    } else {
+      AddChild(ref, static_cast<uint8_t>(leaf->key_[depth]), leaf);
+    }
+  }
+
+  static bool Erase(Node **ref, std::string_view key, size_t depth) {
+    if (*ref == nullptr) {
+      return false;
+    }
+    if ((*ref)->type_ == NodeType::kLeaf) {
+      auto *leaf = static_cast<Leaf *>(*ref);
+      if (leaf->key_ != key) {
+        return false;
+      }
+      delete leaf;
+      *ref = nullptr;
+      return true;
+    }
+    auto *inner = static_cast<Inner *>(*ref);
+    if (MatchPrefix(inner, key, depth) != inner->prefix_.size()) {
+      return false;
+    }
+    depth += inner->prefix_.size();
+    if (depth == key.size()) {
+      if (inner->value_leaf_ == nullptr) {
+        return false;
+      }
+      delete inner->value_leaf_;
+      inner->value_leaf_ = nullptr;
+      Compact(ref);
+      return true;
+    }
+    auto b = static_cast<uint8_t>(key[depth]);
+    Node **child = FindChild(inner, b);
+    if (child == nullptr || !Erase(child, key, depth + 1)) {
+      return false;
+    }
+    if (*child == nullptr) {
+      RemoveChild(ref, b);
+    }
+    Compact(ref);
+    return true;
+  }
+
+  template <typename Fn>
+  static void Visit(Node *node, Fn &fn) {
+    if (node == nullptr) {
+      return;
+    }
+    if (node->type_ == NodeType::kLeaf) {
+      auto *leaf = static_cast<Leaf *>(node);
+      fn(std::string_view(leaf->key_), leaf->value_);
+      return;
+    }
+    auto *inner = static_cast<Inner *>(node);
+    // 在这里结束的键比子树中的所有键都短，按字节序排在最前面。
+    if (inner->value_leaf_ != nullptr) {
+      fn(std::string_view(inner->value_leaf_->key_), inner->value_leaf_->value_);
+    }
+    ForEachChild(inner, [&fn](uint8_t, Node *child) { Visit(child, fn); });
+  }
+
+  static void Count(Node *node, NodeCounts *counts) {
+    if (node == nullptr) {
+      return;
+    }
+    switch (node->type_) {
+      case NodeType::kLeaf:
+        counts->leaves_++;
+        return;
+      case NodeType::kNode4:
+        counts->node4_++;
+        break;
+      case NodeType::kNode16:
+        counts->node16_++;
+        break;
+      case NodeType::kNode48:
+        counts->node48_++;
+        break;
+      case NodeType::kNode256:
+        counts->node256_++;
+        break;
+    }
+    auto *inner = static_cast<Inner *>(node);
+    counts->leaves_ += inner->value_leaf_ != nullptr;
+    ForEachChild(inner, [counts](uint8_t, Node *child) { Count(child, counts); });
+  }
+
+  Node *root_{nullptr};
+  size_t size_{0};
+};
+
+// 把整数编码成大端字节序的 8 字节键，字节序与数值顺序一致。
+std::string EncodeKey(uint64_t value) {
+  std::string key(8, '\0');
+  for (int i = 7; i >= 0; i--) {
+    key[i] = static_cast<char>(value & 0xFF);
+    value >>= 8;
+  }
+  return key;
+}
+
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::cout << "CHECK FAILED: " << what << std::endl;
+    std::exit(1);
+  }
+}
+
+// 用随机的插入与删除与 std::map 对照。键很短、字符集很小，所以大量的键互为前缀，
+// 节点会反复扩容、缩容，压缩路径也会反复拆开、合并。
+void CheckAgainstMap() {
+  AdaptiveRadixTree<int> art;
+  std::map<std::string, int> reference;
+  std::mt19937_64 rng(42);
+  for (int op = 0; op < 200'000; op++) {
+    std::string key(rng() % 5, '\0');
+    for (auto &c : key) {
+      // 前两个字节只取少数几个值（产生公共前缀），后面的字节取全部 256 个值（产生 Node48/Node256）。
+      c = static_cast<char>(key.size() > 2 && &c >= &key[2] ? rng() % 256 : rng() % 3);
+    }
+    if (rng() % 3 == 0) {
+      Check(art.erase(key) == (reference.erase(key) == 1), "erase agrees with std::map");
+    } else {
+      Check(art.insert(key, op) == reference.emplace(key, op).second, "insert agrees with std::map");
+    }
+    Check(art.size() == reference.size(), "size agrees with std::map");
+  }
+  for (auto &[key, value] : reference) {
+    Check(art.find(key) != nullptr && *art.find(key) == value, "find agrees with std::map");
+  }
+
+  auto it = reference.begin();
+  art.for_each([&](std::string_view key, int value) {
+    Check(it != reference.end() && it->first == key && it->second == value, "for_each visits keys in order");
+    ++it;
+  });
+  Check(it == reference.end(), "for_each visits every key");
+
+  std::string prefix("\x01\x02", 2);
+  std::vector<std::string> expected;
+  for (auto p = reference.lower_bound(prefix); p != reference.end() && p->first.compare(0, 2, prefix) == 0; ++p) {
+    expected.push_back(p->first);
+  }
+  std::vector<std::string> scanned;
+  art.scan_prefix(prefix, [&](std::string_view key, int) { scanned.emplace_back(key); });
+  Check(scanned == expected, "scan_prefix agrees with std::map::lower_bound");
+
+  auto counts = art.CountNodes();
+  Check(counts.leaves_ == reference.size(), "every key has a leaf");
+  std::cout << "Checks against std::map passed: " << reference.size() << " keys in " << counts.node4_ << " Node4, "
+            << counts.node16_ << " Node16, " << counts.node48_ << " Node48, " << counts.node256_ << " Node256\n";
+}
+
+// 当前堆上已分配的字节数（包括 malloc 的元数据），用于比较各个容器的内存占用。
+size_t HeapBytes() { return mallinfo2().uordblks; }
+
+double MillisSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+volatile uint64_t benchmark_sink;
+
+// 对每种容器：构建、随机查找全部键、按顺序遍历（unordered_map 需要先排序）、若干次前缀扫描，以及内存占用。
+template <typename Key>
+void Bench(const char *title, const std::vector<Key> &keys, const std::vector<std::string> &prefixes,
+           std::string (*to_bytes)(const Key &)) {
+  std::cout << title << " (" << keys.size() << " keys):\n";
+  std::vector<Key> lookups = keys;
+  std::shuffle(lookups.begin(), lookups.end(), std::mt19937_64(3));
+  uint64_t sum = 0;
+
+  {
+    std::vector<std::string> encoded;
+    encoded.reserve(keys.size());
+    for (auto &key : keys) {
+      encoded.push_back(to_bytes(key));
+    }
+    std::vector<std::string> encoded_lookups;
+    encoded_lookups.reserve(keys.size());
+    for (auto &key : lookups) {
+      encoded_lookups.push_back(to_bytes(key));
+    }
+    size_t heap = HeapBytes();
+    auto start = std::chrono::steady_clock::now();
+    AdaptiveRadixTree<uint64_t> art;
+    for (size_t i = 0; i < encoded.size(); i++) {
+      art.insert(encoded[i], i);
+    }
+    double build = MillisSince(start);
+    size_t bytes = HeapBytes() - heap;
+    start = std::chrono::steady_clock::now();
+    for (auto &key : encoded_lookups) {
+      sum += *art.find(key);
+    }
+    double lookup = MillisSince(start);
+    start = std::chrono::steady_clock::now();
+    art.for_each([&](std::string_view, uint64_t value) { sum += value; });
+    double scan = MillisSince(start);
+    start = std::chrono::steady_clock::now();
+    size_t matches = 0;
+    for (auto &prefix : prefixes) {
+      art.scan_prefix(prefix, [&](std::string_view, uint64_t value) { sum += value, matches++; });
+    }
+    double prefix_scan = MillisSince(start);
+    std::cout << "  adaptive radix tree: build " << build << " ms, lookups " << lookup << " ms, ordered scan " << scan
+              << " ms, ";
+    if (!prefixes.empty()) {
+      std::cout << prefixes.size() << " prefix scans " << prefix_scan << " ms (" << matches << " keys), ";
+    }
+    std::cout << "memory " << bytes / keys.size() << " bytes/key\n";
+  }
+
+  {
+    size_t heap = HeapBytes();
+    auto start = std::chrono::steady_clock::now();
+    std::map<Key, uint64_t> map;
+    for (size_t i = 0; i < keys.size(); i++) {
+      map.emplace(keys[i], i);
+    }
+    double build = MillisSince(start);
+    size_t bytes = HeapBytes() - heap;
+    start = std::chrono::steady_clock::now();
+    for (auto &key : lookups) {
+      sum += map.find(key)->second;
+    }
+    double lookup = MillisSince(start);
+    start = std::chrono::steady_clock::now();
+    for (auto &[key, value] : map) {
+      sum += value;
+    }
+    double scan = MillisSince(start);
+    std::cout << "  std::map:            build " << build << " ms, lookups " << lookup << " ms, ordered scan " << scan
+              << " ms, memory " << bytes / keys.size() << " bytes/key\n";
+  }
+
+  {
+    size_t heap = HeapBytes();
+    auto start = std::chrono::steady_clock::now();
+    std::unordered_map<Key, uint64_t> map;
+    for (size_t i = 0; i < keys.size(); i++) {
+      map.emplace(keys[i], i);
+    }
+    double build = MillisSince(start);
+    size_t bytes = HeapBytes() - heap;
+    start = std::chrono::steady_clock::now();
+    for (auto &key : lookups) {
+      sum += map.find(key)->second;
+    }
+    double lookup = MillisSince(start);
+    // unordered_map 没有顺序，有序遍历需要先把元素拷出来排序。
+    start = std::chrono::steady_clock::now();
+    std::vector<std::pair<Key, uint64_t>> sorted(map.begin(), map.end());
+    std::sort(sorted.begin(), sorted.end());
+    for (auto &[key, value] : sorted) {
+      sum += value;
+    }
+    double scan = MillisSince(start);
+    std::cout << "  std::unordered_map:  build " << build << " ms, lookups " << lookup
+              << " ms, ordered scan (copy + sort) " << scan << " ms, memory " << bytes / keys.size() << " bytes/key\n";
+  }
+  benchmark_sink = sum;
+}
+
+// 用法：./adaptive_radix_tree [键数]
+int main(int argc, char *argv[]) {
+  size_t num_keys = argc > 1 ? std::stoul(argv[1]) : 500'000;
+
+  // 第一部分：与 std::map 对照检查。
+  CheckAgainstMap();
+
+  // 第二部分：字符串键（形如 unordered_maps.cpp 中的字符串，带有公共前缀）与随机整数键。
+  std::mt19937_64 rng(42);
+  std::vector<std::string> string_keys;
+  std::unordered_map<std::string, bool> seen;
+  while (string_keys.size() < num_keys) {
+    std::string key = "user" + std::to_string(rng() % 1'000'000'000);
+    if (seen.emplace(key, true).second) {
+      string_keys.push_back(std::move(key));
+    }
+  }
+  seen.clear();
+  std::vector<std::string> prefixes;
+  for (int i = 0; i < 1000; i++) {
+    prefixes.push_back(string_keys[rng() % num_keys].substr(0, 8));
+  }
+  Bench<std::string>("String keys", string_keys, prefixes, [](const std::string &key) { return key; });
+
+  std::vector<uint64_t> int_keys;
+  for (size_t i = 0; i < num_keys; i++) {
+    int_keys.push_back(rng());
+  }
+  Bench<uint64_t>("Random 64-bit integer keys", int_keys, {}, [](const uint64_t &key) { return EncodeKey(key); });
+  return 0;
+}
@@ -0,0 +1,698 @@
+/**
+ * @file async_disk_manager.cpp
+ * @brief 基于 io_uring 的异步磁盘管理器（disk manager）的教学示例，带线程池 + pread/pwrite 的后备实现。
+ */
+
+// 缓冲池缺页时要从磁盘读入一个页。如果用 pread 同步读取，发起读取的工作线程在 I/O 完成之前什么也做不了；
+// 为了让磁盘同时处理多个请求（提高队列深度），就需要很多线程同时阻塞在 pread 上。
+
+// Linux 5.1 引入的 io_uring 用两个与内核共享的环形队列完成异步 I/O：
+// - 提交队列（SQ）：用户态填写提交队列项（SQE，描述“从 fd 的某个偏移读 4096 字节到某个缓冲区”），
+//   然后用一次 io_uring_enter 系统调用把一批 SQE 交给内核。
+// - 完成队列（CQ）：I/O 完成后内核写入完成队列项（CQE），其中 user_data 是提交时附带的任意 64 位值，
+//   res 是结果（读写的字节数，或负的 errno）。
+// 一个线程可以让任意多个 I/O 同时在途，一次系统调用就能提交或收割一整批请求。
+// 参考：https://kernel.dk/io_uring.pdf
+
+// 本文件不依赖 liburing，直接使用 <linux/io_uring.h> 与 io_uring_setup / io_uring_enter 系统调用，
+// 以便看清环形队列的工作方式。如果内核不支持 io_uring（或被 seccomp 禁用），自动退回到线程池后备实现：
+// 若干工作线程从队列中取请求，调用 pread/pwrite。两种后端对外提供相同的接口：
+// - 回调：I/O 完成时在后端的线程上调用 callback(result)，result 是字节数或负的 errno；
+// - std::future：在回调中设置 std::promise；
+// - 批量提交：SubmitBatch 一次提交多个请求（io_uring 后端只需一次系统调用）。
+// 打开文件时可以选择 O_DIRECT，绕过页缓存直接访问设备，此时缓冲区、偏移和长度都必须按 4096 字节对齐。
+// 文件描述符由 FileHandle 管理，它是与 wrapper_class.cpp 中的 IntPtrManager 相同风格的 RAII 包装类。
+
+// 包含 fcntl 头文件（open 与 O_DIRECT 等标志）。
+#include <fcntl.h>
+// 包含 io_uring 的内核接口定义。
+#include <linux/io_uring.h>
+// 包含 eventfd（用于唤醒环线程）。
+#include <sys/eventfd.h>
+// 包含 mmap。
+#include <sys/mman.h>
+// 包含 SYS_io_uring_setup 等系统调用号。
+#include <sys/syscall.h>
+// 包含 pread、pwrite、close 与 syscall。
+#include <unistd.h>
+
+// 包含 std::sort（用于计算分位数）。
+#include <algorithm>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 errno。
+#include <cerrno>
+// 包含 std::remove。
+#include <cstdio>
+// 包含 std::aligned_alloc 与 std::free。
+#include <cstdlib>
+// 包含 std::memset。
+#include <cstring>
+// 包含 std::condition_variable。
+#include <condition_variable>
+// 包含 std::function（回调）。
+#include <functional>
+// 包含 std::future 与 std::promise。
+#include <future>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::unique_ptr。
+#include <memory>
+// 包含 std::mutex。
+#include <mutex>
+// 包含 std::bad_alloc。
+#include <new>
+// 包含 std::queue（线程池的请求队列）。
+#include <queue>
+// 包含 std::mt19937_64（用于生成随机页号）。
+#include <random>
+// 包含 std::runtime_error。
+#include <stdexcept>
+// 包含 std::string。
+#include <string>
+// 包含 std::system_error。
+#include <system_error>
+// 包含 thread 头文件。
+#include <thread>
+// 包含 std::move。
+#include <utility>
+// 包含 std::vector。
+#include <vector>
+
+using page_id_t = int32_t;
+
+constexpr size_t kPageSize = 4096;
+
+// 管理一个文件描述符的 RAII 包装类：构造时打开文件，析构时关闭。不可拷贝，可移动，
+// 被移动后的对象 fd_ 为 -1，析构时不做任何事。打开失败时抛出 std::system_error。
+class FileHandle {
+ public:
+  FileHandle(const std::string &path, bool direct_io) {
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | (direct_io ? O_DIRECT : 0), 0644);
+    if (fd_ < 0) {
+      throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+  }
+
+  ~FileHandle() {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  FileHandle(FileHandle &&other) noexcept : fd_(other.fd_) { other.fd_ = -1; }
+
+  FileHandle &operator=(FileHandle &&other) noexcept {
+    if (this != &other) {
+      if (fd_ >= 0) {
+        close(fd_);
+      }
+      fd_ = other.fd_;
+      other.fd_ = -1;
+    }
+    return *this;
+  }
+
+  FileHandle(const FileHandle &) = delete;
+  FileHandle &operator=(const FileHandle &) = delete;
+
+  int Fd() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+// 按页大小对齐的缓冲区，O_DIRECT 要求缓冲区地址对齐。
+struct FreeDeleter {
+  void operator()(void *p) const { std::free(p); }
+};
+using AlignedBuffer = std::unique_ptr<char[], FreeDeleter>;
+
+// 分配失败时抛出 std::bad_alloc。
+AlignedBuffer MakeAlignedBuffer(size_t bytes) {
+  auto *p = static_cast<char *>(std::aligned_alloc(kPageSize, bytes));
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return AlignedBuffer(p);
+}
+
+enum class IoOp { kRead, kWrite };
+
+// I/O 完成时调用，result 为读写的字节数，失败时为负的 errno。回调在后端的线程上执行，应当尽快返回。
+using IoCallback = std::function<void(int result)>;
+
+struct IoRequest {
+  IoOp op_;
+  page_id_t page_id_;
+  char *buffer_;
+  IoCallback callback_;
+};
+
+// 后端接口。Submit 只把请求交给后端，不等待 I/O 完成。
+class IoBackend {
+ public:
+  virtual ~IoBackend() = default;
+  virtual void Submit(std::vector<IoRequest> requests) = 0;
+  virtual const char *Name() const = 0;
+};
+
+// 直接使用系统调用的 io_uring 后端。所有 SQ/CQ 操作都由一个环线程（ring thread）完成：
+// - 内核常把 I/O 完成的收尾工作（task_work）交给提交该请求的线程执行。如果由调用 Submit 的线程直接提交，
+//   而它随后阻塞在别处（例如 future.get()），完成事件可能迟迟不出现在 CQ 中。
+//   因此 Submit 只把请求放进 pending_ 队列，真正的提交与收割都在环线程中进行。
+// - 环线程始终挂着一个对 eventfd 的读请求。Submit 向 eventfd 写入 1，这个读请求随之完成，
+//   把阻塞在 io_uring_enter(GETEVENTS) 上的环线程唤醒；环线程一次 io_uring_enter 提交所有积压的请求。
+// - 在途请求数不超过 SQ 的大小（为 eventfd 的读请求保留一个位置），CQ（大小为 SQ 的两倍）永远不会溢出；
+//   多出来的请求留在 pending_ 中，等有请求完成后再提交。
+class UringBackend : public IoBackend {
+ public:
+  UringBackend(int fd, unsigned entries) : fd_(fd) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring_fd_ = static_cast<int>(syscall(SYS_io_uring_setup, std::max(entries, 2U), &params));
+    if (ring_fd_ < 0) {
+      throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+    }
+    // IORING_OP_READ/IORING_OP_WRITE 从 5.6 才有。5.1–5.5 的内核能建环，但这些请求都会以 -EINVAL 完成，
+    // 所以先确认内核支持它们，不支持就抛出异常，让 kAuto 退回线程池。
+    if (int error = ProbeReadWrite(); error != 0) {
+      close(ring_fd_);
+      throw std::system_error(error, std::generic_category(), "io_uring read/write opcodes");
+    }
+    entries_ = params.sq_entries;
+    event_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (event_fd_ < 0) {
+      int error = errno;
+      close(ring_fd_);
+      throw std::system_error(error, std::generic_category(), "eventfd");
+    }
+
+    // 把 SQ 环、CQ 环和 SQE 数组映射到用户态。较新的内核（IORING_FEAT_SINGLE_MMAP）中两个环共用一次映射。
+    sq_ring_bytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_bytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+      sq_ring_bytes_ = cq_ring_bytes_ = std::max(sq_ring_bytes_, cq_ring_bytes_);
+    }
+    sq_ring_ = Map(sq_ring_bytes_, IORING_OFF_SQ_RING);
+    cq_ring_ = single_mmap ? sq_ring_ : Map(cq_ring_bytes_, IORING_OFF_CQ_RING);
+    sqes_bytes_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(Map(sqes_bytes_, IORING_OFF_SQES));
+
+    char *sq = static_cast<char *>(sq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    char *cq = static_cast<char *>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    ring_thread_ = std::thread([this] { RingLoop(); });
+  }
+
+  // 设置停止标记并唤醒环线程。环线程处理完所有已提交的请求后退出。
+  // 析构函数不能抛出异常，所以唤醒失败时忽略（eventfd 的计数器溢出之前 write 不会失败）。
+  ~UringBackend() override {
+    {
+      std::scoped_lock lk(pending_mutex_);
+      stop_ = true;
+    }
+    TryWakeup();
+    ring_thread_.join();
+    munmap(sqes_, sqes_bytes_);
+    if (cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_bytes_);
+    }
+    munmap(sq_ring_, sq_ring_bytes_);
+    close(ring_fd_);
+    close(event_fd_);
+  }
+
+  UringBackend(const UringBackend &) = delete;
+  UringBackend &operator=(const UringBackend &) = delete;
+
+  // 环线程因错误退出后，新请求直接以该错误完成。
+  void Submit(std::vector<IoRequest> requests) override {
+    int error;
+    {
+      std::scoped_lock lk(pending_mutex_);
+      error = error_;
+      if (error == 0) {
+        for (auto &request : requests) {
+          pending_.push(new IoRequest(std::move(request)));
+        }
+      }
+    }
+    if (error != 0) {
+      for (auto &request : requests) {
+        request.callback_(error);
+      }
+      return;
+    }
+    Wakeup();
+  }
+
+  const char *Name() const override { return "io_uring"; }
+
+ private:
+  void *Map(size_t bytes, off_t offset) {
+    void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, offset);
+    if (p == MAP_FAILED) {
+      throw std::system_error(errno, std::generic_category(), "mmap io_uring");
+    }
+    return p;
+  }
+
+  // 用 IORING_REGISTER_PROBE（同样是 5.6 引入的）查询内核支持的操作码。返回 0 表示支持读写，否则返回 errno。
+  int ProbeReadWrite() {
+    constexpr unsigned kProbeOps = 256;
+    std::unique_ptr<io_uring_probe, FreeDeleter> probe(
+        static_cast<io_uring_probe *>(std::calloc(1, sizeof(io_uring_probe) + kProbeOps * sizeof(io_uring_probe_op))));
+    if (probe == nullptr) {
+      return ENOMEM;
+    }
+    if (syscall(SYS_io_uring_register, ring_fd_, IORING_REGISTER_PROBE, probe.get(), kProbeOps) < 0) {
+      return errno;
+    }
+    for (unsigned op : {IORING_OP_READ, IORING_OP_WRITE}) {
+      if (op >= probe->ops_len || (probe->ops[op].flags & IO_URING_OP_SUPPORTED) == 0) {
+        return EOPNOTSUPP;
+      }
+    }
+    return 0;
+  }
+
+  bool TryWakeup() noexcept {
+    uint64_t one = 1;
+    return write(event_fd_, &one, sizeof(one)) == sizeof(one);
+  }
+
+  void Wakeup() {
+    if (!TryWakeup()) {
+      throw std::system_error(errno, std::generic_category(), "write eventfd");
+    }
+  }
+
+  // io_uring_enter，被信号打断时重试。
+  void Enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+    while (syscall(SYS_io_uring_enter, ring_fd_, to_submit, min_complete, flags, nullptr, 0) < 0) {
+      if (errno != EINTR) {
+        throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+      }
+    }
+  }
+
+  // 填写 SQ 尾部的下一个 SQE。SQ 的尾指针只由环线程修改，用 release 写入，保证内核看到尾指针时 SQE 已经填好。
+  void PushSqe(uint8_t opcode, int fd, void *buffer, unsigned len, uint64_t offset, uint64_t user_data) {
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & sq_mask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  }
+
+  // 环线程的主循环：把积压的请求放入 SQ，提交并等待至少一个完成事件，再收割 CQ 中的所有完成事件。
+  // eventfd 的读请求成功完成后需要重新挂上；它失败时环线程再也无法被唤醒，只能以错误结束（见 Fail）。
+  void RingLoop() {
+    unsigned to_submit = 0;
+    unsigned inflight = 0;
+    PushSqe(IORING_OP_READ, event_fd_, &wakeup_value_, sizeof(wakeup_value_), 0, 0);
+    to_submit += 1;
+    while (true) {
+      bool stop;
+      {
+        std::scoped_lock lk(pending_mutex_);
+        while (!pending_.empty() && inflight + 1 < entries_) {
+          IoRequest *request = pending_.front();
+          pending_.pop();
+          PushSqe(request->op_ == IoOp::kRead ? IORING_OP_READ : IORING_OP_WRITE, fd_, request->buffer_, kPageSize,
+                  static_cast<uint64_t>(request->page_id_) * kPageSize, reinterpret_cast<uint64_t>(request));
+          to_submit += 1;
+          inflight += 1;
+        }
+        stop = stop_ && pending_.empty() && inflight == 0;
+      }
+      if (stop) {
+        return;
+      }
+      Enter(to_submit, 1, IORING_ENTER_GETEVENTS);
+      to_submit = 0;
+
+      bool woken = false;
+      int wakeup_result = 0;
+      inflight -= Reap(&woken, &wakeup_result);
+      if (woken) {
+        if (wakeup_result != static_cast<int>(sizeof(wakeup_value_))) {
+          Fail(wakeup_result < 0 ? wakeup_result : -EIO, inflight);
+          return;
+        }
+        PushSqe(IORING_OP_READ, event_fd_, &wakeup_value_, sizeof(wakeup_value_), 0, 0);
+        to_submit += 1;
+      }
+    }
+  }
+
+  // 收割 CQ 中的所有完成事件并调用回调，返回完成的 I/O 请求数。
+  // user_data 为 0 的完成事件来自 eventfd 的读请求：置位 *woken 并把结果写入 *wakeup_result。
+  // 其余的 user_data 是 IoRequest 指针。
+  unsigned Reap(bool *woken, int *wakeup_result) {
+    unsigned head = *cq_head_;
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    std::vector<std::pair<IoRequest *, int>> done;
+    for (; head != tail; head++) {
+      const io_uring_cqe &cqe = cqes_[head & cq_mask_];
+      if (cqe.user_data == 0) {
+        *woken = true;
+        *wakeup_result = cqe.res;
+      } else {
+        done.emplace_back(reinterpret_cast<IoRequest *>(cqe.user_data), cqe.res);
+      }
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    for (auto &[request, result] : done) {
+      request->callback_(result);
+      delete request;
+    }
+    return static_cast<unsigned>(done.size());
+  }
+
+  // 记录错误，让积压的请求（以及之后提交的请求）以 error 完成，再等已提交的 inflight 个请求完成。
+  void Fail(int error, unsigned inflight) {
+    std::queue<IoRequest *> rejected;
+    {
+      std::scoped_lock lk(pending_mutex_);
+      error_ = error;
+      std::swap(rejected, pending_);
+    }
+    for (; !rejected.empty(); rejected.pop()) {
+      rejected.front()->callback_(error);
+      delete rejected.front();
+    }
+    while (inflight > 0) {
+      Enter(0, 1, IORING_ENTER_GETEVENTS);
+      bool woken = false;
+      int wakeup_result = 0;
+      inflight -= Reap(&woken, &wakeup_result);
+    }
+  }
+
+  int fd_;
+  int ring_fd_;
+  int event_fd_;
+  unsigned entries_;
+  void *sq_ring_;
+  void *cq_ring_;
+  size_t sq_ring_bytes_;
+  size_t cq_ring_bytes_;
+  io_uring_sqe *sqes_;
+  size_t sqes_bytes_;
+  unsigned *sq_tail_;
+  unsigned sq_mask_;
+  unsigned *sq_array_;
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned cq_mask_;
+  io_uring_cqe *cqes_;
+  uint64_t wakeup_value_{0};
+
+  std::mutex pending_mutex_;
+  std::queue<IoRequest *> pending_;
+  bool stop_{false};
+  // 环线程因错误退出时记录的负 errno，0 表示正常。
+  int error_{0};
+  std::thread ring_thread_;
+};
+
+// 后备实现：num_threads 个工作线程从队列中取请求，同步调用 pread/pwrite。
+// 同时在途的 I/O 数量最多等于线程数。
+class ThreadPoolBackend : public IoBackend {
+ public:
+  ThreadPoolBackend(int fd, size_t num_threads) : fd_(fd) {
+    for (size_t i = 0; i < num_threads; i++) {
+      workers_.emplace_back([this] { WorkerLoop(); });
+    }
+  }
+
+  ~ThreadPoolBackend() override {
+    {
+      std::scoped_lock lk(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto &w : workers_) {
+      w.join();
+    }
+  }
+
+  void Submit(std::vector<IoRequest> requests) override {
+    {
+      std::scoped_lock lk(mutex_);
+      for (auto &request : requests) {
+        queue_.push(std::move(request));
+      }
+    }
+    cv_.notify_all();
+  }
+
+  const char *Name() const override { return "thread pool"; }
+
+ private:
+  // 停止时先处理完队列中剩余的请求再退出。
+  void WorkerLoop() {
+    while (true) {
+      IoRequest request;
+      {
+        std::unique_lock lk(mutex_);
+        cv_.wait(lk, [&] { return stop_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          return;
+        }
+        request = std::move(queue_.front());
+        queue_.pop();
+      }
+      off_t offset = static_cast<off_t>(request.page_id_) * kPageSize;
+      ssize_t n = request.op_ == IoOp::kRead ? pread(fd_, request.buffer_, kPageSize, offset)
+                                             : pwrite(fd_, request.buffer_, kPageSize, offset);
+      request.callback_(n < 0 ? -errno : static_cast<int>(n));
+    }
+  }
+
+  int fd_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::queue<IoRequest> queue_;
+  bool stop_{false};
+  std::vector<std::thread> workers_;
+};
+
+enum class BackendKind { kAuto, kUring, kThreadPool };
+
+struct DiskOptions {
+  BackendKind backend_ = BackendKind::kAuto;
+  bool direct_io_ = false;
+  unsigned queue_depth_ = 128;
+  size_t fallback_threads_ = 16;
+};
+
+class AsyncDiskManager {
+ public:
+  AsyncDiskManager(const std::string &path, const DiskOptions &options) : file_(path, options.direct_io_) {
+    if (options.backend_ != BackendKind::kThreadPool) {
+      try {
+        backend_ = std::make_unique<UringBackend>(file_.Fd(), options.queue_depth_);
+      } catch (const std::system_error &e) {
+        if (options.backend_ == BackendKind::kUring) {
+          throw;
+        }
+        std::cout << "io_uring unavailable (" << e.what() << "), falling back to a thread pool\n";
+      }
+    }
+    if (backend_ == nullptr) {
+      backend_ = std::make_unique<ThreadPoolBackend>(file_.Fd(), options.fallback_threads_);
+    }
+  }
+
+  void ReadPageAsync(page_id_t page_id, char *buffer, IoCallback callback) {
+    SubmitBatch({IoRequest{IoOp::kRead, page_id, buffer, std::move(callback)}});
+  }
+
+  void WritePageAsync(page_id_t page_id, const char *buffer, IoCallback callback) {
+    SubmitBatch({IoRequest{IoOp::kWrite, page_id, const_cast<char *>(buffer), std::move(callback)}});
+  }
+
+  // 返回 future 的版本。I/O 失败或只读写了部分页时，future.get() 抛出异常。
+  std::future<void> ReadPage(page_id_t page_id, char *buffer) {
+    return ToFuture([&](IoCallback callback) { ReadPageAsync(page_id, buffer, std::move(callback)); });
+  }
+
+  std::future<void> WritePage(page_id_t page_id, const char *buffer) {
+    return ToFuture([&](IoCallback callback) { WritePageAsync(page_id, buffer, std::move(callback)); });
+  }
+
+  void SubmitBatch(std::vector<IoRequest> requests) { backend_->Submit(std::move(requests)); }
+
+  const char *BackendName() const { return backend_->Name(); }
+  int Fd() const { return file_.Fd(); }
+
+ private:
+  // 把回调接口包装成 future：promise 由回调持有（std::function 要求可拷贝，所以用 shared_ptr）。
+  template <typename SubmitFn>
+  static std::future<void> ToFuture(SubmitFn submit) {
+    auto promise = std::make_shared<std::promise<void>>();
+    std::future<void> future = promise->get_future();
+    submit([promise](int result) {
+      if (result < 0) {
+        promise->set_exception(std::make_exception_ptr(std::system_error(-result, std::generic_category(), "page io")));
+      } else if (result != static_cast<int>(kPageSize)) {
+        promise->set_exception(std::make_exception_ptr(std::runtime_error("short page io")));
+      } else {
+        promise->set_value();
+      }
+    });
+    return future;
+  }
+
+  // file_ 先于 backend_ 声明，因此 backend_ 先析构：后端停止之后才关闭文件。
+  FileHandle file_;
+  std::unique_ptr<IoBackend> backend_;
+};
+
+// 返回 values 的第 p 百分位数（按值传入，在副本上排序）。
+double Percentile(std::vector<double> values, double p) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  return values[static_cast<size_t>(p / 100 * (values.size() - 1))];
+}
+
+// 用批量写入创建一个 num_pages 页的文件，每页的前 4 字节是页号。
+void CreateFile(const std::string &path, size_t num_pages) {
+  DiskOptions options;
+  AsyncDiskManager disk(path, options);
+  const size_t batch = 64;
+  AlignedBuffer buffers = MakeAlignedBuffer(batch * kPageSize);
+  for (size_t first = 0; first < num_pages; first += batch) {
+    std::vector<std::future<void>> futures;
+    for (size_t i = first; i < std::min(num_pages, first + batch); i++) {
+      char *page = buffers.get() + (i - first) * kPageSize;
+      std::memset(page, 0, kPageSize);
+      std::memcpy(page, &i, sizeof(int32_t));
+      futures.push_back(disk.WritePage(static_cast<page_id_t>(i), page));
+    }
+    for (auto &f : futures) {
+      f.get();
+    }
+  }
+  fdatasync(disk.Fd());
+}
+
+// 闭环的随机 4K 读：始终保持 queue_depth 个读请求在途，一个完成后立即发出下一个。
+// 每个在途请求使用自己的对齐缓冲区（槽位），完成时检查读到的页号是否正确。
+void RunBench(const std::string &path, const DiskOptions &options, size_t num_pages, size_t total_reads) {
+  AsyncDiskManager disk(path, options);
+  unsigned depth = options.queue_depth_;
+  AlignedBuffer buffers = MakeAlignedBuffer(depth * kPageSize);
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<unsigned> free_slots;
+  for (unsigned s = 0; s < depth; s++) {
+    free_slots.push_back(s);
+  }
+  std::vector<double> latencies_us;
+  size_t errors = 0;
+  std::mt19937_64 rng(42);
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < total_reads; i++) {
+    unsigned slot;
+    {
+      std::unique_lock lk(mutex);
+      cv.wait(lk, [&] { return !free_slots.empty(); });
+      slot = free_slots.back();
+      free_slots.pop_back();
+    }
+    auto page_id = static_cast<page_id_t>(rng() % num_pages);
+    char *buffer = buffers.get() + slot * kPageSize;
+    auto issued = std::chrono::steady_clock::now();
+    disk.ReadPageAsync(page_id, buffer, [&, slot, page_id, buffer, issued](int result) {
+      double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - issued).count();
+      int32_t stored;
+      std::memcpy(&stored, buffer, sizeof(stored));
+      {
+        std::scoped_lock lk(mutex);
+        latencies_us.push_back(us);
+        errors += (result != static_cast<int>(kPageSize) || stored != page_id) ? 1 : 0;
+        free_slots.push_back(slot);
+      }
+      cv.notify_one();
+    });
+  }
+  {
+    std::unique_lock lk(mutex);
+    cv.wait(lk, [&] { return free_slots.size() == depth; });
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << "  " << disk.BackendName() << (options.direct_io_ ? " O_DIRECT" : " buffered") << " qd=" << depth
+            << ":\t" << total_reads / seconds / 1000 << " K IOPS, latency p50 " << Percentile(latencies_us, 50)
+            << " us, p99 " << Percentile(latencies_us, 99) << " us" << (errors > 0 ? ", READ ERRORS!" : "") << "\n";
+}
+
+// 用法：./async_disk_manager [数据文件路径] [页数] [每个配置的读次数]
+int main(int argc, char *argv[]) {
+  std::string path = argc > 1 ? argv[1] : "async_disk_manager.db";
+  size_t num_pages = argc > 2 ? std::stoul(argv[2]) : 16384;
+  size_t total_reads = argc > 3 ? std::stoul(argv[3]) : 10'000;
+
+  // 第一部分：写一个页，用 future 等待；再用回调读回来。
+  {
+    AsyncDiskManager disk(path, DiskOptions{});
+    std::cout << "Using backend: " << disk.BackendName() << std::endl;
+    AlignedBuffer page = MakeAlignedBuffer(kPageSize);
+    std::memset(page.get(), 0, kPageSize);
+    std::strcpy(page.get(), "Hello from page 3");
+    disk.WritePage(3, page.get()).get();
+
+    AlignedBuffer out = MakeAlignedBuffer(kPageSize);
+    std::promise<int> done;
+    disk.ReadPageAsync(3, out.get(), [&](int result) { done.set_value(result); });
+    int result = done.get_future().get();
+    std::cout << "Read " << result << " bytes from page 3: " << out.get() << std::endl;
+  }
+
+  // 第二部分：不同后端、是否使用 O_DIRECT、不同队列深度下的随机 4K 读。
+  // 非 O_DIRECT 的读大多命中页缓存，测到的主要是软件开销；O_DIRECT 的读才真正访问设备。
+  // 线程池后端默认只有 16 个线程，队列深度超过 16 时多出的请求在队列中排队。
+  std::cout << "Creating a " << num_pages * kPageSize / (1 << 20) << " MB file at " << path << std::endl;
+  CreateFile(path, num_pages);
+  for (bool direct_io : {false, true}) {
+    for (BackendKind backend : {BackendKind::kUring, BackendKind::kThreadPool}) {
+      for (unsigned depth : {1U, 4U, 16U, 64U}) {
+        DiskOptions options;
+        options.backend_ = backend;
+        options.direct_io_ = direct_io;
+        options.queue_depth_ = depth;
+        try {
+          RunBench(path, options, num_pages, total_reads);
+        } catch (const std::system_error &e) {
+          std::cout << "  skipped: " << e.what() << "\n";
+          break;
+        }
+      }
+    }
+  }
+  std::remove(path.c_str());
+  return 0;
+}
@@ -0,0 +1,527 @@
+/**
+ * @file background_io.cpp
+ * @brief 缓冲池的两个后台线程：按页号排序批量写回脏页的刷写线程（flusher），
+ *        以及识别顺序访问并提前读入后续页的预读线程（prefetcher）。两者都有速率限制和统计信息。
+ */
+
+// 在 buffer_pool.cpp 中，所有磁盘 I/O 都发生在前台：
+// - 淘汰脏页时，发起访问的线程必须先把脏页写回磁盘，才能复用这个页帧；
+// - 顺序扫描时，每读一个页都要等一次完整的磁盘延迟。
+// 本文件把这两件事交给后台线程，它们与前台线程之间用 condition_variable.cpp 中的方式交接工作：
+// 1. 刷写线程：定期醒来（或在脏页比例超过高水位时被前台唤醒），挑出一批未被 pin 的脏页，
+//    按页号排序后写回。排序使相邻的页可以合并成一次顺序写。这样前台淘汰时遇到的大多是干净页。
+// 2. 预读线程：前台每次访问都会更新一个简单的顺序访问检测器。连续访问了 kTrigger 个相邻页之后，
+//    检测器把接下来的一个窗口放入预读队列，预读线程把这些页用一次大的顺序读读入缓存。
+//    之后前台访问这些页时直接命中，而且被预读的页如果在被访问之前就被淘汰，就算作一次无效预读，
+//    由此可以算出预读准确率。
+// 两个后台线程都经过令牌桶（token bucket）限速，避免后台 I/O 挤占前台的磁盘带宽。
+// 磁盘用 SlowDisk 模拟：每个请求先睡眠固定的延迟，再按页数加上传输时间，所以合并请求是有收益的。
+
+// 包含 std::sort。
+#include <algorithm>
+// 包含 std::chrono（用于计时与模拟磁盘延迟）。
+#include <chrono>
+// 包含 std::condition_variable。
+#include <condition_variable>
+// 包含 std::memcpy。
+#include <cstring>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::unique_ptr。
+#include <memory>
+// 包含 std::mutex。
+#include <mutex>
+// 包含 std::queue（预读队列）。
+#include <queue>
+// 包含 std::mt19937_64（用于生成随机页号）。
+#include <random>
+// 包含 std::shared_mutex（页帧的读写锁）。
+#include <shared_mutex>
+// 包含 std::string（用于解析命令行参数）。
+#include <string>
+// 包含 thread 头文件。
+#include <thread>
+// 包含 std::unordered_map（页表）。
+#include <unordered_map>
+// 包含 std::pair。
+#include <utility>
+// 包含 std::vector。
+#include <vector>
+
+using page_id_t = int32_t;
+using frame_id_t = int32_t;
+
+constexpr size_t kPageSize = 4096;
+constexpr page_id_t kInvalidPageId = -1;
+
+// 模拟的磁盘。每个请求读写连续的 count 个页，耗时为 latency + count * transfer。
+// 多个请求可以同时进行（类似 SSD 的内部并行），只有拷贝数据时持有锁。
+class SlowDisk {
+ public:
+  SlowDisk(size_t num_pages, std::chrono::microseconds latency)
+      : data_(num_pages * kPageSize), num_pages_(num_pages), latency_(latency) {
+    for (size_t i = 0; i < num_pages; i++) {
+      auto id = static_cast<uint64_t>(i);
+      std::memcpy(&data_[i * kPageSize], &id, sizeof(id));
+    }
+  }
+
+  void Read(page_id_t first, size_t count, char *out) {
+    std::this_thread::sleep_for(latency_ + count * kTransfer);
+    std::scoped_lock lk(mutex_);
+    std::memcpy(out, &data_[first * kPageSize], count * kPageSize);
+  }
+
+  void Write(page_id_t first, size_t count, const char *in) {
+    std::this_thread::sleep_for(latency_ + count * kTransfer);
+    std::scoped_lock lk(mutex_);
+    std::memcpy(&data_[first * kPageSize], in, count * kPageSize);
+  }
+
+  size_t NumPages() const { return num_pages_; }
+
+ private:
+  static constexpr std::chrono::microseconds kTransfer{2};
+
+  std::mutex mutex_;
+  std::vector<char> data_;
+  size_t num_pages_;
+  std::chrono::microseconds latency_;
+};
+
+// 令牌桶限速器：每秒补充 rate 个令牌，最多积攒 burst 个。Acquire(n) 在令牌不足时睡眠等待。
+// 只被一个后台线程使用，因此不需要加锁。
+class RateLimiter {
+ public:
+  RateLimiter(double rate, double burst) : rate_(rate), burst_(burst), tokens_(burst) {}
+
+  void Acquire(size_t n) {
+    while (true) {
+      auto now = std::chrono::steady_clock::now();
+      tokens_ = std::min(burst_, tokens_ + std::chrono::duration<double>(now - last_).count() * rate_);
+      last_ = now;
+      if (tokens_ >= static_cast<double>(n)) {
+        tokens_ -= static_cast<double>(n);
+        return;
+      }
+      std::this_thread::sleep_for(std::chrono::duration<double>((n - tokens_) / rate_));
+    }
+  }
+
+ private:
+  double rate_;
+  double burst_;
+  double tokens_;
+  std::chrono::steady_clock::time_point last_{std::chrono::steady_clock::now()};
+};
+
+struct CacheOptions {
+  size_t num_frames_ = 256;
+  // 刷写线程：脏页超过 high_water 比例时被唤醒，否则每隔 flush_interval 醒来一次；每批最多 flush_batch 页。
+  bool background_flush_ = true;
+  double dirty_high_water_ = 0.1;
+  std::chrono::milliseconds flush_interval_{5};
+  size_t flush_batch_ = 64;
+  double flush_pages_per_second_ = 200'000;
+  // 预读线程：连续访问 read_ahead_trigger 个相邻页之后，预读接下来的 read_ahead_window 个页。
+  bool read_ahead_ = true;
+  size_t read_ahead_trigger_ = 4;
+  size_t read_ahead_window_ = 64;
+  double prefetch_pages_per_second_ = 200'000;
+};
+
+// 统计信息，由缓存的 mutex_ 保护。
+struct CacheStats {
+  uint64_t foreground_reads_{0};
+  uint64_t foreground_writebacks_{0};
+  uint64_t flushed_pages_{0};
+  uint64_t flush_batches_{0};
+  uint64_t prefetched_pages_{0};
+  uint64_t useful_prefetches_{0};
+  uint64_t wasted_prefetches_{0};
+};
+
+// 带后台刷写与预读的页缓存。mutex_ 保护页表与页帧的元数据；每个页帧的 latch_ 保护页的内容。
+// 淘汰策略使用 Clock（见 clock_replacer.cpp），pin 住的页帧和正在读入的页帧不会被淘汰。
+class BufferCache {
+ public:
+  BufferCache(SlowDisk *disk, const CacheOptions &options)
+      : disk_(disk), options_(options), frames_(options.num_frames_) {
+    for (size_t i = 0; i < frames_.size(); i++) {
+      frames_[i].data_ = std::make_unique<char[]>(kPageSize);
+      free_frames_.push_back(static_cast<frame_id_t>(i));
+    }
+    if (options_.background_flush_) {
+      flusher_ = std::thread([this] { FlusherLoop(); });
+    }
+    if (options_.read_ahead_) {
+      prefetcher_ = std::thread([this] { PrefetcherLoop(); });
+    }
+  }
+
+  ~BufferCache() {
+    {
+      std::scoped_lock lk(mutex_);
+      stop_ = true;
+    }
+    flush_cv_.notify_all();
+    prefetch_cv_.notify_all();
+    loaded_cv_.notify_all();
+    if (flusher_.joinable()) {
+      flusher_.join();
+    }
+    if (prefetcher_.joinable()) {
+      prefetcher_.join();
+    }
+  }
+
+  BufferCache(const BufferCache &) = delete;
+  BufferCache &operator=(const BufferCache &) = delete;
+
+  // 前台访问一个页：fn(char *data) 在持有页帧的读锁（write 为 true 时是写锁）时被调用。
+  template <typename Fn>
+  void Access(page_id_t page_id, bool write, Fn fn) {
+    std::unique_lock lk(mutex_);
+    ObserveAccess(page_id);
+    Frame *frame = nullptr;
+    while (frame == nullptr) {
+      auto it = page_table_.find(page_id);
+      if (it == page_table_.end()) {
+        // 缺页：占用一个页帧并标记为“正在读入”，在锁外读盘，其他访问同一页的线程会等待 loaded_cv_。
+        frame_id_t frame_id = ClaimFrame(&lk, page_id, false);
+        if (frame_id < 0) {
+          continue;
+        }
+        stats_.foreground_reads_ += 1;
+        lk.unlock();
+        disk_->Read(page_id, 1, frames_[frame_id].data_.get());
+        lk.lock();
+        frames_[frame_id].loading_ = false;
+        loaded_cv_.notify_all();
+      } else if (frames_[it->second].loading_) {
+        loaded_cv_.wait(lk);
+      } else {
+        frame = &frames_[it->second];
+      }
+    }
+
+    frame->pins_ += 1;
+    frame->referenced_ = true;
+    if (frame->prefetched_) {
+      frame->prefetched_ = false;
+      stats_.useful_prefetches_ += 1;
+    }
+    lk.unlock();
+    if (write) {
+      std::unique_lock latch(frame->latch_);
+      fn(frame->data_.get());
+    } else {
+      std::shared_lock latch(frame->latch_);
+      fn(frame->data_.get());
+    }
+    lk.lock();
+    frame->pins_ -= 1;
+    // 页帧变为可淘汰：唤醒在 ClaimFrame 中因所有页帧都被 pin 住而等待的线程。
+    if (frame->pins_ == 0) {
+      loaded_cv_.notify_all();
+    }
+    if (write && !frame->dirty_) {
+      frame->dirty_ = true;
+      dirty_count_ += 1;
+      // 脏页超过高水位时唤醒刷写线程，而不是等它下一次定时醒来。
+      if (dirty_count_ > options_.dirty_high_water_ * frames_.size()) {
+        flush_cv_.notify_one();
+      }
+    }
+  }
+
+  CacheStats GetStats() {
+    std::scoped_lock lk(mutex_);
+    return stats_;
+  }
+
+ private:
+  struct Frame {
+    std::shared_mutex latch_;
+    std::unique_ptr<char[]> data_;
+    page_id_t page_id_{kInvalidPageId};
+    int pins_{0};
+    bool loading_{false};
+    bool dirty_{false};
+    bool referenced_{false};
+    // 由预读线程读入、尚未被前台访问过。
+    bool prefetched_{false};
+  };
+
+  // 顺序访问检测器（只跟踪一条访问流）。调用者持有 mutex_。
+  // prefetch_until_ 是已经请求预读的页的上界；访问接近这个上界时再请求下一个窗口。
+  void ObserveAccess(page_id_t page_id) {
+    run_length_ = (page_id == last_access_ + 1) ? run_length_ + 1 : 1;
+    last_access_ = page_id;
+    if (run_length_ == 1) {
+      prefetch_until_ = page_id + 1;
+    }
+    if (!options_.read_ahead_ || run_length_ < options_.read_ahead_trigger_) {
+      return;
+    }
+    auto window = static_cast<page_id_t>(options_.read_ahead_window_);
+    if (page_id + window / 2 < prefetch_until_) {
+      return;
+    }
+    page_id_t first = std::max(prefetch_until_, page_id + 1);
+    page_id_t last = std::min(page_id + window, static_cast<page_id_t>(disk_->NumPages()));
+    if (first < last) {
+      prefetch_queue_.emplace(first, last);
+      prefetch_until_ = last;
+      prefetch_cv_.notify_one();
+    }
+  }
+
+  // 为 page_id 占用一个页帧：优先使用空闲页帧，否则用 Clock 淘汰一个。被淘汰的脏页由当前线程在前台写回
+  // （这正是刷写线程要避免的情况）。所有页帧都被 pin 住或正在读入时，等待 loaded_cv_（读入完成或
+  // 页帧 unpin 时通知）后返回 -1，由调用者重新检查页表。调用者持有 mutex_。
+  frame_id_t ClaimFrame(std::unique_lock<std::mutex> *lk, page_id_t page_id, bool prefetch) {
+    frame_id_t frame_id = -1;
+    if (!free_frames_.empty()) {
+      frame_id = free_frames_.back();
+      free_frames_.pop_back();
+    } else {
+      for (size_t step = 0; step < 2 * frames_.size() && frame_id < 0; step++) {
+        Frame &candidate = frames_[hand_];
+        auto current = static_cast<frame_id_t>(hand_);
+        hand_ = (hand_ + 1) % frames_.size();
+        if (candidate.pins_ > 0 || candidate.loading_) {
+          continue;
+        }
+        if (candidate.referenced_) {
+          candidate.referenced_ = false;
+          continue;
+        }
+        frame_id = current;
+      }
+      if (frame_id < 0) {
+        loaded_cv_.wait(*lk);
+        return -1;
+      }
+      Frame &victim = frames_[frame_id];
+      if (victim.dirty_) {
+        disk_->Write(victim.page_id_, 1, victim.data_.get());
+        victim.dirty_ = false;
+        dirty_count_ -= 1;
+        stats_.foreground_writebacks_ += 1;
+      }
+      if (victim.prefetched_) {
+        stats_.wasted_prefetches_ += 1;
+      }
+      page_table_.erase(victim.page_id_);
+    }
+    Frame &frame = frames_[frame_id];
+    frame.page_id_ = page_id;
+    frame.loading_ = true;
+    frame.referenced_ = prefetch;
+    frame.prefetched_ = prefetch;
+    page_table_[page_id] = frame_id;
+    return frame_id;
+  }
+
+  // 刷写线程：挑出未被 pin 的脏页，按页号排序，取前 flush_batch 个；先清除脏标记并 pin 住这些页
+  // （防止被淘汰），在锁外把相邻的页合并成一次写。写盘期间前台再次修改的页会重新变脏，下次再刷。
+  void FlusherLoop() {
+    RateLimiter limiter(options_.flush_pages_per_second_, static_cast<double>(options_.flush_batch_));
+    std::unique_lock lk(mutex_);
+    while (true) {
+      flush_cv_.wait_for(lk, options_.flush_interval_, [&] {
+        return stop_ || dirty_count_ > options_.dirty_high_water_ * frames_.size();
+      });
+      if (stop_) {
+        return;
+      }
+      std::vector<std::pair<page_id_t, frame_id_t>> batch;
+      for (size_t f = 0; f < frames_.size(); f++) {
+        if (frames_[f].dirty_ && frames_[f].pins_ == 0 && !frames_[f].loading_) {
+          batch.emplace_back(frames_[f].page_id_, static_cast<frame_id_t>(f));
+        }
+      }
+      if (batch.empty()) {
+        continue;
+      }
+      std::sort(batch.begin(), batch.end());
+      batch.resize(std::min(batch.size(), options_.flush_batch_));
+      for (auto &[page_id, frame_id] : batch) {
+        frames_[frame_id].dirty_ = false;
+        frames_[frame_id].pins_ += 1;
+        dirty_count_ -= 1;
+      }
+      lk.unlock();
+
+      limiter.Acquire(batch.size());
+      std::vector<char> buffer;
+      for (size_t i = 0; i < batch.size();) {
+        size_t j = i + 1;
+        while (j < batch.size() && batch[j].first == batch[j - 1].first + 1) {
+          j++;
+        }
+        buffer.resize((j - i) * kPageSize);
+        for (size_t k = i; k < j; k++) {
+          std::shared_lock latch(frames_[batch[k].second].latch_);
+          std::memcpy(&buffer[(k - i) * kPageSize], frames_[batch[k].second].data_.get(), kPageSize);
+        }
+        disk_->Write(batch[i].first, j - i, buffer.data());
+        i = j;
+      }
+
+      lk.lock();
+      for (auto &[page_id, frame_id] : batch) {
+        frames_[frame_id].pins_ -= 1;
+      }
+      stats_.flushed_pages_ += batch.size();
+      stats_.flush_batches_ += 1;
+      loaded_cv_.notify_all();
+    }
+  }
+
+  // 预读线程：取出一个页号区间，为其中还不在缓存中的页占用页帧，然后按连续的段读盘。
+  void PrefetcherLoop() {
+    RateLimiter limiter(options_.prefetch_pages_per_second_, static_cast<double>(options_.read_ahead_window_));
+    std::unique_lock lk(mutex_);
+    while (true) {
+      prefetch_cv_.wait(lk, [&] { return stop_ || !prefetch_queue_.empty(); });
+      if (stop_) {
+        return;
+      }
+      auto [first, last] = prefetch_queue_.front();
+      prefetch_queue_.pop();
+      std::vector<std::pair<page_id_t, frame_id_t>> claimed;
+      for (page_id_t page_id = first; page_id < last && !stop_; page_id++) {
+        if (page_table_.count(page_id) != 0) {
+          continue;
+        }
+        frame_id_t frame_id = ClaimFrame(&lk, page_id, true);
+        if (frame_id < 0) {
+          break;
+        }
+        claimed.emplace_back(page_id, frame_id);
+      }
+      if (claimed.empty()) {
+        continue;
+      }
+      lk.unlock();
+
+      limiter.Acquire(claimed.size());
+      std::vector<char> buffer;
+      for (size_t i = 0; i < claimed.size();) {
+        size_t j = i + 1;
+        while (j < claimed.size() && claimed[j].first == claimed[j - 1].first + 1) {
+          j++;
+        }
+        buffer.resize((j - i) * kPageSize);
+        disk_->Read(claimed[i].first, j - i, buffer.data());
+        for (size_t k = i; k < j; k++) {
+          std::memcpy(frames_[claimed[k].second].data_.get(), &buffer[(k - i) * kPageSize], kPageSize);
+        }
+        i = j;
+      }
+
+      lk.lock();
+      for (auto &[page_id, frame_id] : claimed) {
+        frames_[frame_id].loading_ = false;
+      }
+      stats_.prefetched_pages_ += claimed.size();
+      loaded_cv_.notify_all();
+    }
+  }
+
+  SlowDisk *disk_;
+  CacheOptions options_;
+  std::vector<Frame> frames_;
+
+  std::mutex mutex_;
+  std::condition_variable loaded_cv_;
+  std::condition_variable flush_cv_;
+  std::condition_variable prefetch_cv_;
+  std::unordered_map<page_id_t, frame_id_t> page_table_;
+  std::vector<frame_id_t> free_frames_;
+  size_t hand_{0};
+  size_t dirty_count_{0};
+  bool stop_{false};
+  CacheStats stats_;
+
+  page_id_t last_access_{kInvalidPageId};
+  size_t run_length_{0};
+  page_id_t prefetch_until_{0};
+  std::queue<std::pair<page_id_t, page_id_t>> prefetch_queue_;
+
+  std::thread flusher_;
+  std::thread prefetcher_;
+};
+
+// 页的前 8 字节是页号。扫描时检查它，确认读到的是正确的页。
+uint64_t PageHeader(const char *data) {
+  uint64_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+void PrintStats(const CacheStats &stats, double seconds) {
+  std::cout << "    foreground reads " << stats.foreground_reads_ << ", foreground write-backs "
+            << stats.foreground_writebacks_ << "\n    flushed " << stats.flushed_pages_ << " pages in "
+            << stats.flush_batches_ << " batches (" << stats.flushed_pages_ / seconds << " pages/s)"
+            << "\n    prefetched " << stats.prefetched_pages_ << " pages (" << stats.prefetched_pages_ / seconds
+            << " pages/s), accuracy "
+            << (stats.prefetched_pages_ == 0 ? 0.0 : 100.0 * stats.useful_prefetches_ / stats.prefetched_pages_)
+            << "%, wasted " << stats.wasted_prefetches_ << "\n";
+}
+
+// 顺序扫描所有页，检查页头，返回每秒扫描的页数。
+void BenchScan(const char *name, size_t num_pages, std::chrono::microseconds latency, const CacheOptions &options) {
+  SlowDisk disk(num_pages, latency);
+  BufferCache cache(&disk, options);
+  size_t errors = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t p = 0; p < num_pages; p++) {
+    cache.Access(static_cast<page_id_t>(p), false, [&](char *data) { errors += PageHeader(data) != p; });
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "  " << name << ": " << num_pages / seconds << " pages/s" << (errors > 0 ? ", WRONG PAGES!" : "")
+            << "\n";
+  PrintStats(cache.GetStats(), seconds);
+}
+
+// 随机更新：每次访问一个随机页并修改它，缓存放不下所有页，淘汰时常常遇到脏页。
+void BenchUpdates(const char *name, size_t num_pages, std::chrono::microseconds latency, const CacheOptions &options,
+                  size_t updates) {
+  SlowDisk disk(num_pages, latency);
+  BufferCache cache(&disk, options);
+  std::mt19937_64 rng(42);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < updates; i++) {
+    cache.Access(static_cast<page_id_t>(rng() % num_pages), true, [&](char *data) { data[8] += 1; });
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "  " << name << ": " << updates / seconds << " updates/s\n";
+  PrintStats(cache.GetStats(), seconds);
+}
+
+// 用法：./background_io [页数] [磁盘延迟（微秒）]
+int main(int argc, char *argv[]) {
+  size_t num_pages = argc > 1 ? std::stoul(argv[1]) : 2048;
+  std::chrono::microseconds latency(argc > 2 ? std::stoi(argv[2]) : 100);
+
+  // 第一部分：顺序扫描，有无预读的对比。
+  std::cout << "Sequential scan of " << num_pages << " pages, " << latency.count() << " us per disk request\n";
+  CacheOptions no_read_ahead;
+  no_read_ahead.read_ahead_ = false;
+  BenchScan("without read-ahead", num_pages, latency, no_read_ahead);
+  BenchScan("with read-ahead   ", num_pages, latency, CacheOptions{});
+
+  // 第二部分：随机更新，有无后台刷写的对比。
+  std::cout << "Random updates over " << num_pages / 2 << " pages\n";
+  CacheOptions no_flusher;
+  no_flusher.background_flush_ = false;
+  no_flusher.read_ahead_ = false;
+  CacheOptions flusher;
+  flusher.read_ahead_ = false;
+  BenchUpdates("without background flush", num_pages / 2, latency, no_flusher, num_pages);
+  BenchUpdates("with background flush   ", num_pages / 2, latency, flusher, num_pages);
+  return 0;
+}
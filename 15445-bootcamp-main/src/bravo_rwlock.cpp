@@ -0,0 +1,286 @@
+/**
+ * @file bravo_rwlock.cpp
+ * @brief 读者偏向（reader-biased）读写锁的教学示例：分片的读者计数器 + BRAVO 风格的偏向撤销。
+ */
+
+// 在 rwlock.cpp 中，read_value 通过 std::shared_lock 获取 std::shared_mutex 的共享锁。
+// 虽然多个读者可以同时持有共享锁，但每个读者在加锁和解锁时都要原子地修改 shared_mutex 内部
+// 同一个“读者计数”字段。这个字段所在的缓存行会在所有核之间来回传递（cache line bouncing），
+// 因此即使是纯读负载，吞吐在几个核之后也不再增长。
+
+// BRAVO（Biased Locking for Reader-Writer Locks, USENIX ATC 2019）的思路是：
+// 1. 锁处于“读者偏向”（rbias_ == true）时，读者不碰底层锁，只在自己的分片计数器上加 1。
+//    不同线程落在不同的缓存行上，所以读者之间没有争用。
+// 2. 写者到来时先获取底层锁，然后“撤销偏向”：把 rbias_ 置为 false，并等待所有分片计数器归零。
+// 3. 撤销偏向的代价很高（要扫描所有分片），因此撤销之后的一段时间内禁止重新开启偏向，
+//    这段时间与撤销耗时成正比。在此期间读者走慢路径，直接获取底层锁的共享锁。
+// 论文链接：https://www.usenix.org/conference/atc19/presentation/dice
+
+// BravoRWLock 实现了 lock/unlock/try_lock 与 lock_shared/unlock_shared/try_lock_shared，
+// 满足标准库的 SharedLockable 要求，因此可以直接与 std::shared_lock 和 std::unique_lock 一起使用。
+
+// 包含 std::array。
+#include <array>
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono（用于计时与偏向禁止期）。
+#include <chrono>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 mutex 头文件（std::unique_lock）。
+#include <mutex>
+// 包含 shared_mutex 头文件（底层锁以及对比基准）。
+#include <shared_mutex>
+// 包含 std::string 与 std::to_string。
+#include <string>
+// 包含 thread 头文件。
+#include <thread>
+// 包含 std::vector。
+#include <vector>
+
+class BravoRWLock {
+ public:
+  BravoRWLock() = default;
+  BravoRWLock(const BravoRWLock &) = delete;
+  BravoRWLock &operator=(const BravoRWLock &) = delete;
+
+  // 读者加锁。快路径：在本线程的分片上加 1，然后再次确认偏向仍然有效。
+  // 这里必须使用 seq_cst：读者“先加计数、后读 rbias_”，写者“先写 rbias_、后读计数”，
+  // 两者构成经典的 Dekker 模式，只有顺序一致性才能保证至少一方看到对方的写入。
+  void lock_shared() {
+    if (rbias_.load(std::memory_order_acquire)) {
+      Slot &slot = slots_[SlotIndex()];
+      slot.readers_.fetch_add(1, std::memory_order_seq_cst);
+      if (rbias_.load(std::memory_order_seq_cst) && PushFastRead()) {
+        return;
+      }
+      slot.readers_.fetch_sub(1, std::memory_order_release);
+    }
+    // 慢路径：直接获取底层锁的共享锁。如果禁止期已过，顺便重新开启读者偏向。
+    // 此时我们持有共享锁，不会有写者在撤销偏向，因此可以安全地设置 rbias_。
+    underlying_.lock_shared();
+    if (!rbias_.load(std::memory_order_relaxed) && Now() >= inhibit_until_.load(std::memory_order_relaxed)) {
+      rbias_.store(true, std::memory_order_release);
+    }
+  }
+
+  bool try_lock_shared() {
+    if (rbias_.load(std::memory_order_acquire)) {
+      Slot &slot = slots_[SlotIndex()];
+      slot.readers_.fetch_add(1, std::memory_order_seq_cst);
+      if (rbias_.load(std::memory_order_seq_cst) && PushFastRead()) {
+        return true;
+      }
+      slot.readers_.fetch_sub(1, std::memory_order_release);
+    }
+    return underlying_.try_lock_shared();
+  }
+
+  // 读者解锁。unlock_shared 没有参数，因此要靠线程局部的记录判断加锁时走的是哪条路径。
+  void unlock_shared() {
+    if (PopFastRead()) {
+      slots_[SlotIndex()].readers_.fetch_sub(1, std::memory_order_release);
+    } else {
+      underlying_.unlock_shared();
+    }
+  }
+
+  // 写者加锁：先获取底层独占锁（挡住慢路径读者和其他写者），再撤销读者偏向。
+  void lock() {
+    underlying_.lock();
+    if (rbias_.load(std::memory_order_relaxed)) {
+      RevokeBias();
+    }
+  }
+
+  // try_lock 不能无限期等待快路径读者离开：如果撤销后仍有读者，就恢复偏向并放弃。
+  bool try_lock() {
+    if (!underlying_.try_lock()) {
+      return false;
+    }
+    if (rbias_.load(std::memory_order_relaxed)) {
+      rbias_.store(false, std::memory_order_seq_cst);
+      for (auto &slot : slots_) {
+        if (slot.readers_.load(std::memory_order_acquire) != 0) {
+          rbias_.store(true, std::memory_order_release);
+          underlying_.unlock();
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  void unlock() { underlying_.unlock(); }
+
+  // 返回写者撤销偏向的次数，用于观察偏向禁止机制的效果。
+  uint64_t Revocations() const { return revocations_.load(std::memory_order_relaxed); }
+
+ private:
+  // 分片数量。每个分片独占一个缓存行，避免伪共享（false sharing）。
+  static constexpr size_t kNumSlots = 64;
+  // 撤销偏向后，禁止期 = 撤销耗时 * kInhibitMultiplier（论文中取 9）。
+  static constexpr int64_t kInhibitMultiplier = 9;
+  // 每个线程最多同时以快路径持有的 BravoRWLock 数量，超过后走慢路径。
+  static constexpr size_t kMaxFastReads = 8;
+
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> readers_{0};
+  };
+
+  // 线程局部的快路径记录：本线程以快路径持有了哪些锁。
+  struct FastReads {
+    std::array<const BravoRWLock *, kMaxFastReads> locks_{};
+    size_t size_{0};
+  };
+
+  static FastReads &ThreadFastReads() {
+    thread_local FastReads reads;
+    return reads;
+  }
+
+  bool PushFastRead() {
+    FastReads &reads = ThreadFastReads();
+    if (reads.size_ == kMaxFastReads) {
+      return false;
+    }
+    reads.locks_[reads.size_++] = this;
+    return true;
+  }
+
+  bool PopFastRead() {
+    FastReads &reads = ThreadFastReads();
+    for (size_t i = reads.size_; i > 0; i--) {
+      if (reads.locks_[i - 1] == this) {
+        reads.locks_[i - 1] = reads.locks_[reads.size_ - 1];
+        reads.size_ -= 1;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // 每个线程第一次使用时分配一个分片编号，之后一直使用同一个分片。
+  static size_t SlotIndex() {
+    static std::atomic<size_t> next_index{0};
+    thread_local size_t index = next_index.fetch_add(1, std::memory_order_relaxed) % kNumSlots;
+    return index;
+  }
+
+  static int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  // 撤销偏向：关闭 rbias_ 后等待所有快路径读者离开，并根据耗时设置禁止期。调用者持有底层独占锁。
+  void RevokeBias() {
+    int64_t start = Now();
+    rbias_.store(false, std::memory_order_seq_cst);
+    for (auto &slot : slots_) {
+      while (slot.readers_.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+      }
+    }
+    int64_t end = Now();
+    inhibit_until_.store(end + (end - start) * kInhibitMultiplier, std::memory_order_relaxed);
+    revocations_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  std::atomic<bool> rbias_{true};
+  std::atomic<int64_t> inhibit_until_{0};
+  std::atomic<uint64_t> revocations_{0};
+  std::shared_mutex underlying_;
+  std::array<Slot, kNumSlots> slots_;
+};
+
+// 与 rwlock.cpp 相同的例子，只是把 std::shared_mutex 换成了 BravoRWLock。
+// std::shared_lock 与 std::unique_lock 的用法完全不变。
+int count = 0;
+BravoRWLock m;
+
+void read_value() {
+  std::shared_lock lk(m);
+  std::cout << "Reading value " + std::to_string(count) + "\n" << std::flush;
+}
+
+void write_value() {
+  std::unique_lock lk(m);
+  count += 3;
+}
+
+// 保存读者读到的值，防止编译器把读操作优化掉。
+std::atomic<uint64_t> benchmark_sink{0};
+
+// 基准：threads 个线程在 duration 时间内反复加锁并读取（或写入）一个共享变量，
+// write_permille 表示每一千次操作中写操作的次数。返回每秒完成的操作数。
+template <typename Lock>
+double RunBench(int threads, int write_permille, std::chrono::milliseconds duration) {
+  Lock lock;
+  uint64_t value = 0;
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> total_ops{0};
+  std::vector<std::thread> workers;
+
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      uint64_t rng = 0x9E3779B97F4A7C15ULL * (t + 1);
+      uint64_t ops = 0;
+      uint64_t sink = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        // xorshift 伪随机数，决定这次是读还是写。
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        if (static_cast<int>(rng % 1000) < write_permille) {
+          std::unique_lock lk(lock);
+          value += 1;
+        } else {
+          std::shared_lock lk(lock);
+          sink += value;
+        }
+        ops += 1;
+      }
+      total_ops.fetch_add(ops);
+      benchmark_sink.fetch_add(sink, std::memory_order_relaxed);
+    });
+  }
+  std::this_thread::sleep_for(duration);
+  stop.store(true);
+  for (auto &w : workers) {
+    w.join();
+  }
+  return total_ops.load() / std::chrono::duration<double>(duration).count();
+}
+
+// 用法：./bravo_rwlock [最大线程数] [每个配置运行的毫秒数]
+int main(int argc, char *argv[]) {
+  int max_threads = argc > 1 ? std::stoi(argv[1]) : 64;
+  std::chrono::milliseconds duration(argc > 2 ? std::stoi(argv[2]) : 100);
+
+  // 第一部分：rwlock.cpp 的例子。
+  std::thread t1(read_value);
+  std::thread t2(write_value);
+  std::thread t3(read_value);
+  std::thread t4(read_value);
+  std::thread t5(write_value);
+  std::thread t6(read_value);
+  t1.join();
+  t2.join();
+  t3.join();
+  t4.join();
+  t5.join();
+  t6.join();
+
+  // 第二部分：纯读与 99/1 读写负载下的吞吐对比（单位：百万次操作每秒）。
+  for (int write_permille : {0, 10}) {
+    std::cout << (write_permille == 0 ? "read-only" : "99% read / 1% write") << " (Mops/s)\n";
+    std::cout << "threads\tstd::shared_mutex\tBravoRWLock\n";
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+      double baseline = RunBench<std::shared_mutex>(threads, write_permille, duration);
+      double bravo = RunBench<BravoRWLock>(threads, write_permille, duration);
+      std::cout << threads << "\t" << baseline / 1e6 << "\t\t\t" << bravo / 1e6 << "\n";
+    }
+  }
+  return 0;
+}
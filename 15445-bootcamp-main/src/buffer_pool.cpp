@@ -0,0 +1,710 @@
+/**
+ * @file buffer_pool.cpp
+ * @brief 缓冲池管理器（buffer pool manager）的教学示例：固定数量的页帧、页表、pin 计数、脏页跟踪、
+ *        可替换的淘汰策略（LRU、LRU-K、Clock）以及 RAII 的读/写页守卫（page guard）。
+ */
+
+// 面向磁盘的数据库把数据存放在固定大小的页（page）中，但只能在内存中读写页的内容。
+// 缓冲池在内存中维护固定数量的页帧（frame），每个页帧可以缓存一个磁盘页：
+// - 页表（page table）：page id 到 frame id 的映射，即 unordered_maps.cpp 中的 std::unordered_map。
+// - pin 计数：正在使用该页的线程数。pin 计数不为 0 的页不能被淘汰。
+// - 脏标记：页被修改过，淘汰前必须写回磁盘。
+// - 淘汰策略（replacer）：没有空闲页帧时，从 pin 计数为 0 的页帧中选一个淘汰。
+//   LRU 用 iterator.cpp 中 DLL 那样的双向链表维护访问顺序。
+// - 页守卫：与 wrapper_class.cpp 中的 IntPtrManager 一样的 RAII 包装类，构造时持有页的读/写锁
+//   （rwlock.cpp 中的 std::shared_mutex），析构时释放锁并 unpin，使用者不会忘记 unpin。
+
+// 本文件的并发设计与 CMU 15-445 的 BusTub 相同，刻意保持简单：
+// - 一把缓冲池级别的互斥锁 latch_ 保护页表、pin 计数、淘汰策略和空闲列表；
+//   缺页时的磁盘读写也在 latch_ 内完成（这会限制多线程下的扩展性，后续可以把 I/O 移到锁外）。
+// - 每个页帧有自己的读写锁，保护页的内容。页守卫先在 latch_ 内 pin 住页帧，释放 latch_ 之后
+//   才获取页帧的读写锁，所以等待页锁的线程不会挡住其他线程访问缓冲池。
+// 磁盘用内存中的数组模拟（MemoryDiskManager），只统计读写次数。
+
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 std::pow（用于生成 Zipfian 分布）。
+#include <cmath>
+// 包含 std::memcpy 与 std::memset。
+#include <cstring>
+// 包含 std::exit。
+#include <cstdlib>
+// 包含 std::deque（LRU-K 的访问历史）。
+#include <deque>
+// 包含 std::function（用于选择淘汰策略）。
+#include <functional>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::unique_ptr。
+#include <memory>
+// 包含 std::mutex。
+#include <mutex>
+// 包含 std::optional。
+#include <optional>
+// 包含 std::mt19937_64 等随机数工具。
+#include <random>
+// 包含 std::shared_mutex（页帧的读写锁）。
+#include <shared_mutex>
+// 包含 std::runtime_error。
+#include <stdexcept>
+// 包含 std::string（用于解析命令行参数）。
+#include <string>
+// 包含 thread 头文件。
+#include <thread>
+// 包含 std::unordered_map（页表）。
+#include <unordered_map>
+// 包含 std::vector。
+#include <vector>
+
+using page_id_t = int32_t;
+using frame_id_t = int32_t;
+
+constexpr size_t kPageSize = 4096;
+constexpr page_id_t kInvalidPageId = -1;
+
+// 用内存模拟的磁盘。每个页是一块 kPageSize 字节的内存；读写就是 memcpy，并统计次数。
+class MemoryDiskManager {
+ public:
+  page_id_t AllocatePage() {
+    std::scoped_lock lk(mutex_);
+    pages_.push_back(std::make_unique<char[]>(kPageSize));
+    return static_cast<page_id_t>(pages_.size() - 1);
+  }
+
+  void ReadPage(page_id_t page_id, char *out) {
+    std::scoped_lock lk(mutex_);
+    std::memcpy(out, pages_.at(page_id).get(), kPageSize);
+    reads_ += 1;
+  }
+
+  void WritePage(page_id_t page_id, const char *data) {
+    std::scoped_lock lk(mutex_);
+    std::memcpy(pages_.at(page_id).get(), data, kPageSize);
+    writes_ += 1;
+  }
+
+  uint64_t Reads() const { return reads_.load(); }
+  uint64_t Writes() const { return writes_.load(); }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<char[]>> pages_;
+  std::atomic<uint64_t> reads_{0};
+  std::atomic<uint64_t> writes_{0};
+};
+
+// 淘汰策略的接口。缓冲池在持有 latch_ 时调用这些函数，因此实现不需要自己加锁。
+// - RecordAccess：页帧被访问（pin）了一次。
+// - SetEvictable：pin 计数变为 0 时设为可淘汰，被 pin 住时设为不可淘汰。
+// - Evict：选出一个可淘汰的页帧并忘掉它的访问记录；没有可淘汰的页帧时返回 std::nullopt。
+class Replacer {
+ public:
+  virtual ~Replacer() = default;
+  virtual void RecordAccess(frame_id_t frame_id) = 0;
+  virtual void SetEvictable(frame_id_t frame_id, bool evictable) = 0;
+  virtual std::optional<frame_id_t> Evict() = 0;
+  // 可淘汰的页帧数。
+  virtual size_t Size() const = 0;
+};
+
+// LRU：用双向链表按访问时间排列页帧，表头是最近访问的，表尾是最久未访问的。
+// 页帧数量固定，所以链表节点就是页帧下标，prev_/next_ 数组代替了 DLL 中 Node 的两个指针。
+class LruReplacer : public Replacer {
+ public:
+  explicit LruReplacer(size_t num_frames)
+      : prev_(num_frames, kNone), next_(num_frames, kNone), in_list_(num_frames, false),
+        evictable_(num_frames, false) {}
+
+  void RecordAccess(frame_id_t frame_id) override {
+    if (in_list_[frame_id]) {
+      Unlink(frame_id);
+    }
+    PushFront(frame_id);
+  }
+
+  void SetEvictable(frame_id_t frame_id, bool evictable) override {
+    if (evictable_[frame_id] != evictable) {
+      evictable_[frame_id] = evictable;
+      size_ = evictable ? size_ + 1 : size_ - 1;
+    }
+  }
+
+  // 从表尾向表头找第一个可淘汰的页帧。
+  std::optional<frame_id_t> Evict() override {
+    for (frame_id_t f = tail_; f != kNone; f = prev_[f]) {
+      if (evictable_[f]) {
+        Unlink(f);
+        evictable_[f] = false;
+        size_ -= 1;
+        return f;
+      }
+    }
+    return std::nullopt;
+  }
+
+  size_t Size() const override { return size_; }
+
+ private:
+  static constexpr frame_id_t kNone = -1;
+
+  void PushFront(frame_id_t f) {
+    prev_[f] = kNone;
+    next_[f] = head_;
+    if (head_ != kNone) {
+      prev_[head_] = f;
+    } else {
+      tail_ = f;
+    }
+    head_ = f;
+    in_list_[f] = true;
+  }
+
+  void Unlink(frame_id_t f) {
+    if (prev_[f] != kNone) {
+      next_[prev_[f]] = next_[f];
+    } else {
+      head_ = next_[f];
+    }
+    if (next_[f] != kNone) {
+      prev_[next_[f]] = prev_[f];
+    } else {
+      tail_ = prev_[f];
+    }
+    in_list_[f] = false;
+  }
+
+  std::vector<frame_id_t> prev_;
+  std::vector<frame_id_t> next_;
+  std::vector<bool> in_list_;
+  std::vector<bool> evictable_;
+  frame_id_t head_{kNone};
+  frame_id_t tail_{kNone};
+  size_t size_{0};
+};
+
+// LRU-K（O'Neil et al., SIGMOD 1993）：淘汰“倒数第 K 次访问”最早的页帧，即后向 K 距离最大的页帧。
+// 访问次数不足 K 次的页帧的 K 距离视为无穷大，优先淘汰；它们之间按最早一次访问排序（退化为 LRU）。
+// 只被顺序扫描访问过一次的页不会挤掉被反复访问的热页，这是它比 LRU 更抗“顺序洪泛”的原因。
+// Evict 线性扫描所有页帧，对教学示例中的几百个页帧来说足够了。
+class LruKReplacer : public Replacer {
+ public:
+  LruKReplacer(size_t num_frames, size_t k) : k_(k), history_(num_frames), evictable_(num_frames, false) {}
+
+  void RecordAccess(frame_id_t frame_id) override {
+    auto &history = history_[frame_id];
+    history.push_back(++timestamp_);
+    if (history.size() > k_) {
+      history.pop_front();
+    }
+  }
+
+  void SetEvictable(frame_id_t frame_id, bool evictable) override {
+    if (evictable_[frame_id] != evictable) {
+      evictable_[frame_id] = evictable;
+      size_ = evictable ? size_ + 1 : size_ - 1;
+    }
+  }
+
+  std::optional<frame_id_t> Evict() override {
+    frame_id_t victim = -1;
+    bool victim_infinite = false;
+    uint64_t victim_timestamp = 0;
+    for (size_t f = 0; f < history_.size(); f++) {
+      if (!evictable_[f]) {
+        continue;
+      }
+      // 访问记录已满时 front() 是倒数第 K 次访问；不满时 front() 是最早一次访问。
+      bool infinite = history_[f].size() < k_;
+      uint64_t timestamp = history_[f].empty() ? 0 : history_[f].front();
+      bool better = victim == -1 || (infinite && !victim_infinite) ||
+                    (infinite == victim_infinite && timestamp < victim_timestamp);
+      if (better) {
+        victim = static_cast<frame_id_t>(f);
+        victim_infinite = infinite;
+        victim_timestamp = timestamp;
+      }
+    }
+    if (victim == -1) {
+      return std::nullopt;
+    }
+    history_[victim].clear();
+    evictable_[victim] = false;
+    size_ -= 1;
+    return victim;
+  }
+
+  size_t Size() const override { return size_; }
+
+ private:
+  size_t k_;
+  std::vector<std::deque<uint64_t>> history_;
+  std::vector<bool> evictable_;
+  uint64_t timestamp_{0};
+  size_t size_{0};
+};
+
+// Clock（二次机会）：每个页帧一个引用位，访问时置 1。时钟指针循环扫描页帧：
+// 引用位为 1 的清零并跳过（给它第二次机会），遇到引用位为 0 的可淘汰页帧就淘汰它。
+// 访问时只需置一个位，不用移动链表节点，是 LRU 的常用近似。
+class ClockReplacer : public Replacer {
+ public:
+  explicit ClockReplacer(size_t num_frames) : referenced_(num_frames, false), evictable_(num_frames, false) {}
+
+  void RecordAccess(frame_id_t frame_id) override { referenced_[frame_id] = true; }
+
+  void SetEvictable(frame_id_t frame_id, bool evictable) override {
+    if (evictable_[frame_id] != evictable) {
+      evictable_[frame_id] = evictable;
+      size_ = evictable ? size_ + 1 : size_ - 1;
+    }
+  }
+
+  // 只要存在可淘汰的页帧，最多扫描两圈就能找到一个（第一圈把引用位全部清零）。
+  std::optional<frame_id_t> Evict() override {
+    if (size_ == 0) {
+      return std::nullopt;
+    }
+    while (true) {
+      size_t f = hand_;
+      hand_ = (hand_ + 1) % evictable_.size();
+      if (!evictable_[f]) {
+        continue;
+      }
+      if (referenced_[f]) {
+        referenced_[f] = false;
+        continue;
+      }
+      evictable_[f] = false;
+      size_ -= 1;
+      return static_cast<frame_id_t>(f);
+    }
+  }
+
+  size_t Size() const override { return size_; }
+
+ private:
+  std::vector<bool> referenced_;
+  std::vector<bool> evictable_;
+  size_t hand_{0};
+  size_t size_{0};
+};
+
+// 一个页帧。data_ 是页的内容，rwlatch_ 保护 data_；其余字段由缓冲池的 latch_ 保护。
+struct Frame {
+  alignas(64) char data_[kPageSize];
+  std::shared_mutex rwlatch_;
+  frame_id_t frame_id_{0};
+  page_id_t page_id_{kInvalidPageId};
+  int pin_count_{0};
+  bool is_dirty_{false};
+};
+
+class BufferPoolManager;
+
+// 读页守卫：持有页的共享锁。与 IntPtrManager 一样不可拷贝、可移动，被移动后的对象不再持有任何资源。
+class ReadPageGuard {
+ public:
+  ReadPageGuard(BufferPoolManager *bpm, Frame *frame) : bpm_(bpm), frame_(frame) { frame_->rwlatch_.lock_shared(); }
+  ReadPageGuard(ReadPageGuard &&other) noexcept : bpm_(other.bpm_), frame_(other.frame_) { other.frame_ = nullptr; }
+  ReadPageGuard &operator=(ReadPageGuard &&other) noexcept {
+    if (this != &other) {
+      Drop();
+      bpm_ = other.bpm_;
+      frame_ = other.frame_;
+      other.frame_ = nullptr;
+    }
+    return *this;
+  }
+  ReadPageGuard(const ReadPageGuard &) = delete;
+  ReadPageGuard &operator=(const ReadPageGuard &) = delete;
+  ~ReadPageGuard() { Drop(); }
+
+  // 提前释放页锁并 unpin。之后析构函数什么也不做。
+  void Drop();
+
+  page_id_t PageId() const { return frame_->page_id_; }
+  const char *GetData() const { return frame_->data_; }
+
+ private:
+  BufferPoolManager *bpm_;
+  Frame *frame_;
+};
+
+// 写页守卫：持有页的独占锁。通过 GetDataMut 获取可写指针时把页标记为脏页。
+class WritePageGuard {
+ public:
+  WritePageGuard(BufferPoolManager *bpm, Frame *frame) : bpm_(bpm), frame_(frame) { frame_->rwlatch_.lock(); }
+  WritePageGuard(WritePageGuard &&other) noexcept : bpm_(other.bpm_), frame_(other.frame_), dirty_(other.dirty_) {
+    other.frame_ = nullptr;
+  }
+  WritePageGuard &operator=(WritePageGuard &&other) noexcept {
+    if (this != &other) {
+      Drop();
+      bpm_ = other.bpm_;
+      frame_ = other.frame_;
+      dirty_ = other.dirty_;
+      other.frame_ = nullptr;
+    }
+    return *this;
+  }
+  WritePageGuard(const WritePageGuard &) = delete;
+  WritePageGuard &operator=(const WritePageGuard &) = delete;
+  ~WritePageGuard() { Drop(); }
+
+  void Drop();
+
+  page_id_t PageId() const { return frame_->page_id_; }
+  const char *GetData() const { return frame_->data_; }
+  char *GetDataMut() {
+    dirty_ = true;
+    return frame_->data_;
+  }
+
+ private:
+  BufferPoolManager *bpm_;
+  Frame *frame_;
+  bool dirty_{false};
+};
+
+class BufferPoolManager {
+ public:
+  // 统计信息，由 latch_ 保护。
+  struct Stats {
+    uint64_t hits_{0};
+    uint64_t misses_{0};
+    uint64_t evictions_{0};
+    uint64_t dirty_writebacks_{0};
+  };
+
+  BufferPoolManager(size_t num_frames, MemoryDiskManager *disk, std::unique_ptr<Replacer> replacer)
+      : frames_(num_frames), disk_(disk), replacer_(std::move(replacer)) {
+    for (size_t i = 0; i < num_frames; i++) {
+      frames_[i].frame_id_ = static_cast<frame_id_t>(i);
+      free_list_.push_back(static_cast<frame_id_t>(i));
+    }
+  }
+
+  BufferPoolManager(const BufferPoolManager &) = delete;
+  BufferPoolManager &operator=(const BufferPoolManager &) = delete;
+
+  // 在磁盘上分配一个新页（内容全为 0），返回它的 page id。新页不会被立即读入缓冲池。
+  page_id_t NewPage() { return disk_->AllocatePage(); }
+
+  // 取得页的读/写守卫。所有页帧都被 pin 住、无法淘汰时抛出 std::runtime_error。
+  ReadPageGuard FetchPageRead(page_id_t page_id) { return ReadPageGuard(this, PinPage(page_id)); }
+  WritePageGuard FetchPageWrite(page_id_t page_id) { return WritePageGuard(this, PinPage(page_id)); }
+
+  // 把所有脏页写回磁盘。调用时不应有线程持有写守卫。
+  void FlushAllPages() {
+    std::scoped_lock lk(latch_);
+    for (Frame &frame : frames_) {
+      if (frame.page_id_ != kInvalidPageId && frame.is_dirty_) {
+        disk_->WritePage(frame.page_id_, frame.data_);
+        frame.is_dirty_ = false;
+      }
+    }
+  }
+
+  Stats GetStats() {
+    std::scoped_lock lk(latch_);
+    return stats_;
+  }
+
+ private:
+  friend class ReadPageGuard;
+  friend class WritePageGuard;
+
+  // 找到（必要时读入）页所在的页帧并把 pin 计数加 1。
+  Frame *PinPage(page_id_t page_id) {
+    std::scoped_lock lk(latch_);
+    auto it = page_table_.find(page_id);
+    if (it != page_table_.end()) {
+      Frame &frame = frames_[it->second];
+      frame.pin_count_ += 1;
+      replacer_->RecordAccess(frame.frame_id_);
+      replacer_->SetEvictable(frame.frame_id_, false);
+      stats_.hits_ += 1;
+      return &frame;
+    }
+
+    stats_.misses_ += 1;
+    Frame &frame = frames_[AcquireFrame()];
+    // 读盘失败（例如 page_id 从未分配）时，页帧已经离开了空闲链表与淘汰策略，必须放回空闲链表，否则会永久丢失。
+    try {
+      disk_->ReadPage(page_id, frame.data_);
+    } catch (...) {
+      frame.page_id_ = kInvalidPageId;
+      frame.is_dirty_ = false;
+      free_list_.push_back(frame.frame_id_);
+      throw;
+    }
+    frame.page_id_ = page_id;
+    frame.pin_count_ = 1;
+    frame.is_dirty_ = false;
+    page_table_[page_id] = frame.frame_id_;
+    replacer_->RecordAccess(frame.frame_id_);
+    replacer_->SetEvictable(frame.frame_id_, false);
+    return &frame;
+  }
+
+  // 取一个空闲页帧；没有空闲页帧时淘汰一个，脏页先写回磁盘。调用者持有 latch_。
+  frame_id_t AcquireFrame() {
+    if (!free_list_.empty()) {
+      frame_id_t frame_id = free_list_.back();
+      free_list_.pop_back();
+      return frame_id;
+    }
+    std::optional<frame_id_t> victim = replacer_->Evict();
+    if (!victim.has_value()) {
+      throw std::runtime_error("buffer pool is full: every frame is pinned");
+    }
+    Frame &frame = frames_[*victim];
+    if (frame.is_dirty_) {
+      disk_->WritePage(frame.page_id_, frame.data_);
+      stats_.dirty_writebacks_ += 1;
+    }
+    page_table_.erase(frame.page_id_);
+    stats_.evictions_ += 1;
+    return *victim;
+  }
+
+  // 页守卫析构时调用：记录脏标记，pin 计数减 1，减到 0 时允许淘汰。
+  void UnpinPage(Frame *frame, bool dirty) {
+    std::scoped_lock lk(latch_);
+    frame->is_dirty_ = frame->is_dirty_ || dirty;
+    frame->pin_count_ -= 1;
+    if (frame->pin_count_ == 0) {
+      replacer_->SetEvictable(frame->frame_id_, true);
+    }
+  }
+
+  std::vector<Frame> frames_;
+  MemoryDiskManager *disk_;
+  std::unique_ptr<Replacer> replacer_;
+  std::mutex latch_;
+  std::unordered_map<page_id_t, frame_id_t> page_table_;
+  std::vector<frame_id_t> free_list_;
+  Stats stats_;
+};
+
+// 先释放页锁，再 unpin：unpin 之后页帧可能立即被淘汰并装入别的页。
+void ReadPageGuard::Drop() {
+  if (frame_ != nullptr) {
+    frame_->rwlatch_.unlock_shared();
+    bpm_->UnpinPage(frame_, false);
+    frame_ = nullptr;
+  }
+}
+
+void WritePageGuard::Drop() {
+  if (frame_ != nullptr) {
+    frame_->rwlatch_.unlock();
+    bpm_->UnpinPage(frame_, dirty_);
+    frame_ = nullptr;
+  }
+}
+
+// 自检失败时打印信息并以非零状态退出。
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::cout << "CHECK FAILED: " << what << std::endl;
+    std::exit(1);
+  }
+}
+
+// 每个页的前 8 字节保存自己的 page id，之后 8 字节是一个写计数器。读取时可以据此检查读到的是不是正确的页。
+uint64_t ReadHeader(const char *data) {
+  uint64_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+void WriteHeader(char *data, uint64_t value) { std::memcpy(data, &value, sizeof(value)); }
+
+// Zipfian 分布的随机数生成器（Gray et al., "Quickly Generating Billion-Record Synthetic Databases", 1994，
+// YCSB 使用同样的方法）。第 i 个页被访问的概率与 1 / (i + 1)^theta 成正比，theta 越大越集中。
+// 构造后只读，可以被多个线程共享；每个线程使用自己的随机数引擎。
+class ZipfianGenerator {
+ public:
+  ZipfianGenerator(uint64_t n, double theta) : n_(n), theta_(theta) {
+    double zeta2 = Zeta(2, theta);
+    zeta_n_ = Zeta(n, theta);
+    alpha_ = 1.0 / (1.0 - theta);
+    eta_ = (1 - std::pow(2.0 / n, 1 - theta)) / (1 - zeta2 / zeta_n_);
+  }
+
+  uint64_t Next(std::mt19937_64 &rng) const {
+    double u = std::uniform_real_distribution<double>(0, 1)(rng);
+    double uz = u * zeta_n_;
+    if (uz < 1) {
+      return 0;
+    }
+    if (uz < 1 + std::pow(0.5, theta_)) {
+      return 1;
+    }
+    return std::min(n_ - 1, static_cast<uint64_t>(n_ * std::pow(eta_ * u - eta_ + 1, alpha_)));
+  }
+
+ private:
+  static double Zeta(uint64_t n, double theta) {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; i++) {
+      sum += 1 / std::pow(static_cast<double>(i), theta);
+    }
+    return sum;
+  }
+
+  uint64_t n_;
+  double theta_;
+  double zeta_n_;
+  double alpha_;
+  double eta_;
+};
+
+// 创建 num_pages 个页，并在每个页的头部写入 page id。
+void LoadPages(BufferPoolManager *bpm, size_t num_pages) {
+  for (size_t i = 0; i < num_pages; i++) {
+    page_id_t page_id = bpm->NewPage();
+    WritePageGuard guard = bpm->FetchPageWrite(page_id);
+    WriteHeader(guard.GetDataMut(), page_id);
+  }
+  bpm->FlushAllPages();
+}
+
+// 单线程下的语义演示与检查：缓冲池只有 3 个页帧。
+void CheckSemantics() {
+  MemoryDiskManager disk;
+  BufferPoolManager bpm(3, &disk, std::make_unique<LruReplacer>(3));
+  LoadPages(&bpm, 5);
+
+  {
+    // 3 个页帧全部被 pin 住时，再取第 4 个页会失败。
+    ReadPageGuard g0 = bpm.FetchPageRead(0);
+    ReadPageGuard g1 = bpm.FetchPageRead(1);
+    WritePageGuard g2 = bpm.FetchPageWrite(2);
+    WriteHeader(g2.GetDataMut() + 8, 445);
+    bool threw = false;
+    try {
+      bpm.FetchPageRead(3);
+    } catch (const std::runtime_error &e) {
+      std::cout << "Fetching a 4th page with 3 pinned frames throws: " << e.what() << std::endl;
+      threw = true;
+    }
+    Check(threw, "fetch fails when every frame is pinned");
+    Check(ReadHeader(g0.GetData()) == 0 && ReadHeader(g1.GetData()) == 1, "pages hold their own ids");
+    // 守卫可以移动，移动后由新对象负责释放。
+    ReadPageGuard moved = std::move(g0);
+    Check(ReadHeader(moved.GetData()) == 0, "moved guard still sees the page");
+  }
+
+  // 守卫全部析构后，页 2 已经是脏页；读入页 3、4 会淘汰它，并把修改写回磁盘。
+  uint64_t writes_before = disk.Writes();
+  { ReadPageGuard g3 = bpm.FetchPageRead(3); }
+  { ReadPageGuard g4 = bpm.FetchPageRead(4); }
+  { ReadPageGuard g0 = bpm.FetchPageRead(0); }
+  ReadPageGuard g2 = bpm.FetchPageRead(2);
+  Check(ReadHeader(g2.GetData() + 8) == 445, "dirty page survives eviction");
+  Check(disk.Writes() > writes_before, "evicting a dirty page writes it back");
+
+  // 读取从未分配的页会抛出异常，但占用的页帧要还回来：失败 3 次之后 3 个页帧仍然都能用。
+  for (int i = 0; i < 3; i++) {
+    try {
+      bpm.FetchPageRead(99);
+    } catch (const std::out_of_range &) {
+    }
+  }
+  {
+    ReadPageGuard g0 = bpm.FetchPageRead(0);
+    ReadPageGuard g1 = bpm.FetchPageRead(1);
+    Check(ReadHeader(g0.GetData()) == 0 && ReadHeader(g1.GetData()) == 1, "a failed read does not leak its frame");
+  }
+  BufferPoolManager::Stats stats = bpm.GetStats();
+  std::cout << "3-frame pool after the demo: " << stats.hits_ << " hits, " << stats.misses_ << " misses, "
+            << stats.evictions_ << " evictions, " << stats.dirty_writebacks_ << " dirty write-backs" << std::endl;
+}
+
+// 保存读到的数据，防止编译器把读取优化掉。
+std::atomic<uint64_t> benchmark_sink{0};
+
+enum class Workload { kScan, kZipfian };
+
+// threads 个线程共执行 total_ops 次页访问，其中 10% 是写访问。
+// kScan：每个线程从不同的位置开始顺序地循环扫描所有页。kZipfian：按 Zipfian 分布（theta = 0.99）随机访问。
+void RunBench(const char *replacer_name, const std::function<std::unique_ptr<Replacer>(size_t)> &make_replacer,
+              Workload workload, size_t num_frames, size_t num_pages, int threads, size_t total_ops) {
+  MemoryDiskManager disk;
+  BufferPoolManager bpm(num_frames, &disk, make_replacer(num_frames));
+  LoadPages(&bpm, num_pages);
+  BufferPoolManager::Stats before = bpm.GetStats();
+  uint64_t reads_before = disk.Reads();
+  ZipfianGenerator zipf(num_pages, 0.99);
+
+  std::vector<std::thread> workers;
+  auto start = std::chrono::steady_clock::now();
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      std::mt19937_64 rng(t + 1);
+      size_t next = num_pages * t / threads;
+      uint64_t sink = 0;
+      for (size_t i = 0; i < total_ops / threads; i++) {
+        page_id_t page_id;
+        if (workload == Workload::kScan) {
+          page_id = static_cast<page_id_t>(next);
+          next = (next + 1) % num_pages;
+        } else {
+          page_id = static_cast<page_id_t>(zipf.Next(rng));
+        }
+        if (i % 10 == 0) {
+          WritePageGuard guard = bpm.FetchPageWrite(page_id);
+          char *data = guard.GetDataMut();
+          WriteHeader(data + 8, ReadHeader(data + 8) + 1);
+        } else {
+          ReadPageGuard guard = bpm.FetchPageRead(page_id);
+          Check(ReadHeader(guard.GetData()) == static_cast<uint64_t>(page_id), "fetched the requested page");
+          sink += ReadHeader(guard.GetData() + 8);
+        }
+      }
+      benchmark_sink.fetch_add(sink, std::memory_order_relaxed);
+    });
+  }
+  for (auto &w : workers) {
+    w.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  BufferPoolManager::Stats stats = bpm.GetStats();
+  uint64_t hits = stats.hits_ - before.hits_;
+  uint64_t accesses = hits + stats.misses_ - before.misses_;
+  std::cout << "  " << (workload == Workload::kScan ? "scan   " : "zipfian") << " " << replacer_name << " threads="
+            << threads << ":\t" << accesses / seconds / 1e6 << " M fetches/s, hit rate " << 100.0 * hits / accesses
+            << "%, disk reads " << disk.Reads() - reads_before << "\n";
+}
+
+// 用法：./buffer_pool [最大线程数] [页帧数] [页数] [每个配置的访问次数]
+int main(int argc, char *argv[]) {
+  int max_threads = argc > 1 ? std::stoi(argv[1]) : 32;
+  size_t num_frames = argc > 2 ? std::stoul(argv[2]) : 256;
+  size_t num_pages = argc > 3 ? std::stoul(argv[3]) : 1024;
+  size_t total_ops = argc > 4 ? std::stoul(argv[4]) : 200'000;
+
+  // 第一部分：pin、守卫、淘汰与脏页写回的语义。
+  CheckSemantics();
+
+  // 第二部分：三种淘汰策略在两种负载、不同线程数下的吞吐量与命中率。
+  std::cout << num_frames << " frames, " << num_pages << " pages, " << total_ops << " fetches per run\n";
+  std::vector<std::pair<const char *, std::function<std::unique_ptr<Replacer>(size_t)>>> replacers = {
+      {"LRU  ", [](size_t n) { return std::make_unique<LruReplacer>(n); }},
+      {"LRU-2", [](size_t n) { return std::make_unique<LruKReplacer>(n, 2); }},
+      {"Clock", [](size_t n) { return std::make_unique<ClockReplacer>(n); }},
+  };
+  for (Workload workload : {Workload::kScan, Workload::kZipfian}) {
+    for (auto &[name, make_replacer] : replacers) {
+      for (int threads = 1; threads <= max_threads; threads *= 2) {
+        RunBench(name, make_replacer, workload, num_frames, num_pages, threads, total_ops);
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,351 @@
+/**
+ * @file clock_replacer.cpp
+ * @brief 访问路径无锁的 Clock（二次机会）淘汰策略，与基于双向链表、每次访问都要加锁的 LRU 对比。
+ */
+
+// 用 iterator.cpp 中的 DLL 实现 LRU 时，每次命中都要把节点移动到链表头部。链表的头指针被所有线程修改，
+// 所以每次命中都必须先获取一把全局锁（latch）。在多核机器上，缓冲池命中是最频繁的操作，
+// 这把锁和链表头所在的缓存行会成为瓶颈：线程越多，每次命中越慢。
+
+// Clock 是 LRU 的近似：
+// - 每个页帧有一个引用位。命中时只需把它置 1，这是一个普通的原子写，不需要任何锁。
+//   先读再写（已经是 1 就不写）可以避免热门页帧的缓存行在各个核心之间来回传递。
+// - 需要淘汰时，时钟指针依次扫描页帧：引用位为 1 的清零并跳过（给它第二次机会），
+//   遇到引用位为 0 的可淘汰页帧就淘汰它。淘汰远比命中少见，扫描由一把单独的锁串行化，不影响命中路径。
+// 代价是 Clock 只记录“最近是否被访问过”，而不是精确的访问顺序，命中率一般略低于 LRU。
+// 注意：在完整的缓冲池中，淘汰与并发命中之间的竞争由页表与 pin 计数来处理（见 buffer_pool.cpp），
+// 这里只比较淘汰策略本身。
+
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 std::pow（用于生成 Zipfian 分布）。
+#include <cmath>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::unique_ptr。
+#include <memory>
+// 包含 std::mutex。
+#include <mutex>
+// 包含 std::optional。
+#include <optional>
+// 包含 std::mt19937_64 等随机数工具。
+#include <random>
+// 包含 std::string（用于解析命令行参数）。
+#include <string>
+// 包含 thread 头文件。
+#include <thread>
+// 包含 std::unordered_map（模拟页表）。
+#include <unordered_map>
+// 包含 std::vector。
+#include <vector>
+
+using frame_id_t = int32_t;
+
+// Clock 淘汰策略。RecordAccess 与 SetEvictable 可以被任意多个线程并发调用且不加锁；
+// Evict 持有 hand_mutex_，同一时刻只有一个线程移动时钟指针。
+// 与 buffer_pool.cpp 中 Replacer 接口的约定一样，Evict 会清除被淘汰页帧的可淘汰标记，
+// 调用者装入新页并 unpin 后再调用 SetEvictable(frame_id, true)。
+class ClockReplacer {
+ public:
+  explicit ClockReplacer(size_t num_frames)
+      : referenced_(std::make_unique<std::atomic<uint8_t>[]>(num_frames)),
+        evictable_(std::make_unique<std::atomic<uint8_t>[]>(num_frames)),
+        num_frames_(num_frames) {
+    for (size_t i = 0; i < num_frames; i++) {
+      referenced_[i].store(0, std::memory_order_relaxed);
+      evictable_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // 命中路径：引用位已经是 1 时只读不写，缓存行可以在多个核心上保持共享状态。
+  void RecordAccess(frame_id_t frame_id) {
+    if (referenced_[frame_id].load(std::memory_order_relaxed) == 0) {
+      referenced_[frame_id].store(1, std::memory_order_relaxed);
+    }
+  }
+
+  void SetEvictable(frame_id_t frame_id, bool evictable) {
+    evictable_[frame_id].store(evictable ? 1 : 0, std::memory_order_relaxed);
+  }
+
+  // 最多扫描两圈：第一圈把所有引用位清零，第二圈一定能找到可淘汰的页帧（如果存在的话）。
+  // 选中的页帧用 CAS 把可淘汰标记从 1 清成 0：如果另一个线程刚好调用了 SetEvictable(f, false)，CAS 失败，继续扫描。
+  std::optional<frame_id_t> Evict() {
+    std::scoped_lock lk(hand_mutex_);
+    for (size_t step = 0; step < 2 * num_frames_; step++) {
+      size_t f = hand_;
+      hand_ = (hand_ + 1) % num_frames_;
+      if (evictable_[f].load(std::memory_order_relaxed) == 0) {
+        continue;
+      }
+      if (referenced_[f].load(std::memory_order_relaxed) != 0) {
+        referenced_[f].store(0, std::memory_order_relaxed);
+        continue;
+      }
+      uint8_t expected = 1;
+      if (evictable_[f].compare_exchange_strong(expected, 0, std::memory_order_relaxed)) {
+        return static_cast<frame_id_t>(f);
+      }
+    }
+    return std::nullopt;
+  }
+
+ private:
+  // 每个页帧一个字节。字节比位图更适合并发写：置位不需要对整个 64 位字做原子的读-改-写。
+  std::unique_ptr<std::atomic<uint8_t>[]> referenced_;
+  std::unique_ptr<std::atomic<uint8_t>[]> evictable_;
+  size_t num_frames_;
+  std::mutex hand_mutex_;
+  size_t hand_{0};
+};
+
+// 链表节点，与 iterator.cpp 中的 Node 相同，只是值换成了页帧编号。
+struct LruNode {
+  LruNode *next_{nullptr};
+  LruNode *prev_{nullptr};
+  frame_id_t frame_id_{0};
+  bool evictable_{false};
+};
+
+// 用双向链表实现的 LRU：表头是最近访问的页帧，表尾是最久未访问的页帧。
+// 每个页帧对应一个预先分配好的节点，head_/tail_ 是哨兵节点，省去空指针判断。
+// 所有操作（包括命中路径）都持有 latch_。
+class LruListReplacer {
+ public:
+  explicit LruListReplacer(size_t num_frames) : nodes_(num_frames) {
+    head_.next_ = &tail_;
+    tail_.prev_ = &head_;
+    for (size_t i = 0; i < num_frames; i++) {
+      nodes_[i].frame_id_ = static_cast<frame_id_t>(i);
+      InsertAfter(&head_, &nodes_[i]);
+    }
+  }
+
+  // 命中路径：加锁，把节点移到表头。
+  void RecordAccess(frame_id_t frame_id) {
+    std::scoped_lock lk(latch_);
+    LruNode *node = &nodes_[frame_id];
+    Unlink(node);
+    InsertAfter(&head_, node);
+  }
+
+  void SetEvictable(frame_id_t frame_id, bool evictable) {
+    std::scoped_lock lk(latch_);
+    nodes_[frame_id].evictable_ = evictable;
+  }
+
+  // 从表尾向表头找第一个可淘汰的页帧，并清除它的可淘汰标记。
+  std::optional<frame_id_t> Evict() {
+    std::scoped_lock lk(latch_);
+    for (LruNode *node = tail_.prev_; node != &head_; node = node->prev_) {
+      if (node->evictable_) {
+        node->evictable_ = false;
+        return node->frame_id_;
+      }
+    }
+    return std::nullopt;
+  }
+
+ private:
+  static void Unlink(LruNode *node) {
+    node->prev_->next_ = node->next_;
+    node->next_->prev_ = node->prev_;
+  }
+
+  static void InsertAfter(LruNode *pos, LruNode *node) {
+    node->prev_ = pos;
+    node->next_ = pos->next_;
+    pos->next_->prev_ = node;
+    pos->next_ = node;
+  }
+
+  std::mutex latch_;
+  std::vector<LruNode> nodes_;
+  LruNode head_;
+  LruNode tail_;
+};
+
+// Zipfian 分布的随机数生成器（Gray et al. 1994，YCSB 使用同样的方法）。构造后只读，可以被多个线程共享。
+class ZipfianGenerator {
+ public:
+  ZipfianGenerator(uint64_t n, double theta) : n_(n), theta_(theta) {
+    double zeta2 = Zeta(2, theta);
+    zeta_n_ = Zeta(n, theta);
+    alpha_ = 1.0 / (1.0 - theta);
+    eta_ = (1 - std::pow(2.0 / n, 1 - theta)) / (1 - zeta2 / zeta_n_);
+  }
+
+  uint64_t Next(std::mt19937_64 &rng) const {
+    double u = std::uniform_real_distribution<double>(0, 1)(rng);
+    double uz = u * zeta_n_;
+    if (uz < 1) {
+      return 0;
+    }
+    if (uz < 1 + std::pow(0.5, theta_)) {
+      return 1;
+    }
+    return std::min(n_ - 1, static_cast<uint64_t>(n_ * std::pow(eta_ * u - eta_ + 1, alpha_)));
+  }
+
+ private:
+  static double Zeta(uint64_t n, double theta) {
+    double sum = 0;
+    for (uint64_t i = 1; i <= n; i++) {
+      sum += 1 / std::pow(static_cast<double>(i), theta);
+    }
+    return sum;
+  }
+
+  uint64_t n_;
+  double theta_;
+  double zeta_n_;
+  double alpha_;
+  double eta_;
+};
+
+// 用淘汰策略模拟一个 num_frames 页帧的缓存，回放页号序列 trace，返回命中率。
+// 没有 pin：Evict 清除了被淘汰页帧的可淘汰标记，装入新页后立即重新标记为可淘汰。只比较淘汰策略的选择。
+template <typename Replacer>
+double SimulateHitRate(size_t num_frames, const std::vector<uint32_t> &trace) {
+  Replacer replacer(num_frames);
+  std::unordered_map<uint32_t, frame_id_t> page_table;
+  std::vector<uint32_t> frame_to_page(num_frames);
+  size_t hits = 0;
+  for (uint32_t page : trace) {
+    auto it = page_table.find(page);
+    if (it != page_table.end()) {
+      hits += 1;
+      replacer.RecordAccess(it->second);
+      continue;
+    }
+    frame_id_t frame;
+    if (page_table.size() < num_frames) {
+      frame = static_cast<frame_id_t>(page_table.size());
+    } else {
+      frame = *replacer.Evict();
+      page_table.erase(frame_to_page[frame]);
+    }
+    page_table[page] = frame;
+    frame_to_page[frame] = page;
+    replacer.RecordAccess(frame);
+    replacer.SetEvictable(frame, true);
+  }
+  return 100.0 * hits / trace.size();
+}
+
+// 生成三种常见的访问序列。num_pages 是数据库中的页数。
+// - zipfian：Zipfian(0.99) 随机访问，少数热页占了大部分访问。
+// - zipfian + scans：80% 的访问按 Zipfian(0.8) 分布，其间穿插长度为 num_pages / 4 的顺序扫描，
+//   扫描会把只访问一次的页冲进缓存（顺序洪泛）。
+// - loop：反复顺序扫描 1.2 倍缓存大小的页，LRU 在这种负载下每次都不命中。
+std::vector<uint32_t> MakeTrace(const std::string &kind, size_t num_pages, size_t num_frames, size_t length) {
+  std::mt19937_64 rng(7);
+  std::vector<uint32_t> trace;
+  trace.reserve(length);
+  if (kind == "zipfian") {
+    ZipfianGenerator zipf(num_pages, 0.99);
+    while (trace.size() < length) {
+      trace.push_back(static_cast<uint32_t>(zipf.Next(rng)));
+    }
+  } else if (kind == "zipfian + scans") {
+    ZipfianGenerator zipf(num_pages, 0.8);
+    while (trace.size() < length) {
+      if (rng() % 5000 == 0) {
+        uint32_t start = static_cast<uint32_t>(rng() % num_pages);
+        for (size_t i = 0; i < num_pages / 4 && trace.size() < length; i++) {
+          trace.push_back(static_cast<uint32_t>((start + i) % num_pages));
+        }
+      } else {
+        trace.push_back(static_cast<uint32_t>(zipf.Next(rng)));
+      }
+    }
+  } else {
+    size_t loop = num_frames * 6 / 5;
+    while (trace.size() < length) {
+      trace.push_back(static_cast<uint32_t>(trace.size() % loop));
+    }
+  }
+  return trace;
+}
+
+// 保存结果，防止编译器把循环优化掉。
+std::atomic<uint64_t> benchmark_sink{0};
+
+// 命中路径吞吐量：threads 个线程按 Zipfian 分布不停地对页帧调用 RecordAccess。
+// 每个线程预先生成好页帧序列，计时部分只包含 RecordAccess 本身。
+template <typename Replacer>
+double HitPathOpsPerSecond(size_t num_frames, int threads, size_t ops_per_thread) {
+  Replacer replacer(num_frames);
+  ZipfianGenerator zipf(num_frames, 0.99);
+  std::vector<std::vector<frame_id_t>> sequences(threads);
+  for (int t = 0; t < threads; t++) {
+    std::mt19937_64 rng(t + 1);
+    for (size_t i = 0; i < 4096; i++) {
+      sequences[t].push_back(static_cast<frame_id_t>(zipf.Next(rng)));
+    }
+  }
+
+  std::atomic<bool> go{false};
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      const std::vector<frame_id_t> &sequence = sequences[t];
+      for (size_t i = 0; i < ops_per_thread; i++) {
+        replacer.RecordAccess(sequence[i % sequence.size()]);
+      }
+      benchmark_sink.fetch_add(1, std::memory_order_relaxed);
+    });
+  }
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto &w : workers) {
+    w.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return threads * ops_per_thread / seconds;
+}
+
+// 用法：./clock_replacer [最大线程数] [每个线程的命中次数]
+int main(int argc, char *argv[]) {
+  int max_threads = argc > 1 ? std::stoi(argv[1]) : 64;
+  size_t ops_per_thread = argc > 2 ? std::stoul(argv[2]) : 200'000;
+  const size_t num_frames = 1024;
+  const size_t num_pages = 8192;
+
+  // 第一部分：Clock 的二次机会。4 个页帧，访问页帧 1 和 3 之后，时钟指针跳过它们，淘汰页帧 0。
+  ClockReplacer clock(4);
+  for (frame_id_t f = 0; f < 4; f++) {
+    clock.SetEvictable(f, true);
+  }
+  clock.RecordAccess(1);
+  clock.RecordAccess(3);
+  std::cout << "Clock evicts frame " << *clock.Evict() << ", then frame " << *clock.Evict() << std::endl;
+  // 被淘汰的页帧不再可淘汰，不会被重复选中：再淘汰两次之后就没有可淘汰的页帧了。
+  clock.Evict();
+  clock.Evict();
+  std::cout << "After evicting all 4 frames, Evict finds " << (clock.Evict().has_value() ? "a frame" : "nothing")
+            << std::endl;
+
+  // 第二部分：命中率。两种策略回放同样的访问序列。
+  std::cout << "Hit rate with " << num_frames << " frames over " << num_pages << " pages\n";
+  for (const char *kind : {"zipfian", "zipfian + scans", "loop"}) {
+    std::vector<uint32_t> trace = MakeTrace(kind, num_pages, num_frames, 1'000'000);
+    std::cout << "  " << kind << ":\tLRU " << SimulateHitRate<LruListReplacer>(num_frames, trace) << "%, Clock "
+              << SimulateHitRate<ClockReplacer>(num_frames, trace) << "%\n";
+  }
+
+  // 第三部分：多线程下命中路径的吞吐量。
+  std::cout << "Hit path throughput (" << std::thread::hardware_concurrency() << " hardware threads)\n";
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    double lru = HitPathOpsPerSecond<LruListReplacer>(num_frames, threads, ops_per_thread);
+    double clock_ops = HitPathOpsPerSecond<ClockReplacer>(num_frames, threads, ops_per_thread);
+    std::cout << "  threads=" << threads << ":\tLRU list " << lru / 1e6 << " M hits/s, Clock " << clock_ops / 1e6
+              << " M hits/s, speedup " << clock_ops / lru << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,491 @@
+/**
+ * @file coroutine_scheduler.cpp
+ * @brief 基于 C++20 协程的任务调度器与可等待（awaitable）事件/条件的教学示例。
+ */
+
+// condition_variable.cpp 中的 waiter_thread 调用 cv.wait 时，会让整个操作系统线程挂起。
+// 每个线程都带有自己的栈（Linux 上默认 8MB 虚拟地址空间）和内核调度实体，
+// 因此如果有成千上万个“逻辑等待者”，用线程来表示它们代价很高。
+
+// C++20 协程（coroutine）提供了另一种选择：协程在 co_await 处挂起时，只把它的局部变量保存在
+// 一个堆上分配的“协程帧”（coroutine frame）里，通常只有几百字节。挂起的协程不占用任何线程，
+// 等条件满足时再由一个小的线程池（executor）恢复执行。
+
+// 本文件实现了以下几部分：
+// 1. Executor：一个固定大小的线程池，负责恢复（resume）协程。
+// 2. Task：一个“发射后不管”（fire-and-forget）的协程返回类型，由 Executor::Spawn 启动。
+// 3. AsyncEvent：一次性事件，Set 之后所有等待者都会被调度执行。
+// 4. AsyncCondition：与 std::condition_variable 对应的协程版本，等待某个谓词成立。
+// 最后，main 用协程重写了 condition_variable.cpp 中的例子，并比较了大量等待者下协程与
+// 线程 + std::condition_variable 的创建/唤醒耗时和内存开销。
+
+// 注意：本文件需要 C++20，CMakeLists.txt 只为该目标单独开启了 C++20。
+
+// 关于 C++20 协程的参考资料：
+// https://en.cppreference.com/w/cpp/language/coroutines
+// https://lewissbaker.github.io/2017/11/17/understanding-operator-co-await
+
+// 包含 std::max。
+#include <algorithm>
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 condition_variable 头文件（Executor 内部以及对比基准使用）。
+#include <condition_variable>
+// 包含 coroutine 头文件，提供 std::coroutine_handle 等协程基础设施。
+#include <coroutine>
+// 包含 std::deque，作为 Executor 的就绪队列。
+#include <deque>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 mutex 头文件。
+#include <mutex>
+// 包含 std::string（用于解析命令行参数）。
+#include <string>
+// 包含 std::system_error（创建线程失败时抛出）。
+#include <system_error>
+// 包含 thread 头文件。
+#include <thread>
+// 包含 std::vector。
+#include <vector>
+
+// pthread_attr_getstacksize 用于查询默认线程栈大小，仅用于基准的内存估算。
+#include <pthread.h>
+
+// 统计所有协程帧占用的字节数，用于说明每个等待者的内存开销。
+std::atomic<size_t> frame_bytes{0};
+
+class Executor;
+
+// Task 是协程的返回类型。编译器看到函数体中有 co_await/co_return 时，会根据返回类型中的
+// promise_type 生成协程帧，并通过 promise 对象控制协程的生命周期。
+// 这里的 Task 在创建后立即挂起（initial_suspend 返回 suspend_always），
+// 直到 Executor::Spawn 把它放入就绪队列。协程结束时，final_suspend 的 FinalAwaiter 先销毁协程帧，
+// 再通知 executor 任务已结束：return_void 运行时函数体中的局部变量（例如持有的锁）还没有析构，
+// 如果在那里就通知，Join() 返回时可能还有工作线程在访问这些局部变量或协程帧。
+class Task {
+ public:
+  struct promise_type {
+    // 重载 operator new/delete 以统计协程帧的大小。
+    static void *operator new(size_t size) {
+      frame_bytes.fetch_add(size, std::memory_order_relaxed);
+      return ::operator new(size);
+    }
+    static void operator delete(void *ptr, size_t size) {
+      frame_bytes.fetch_sub(size, std::memory_order_relaxed);
+      ::operator delete(ptr);
+    }
+
+    Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    struct FinalAwaiter {
+      bool await_ready() const noexcept { return false; }
+      // 函数体的作用域已经结束，协程挂起在最终挂起点：先销毁帧，再调用 TaskDone。
+      void await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+      void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+
+    // 运行该协程的 executor，在 Spawn 时设置。
+    Executor *executor_{nullptr};
+  };
+
+  // Task 只能移动，不可拷贝，因为它独占一个尚未启动的协程帧。
+  Task(Task &&other) noexcept : handle_(other.handle_) { other.handle_ = nullptr; }
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+  Task &operator=(Task &&) = delete;
+
+  // 如果 Task 从未被 Spawn，需要在这里销毁协程帧，否则会内存泄漏。
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+ private:
+  friend class Executor;
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+// Executor 是一个小型线程池。它只做一件事：从就绪队列中取出协程句柄并 resume。
+// 协程挂起时不会占用任何一个工作线程，因此少量线程即可驱动大量协程。
+class Executor {
+ public:
+  explicit Executor(size_t num_threads) {
+    for (size_t i = 0; i < num_threads; i++) {
+      workers_.emplace_back([this] { WorkerLoop(); });
+    }
+  }
+
+  // 析构时等待所有任务结束，然后通知工作线程退出。
+  ~Executor() {
+    Join();
+    {
+      std::scoped_lock lk(m_);
+      stop_ = true;
+    }
+    queue_cv_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  Executor(const Executor &) = delete;
+  Executor &operator=(const Executor &) = delete;
+
+  // 启动一个 Task：接管它的协程帧，并放入就绪队列。
+  void Spawn(Task task) {
+    auto handle = task.handle_;
+    task.handle_ = nullptr;
+    handle.promise().executor_ = this;
+    {
+      std::scoped_lock lk(m_);
+      live_tasks_ += 1;
+    }
+    Schedule(handle);
+  }
+
+  // 把一个挂起的协程放入就绪队列，稍后由某个工作线程恢复。
+  void Schedule(std::coroutine_handle<> handle) {
+    {
+      std::scoped_lock lk(m_);
+      ready_.push_back(handle);
+    }
+    queue_cv_.notify_one();
+  }
+
+  // 阻塞调用线程，直到所有通过 Spawn 启动的任务都运行结束。
+  void Join() {
+    std::unique_lock lk(m_);
+    done_cv_.wait(lk, [this] { return live_tasks_ == 0; });
+  }
+
+  // 由 FinalAwaiter 在协程帧销毁之后调用，表示一个任务已结束。
+  void TaskDone() {
+    std::scoped_lock lk(m_);
+    live_tasks_ -= 1;
+    if (live_tasks_ == 0) {
+      done_cv_.notify_all();
+    }
+  }
+
+  // 一个可等待对象：co_await executor.Yield() 会把当前协程重新放回就绪队列队尾。
+  auto Yield() {
+    struct YieldAwaiter {
+      Executor *executor_;
+      bool await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<> handle) { executor_->Schedule(handle); }
+      void await_resume() const noexcept {}
+    };
+    return YieldAwaiter{this};
+  }
+
+ private:
+  void WorkerLoop() {
+    while (true) {
+      std::coroutine_handle<> handle;
+      {
+        std::unique_lock lk(m_);
+        queue_cv_.wait(lk, [this] { return stop_ || !ready_.empty(); });
+        if (ready_.empty()) {
+          return;
+        }
+        handle = ready_.front();
+        ready_.pop_front();
+      }
+      handle.resume();
+    }
+  }
+
+  std::mutex m_;
+  std::condition_variable queue_cv_;
+  std::condition_variable done_cv_;
+  std::deque<std::coroutine_handle<>> ready_;
+  size_t live_tasks_{0};
+  bool stop_{false};
+  std::vector<std::thread> workers_;
+};
+
+void Task::promise_type::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+  Executor *executor = handle.promise().executor_;
+  handle.destroy();
+  executor->TaskDone();
+}
+
+// AsyncEvent 是一次性事件。Set 之前 co_await Wait() 的协程都会挂起，Set 之后全部被调度。
+// 等待者以侵入式链表的形式保存在各自的协程帧里（Awaiter 是协程帧中的局部对象），
+// 因此挂起一个等待者不需要额外的堆分配。
+class AsyncEvent {
+ public:
+  explicit AsyncEvent(Executor &executor) : executor_(executor) {}
+
+  struct Awaiter {
+    AsyncEvent &event_;
+    std::coroutine_handle<> handle_{};
+    Awaiter *next_{nullptr};
+
+    bool await_ready() const { return event_.IsSet(); }
+    // 返回 false 表示不挂起：在加锁后发现事件已经被 Set，直接继续执行。
+    bool await_suspend(std::coroutine_handle<> handle) {
+      std::scoped_lock lk(event_.m_);
+      if (event_.set_) {
+        return false;
+      }
+      handle_ = handle;
+      next_ = event_.waiters_;
+      event_.waiters_ = this;
+      event_.num_waiters_ += 1;
+      return true;
+    }
+    void await_resume() const noexcept {}
+  };
+
+  Awaiter Wait() { return Awaiter{*this}; }
+
+  bool IsSet() {
+    std::scoped_lock lk(m_);
+    return set_;
+  }
+
+  // 当前挂起在该事件上的等待者数量。
+  size_t NumWaiters() {
+    std::scoped_lock lk(m_);
+    return num_waiters_;
+  }
+
+  // 设置事件，并把所有等待者交给 executor。注意要先把链表摘下来再调度，
+  // 因为等待者一旦被恢复，它所在的协程帧（包括 Awaiter 本身）随时可能被销毁。
+  void Set() {
+    Awaiter *waiters;
+    {
+      std::scoped_lock lk(m_);
+      set_ = true;
+      waiters = waiters_;
+      waiters_ = nullptr;
+      num_waiters_ = 0;
+    }
+    while (waiters != nullptr) {
+      Awaiter *next = waiters->next_;
+      executor_.Schedule(waiters->handle_);
+      waiters = next;
+    }
+  }
+
+ private:
+  Executor &executor_;
+  std::mutex m_;
+  bool set_{false};
+  Awaiter *waiters_{nullptr};
+  size_t num_waiters_{0};
+};
+
+// AsyncCondition 对应 std::condition_variable::wait(lk, pred)。
+// 与条件变量一样，被等待的共享状态需要由同一把互斥锁保护：修改状态时持有 GetMutex() 返回的锁，
+// 然后在持锁状态下调用 NotifyOne/NotifyAll。
+// 与条件变量不同的是，通知者会在持锁时直接检查每个等待者的谓词，只调度谓词已成立的等待者，
+// 因此协程永远不会出现“虚假唤醒”，也不需要自己写 while 循环。
+class AsyncCondition {
+ public:
+  explicit AsyncCondition(Executor &executor) : executor_(executor) {}
+
+  std::mutex &GetMutex() { return m_; }
+
+  // 等待者的公共部分。谓词通过函数指针 + 上下文指针保存，避免 std::function 的堆分配。
+  struct WaiterBase {
+    AsyncCondition &cond_;
+    bool (*check_)(WaiterBase *);
+    std::coroutine_handle<> handle_{};
+    WaiterBase *next_{nullptr};
+  };
+
+  template <typename Pred>
+  struct Awaiter : WaiterBase {
+    Pred pred_;
+
+    Awaiter(AsyncCondition &cond, Pred pred)
+        : WaiterBase{cond, [](WaiterBase *self) { return static_cast<Awaiter *>(self)->pred_(); }},
+          pred_(std::move(pred)) {}
+
+    bool await_ready() const noexcept { return false; }
+    // 在持锁状态下检查谓词：如果已经成立就不挂起，否则加入等待链表。
+    // 检查与入队在同一临界区内完成，因此不会错过通知（lost wakeup）。
+    bool await_suspend(std::coroutine_handle<> handle) {
+      std::scoped_lock lk(cond_.m_);
+      if (pred_()) {
+        return false;
+      }
+      handle_ = handle;
+      next_ = cond_.waiters_;
+      cond_.waiters_ = this;
+      return true;
+    }
+    void await_resume() const noexcept {}
+  };
+
+  // co_await cond.WaitUntil(pred) 会挂起当前协程，直到 pred() 返回 true。
+  template <typename Pred>
+  Awaiter<Pred> WaitUntil(Pred pred) {
+    return Awaiter<Pred>(*this, std::move(pred));
+  }
+
+  // 调度一个谓词已成立的等待者。调用者必须持有 GetMutex()。
+  void NotifyOne() { Notify(false); }
+
+  // 调度所有谓词已成立的等待者。调用者必须持有 GetMutex()。
+  void NotifyAll() { Notify(true); }
+
+ private:
+  void Notify(bool all) {
+    WaiterBase **link = &waiters_;
+    while (*link != nullptr) {
+      WaiterBase *waiter = *link;
+      if (waiter->check_(waiter)) {
+        *link = waiter->next_;
+        executor_.Schedule(waiter->handle_);
+        if (!all) {
+          return;
+        }
+      } else {
+        link = &waiter->next_;
+      }
+    }
+  }
+
+  Executor &executor_;
+  std::mutex m_;
+  WaiterBase *waiters_{nullptr};
+};
+
+// 下面用协程重写 condition_variable.cpp 中的例子。
+// 两个任务把 count 加 1，并在 count 变为 2 时通知等待者；等待者在 count == 2 时打印 count。
+int count = 0;
+
+Task add_count_and_notify(AsyncCondition &cond) {
+  std::scoped_lock slk(cond.GetMutex());
+  count += 1;
+  if (count == 2) {
+    cond.NotifyOne();
+  }
+  co_return;
+}
+
+// 与 waiter_thread 不同，waiter_task 在等待期间不占用任何线程。
+Task waiter_task(AsyncCondition &cond) {
+  co_await cond.WaitUntil([] { return count == 2; });
+  std::scoped_lock slk(cond.GetMutex());
+  std::cout << "Printing count: " << count << std::endl;
+}
+
+// 基准测试中使用的协程：等待事件，然后把完成计数加 1。
+Task bench_waiter(AsyncEvent &event, std::atomic<size_t> &woken) {
+  co_await event.Wait();
+  woken.fetch_add(1, std::memory_order_relaxed);
+}
+
+double ElapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 协程版本：创建 n 个挂起在同一个 AsyncEvent 上的等待者，然后一次性唤醒。
+void BenchCoroutines(size_t n, size_t executor_threads) {
+  Executor executor(executor_threads);
+  AsyncEvent event(executor);
+  std::atomic<size_t> woken{0};
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < n; i++) {
+    executor.Spawn(bench_waiter(event, woken));
+  }
+  // 等待所有协程都运行到 co_await 处并挂起。此时它们只占用协程帧的内存，不占用任何线程。
+  while (event.NumWaiters() != n) {
+    std::this_thread::yield();
+  }
+  double spawn_ms = ElapsedMs(start);
+  size_t bytes = frame_bytes.load();
+
+  start = std::chrono::steady_clock::now();
+  event.Set();
+  executor.Join();
+  double wake_ms = ElapsedMs(start);
+
+  std::cout << "coroutines: " << n << " waiters, " << executor_threads << " executor threads\n"
+            << "  spawn: " << spawn_ms << " ms, wake all: " << wake_ms << " ms, woken: " << woken.load() << "\n"
+            << "  frame memory: " << bytes << " bytes total, " << bytes / n << " bytes per waiter\n";
+}
+
+// 线程版本：创建 n 个线程，每个线程都在 std::condition_variable 上等待，然后 notify_all。
+void BenchThreads(size_t n) {
+  std::mutex m;
+  std::condition_variable cv;
+  bool ready = false;
+  std::atomic<size_t> woken{0};
+  std::vector<std::thread> threads;
+  threads.reserve(n);
+
+  auto start = std::chrono::steady_clock::now();
+  try {
+    for (size_t i = 0; i < n; i++) {
+      threads.emplace_back([&] {
+        std::unique_lock lk(m);
+        cv.wait(lk, [&] { return ready; });
+        woken.fetch_add(1, std::memory_order_relaxed);
+      });
+    }
+  } catch (const std::system_error &e) {
+    // 线程数量受 ulimit / 内核参数限制，创建失败时只使用已创建的线程继续测量。
+    std::cout << "  thread creation failed after " << threads.size() << " threads: " << e.what() << "\n";
+  }
+  double spawn_ms = ElapsedMs(start);
+
+  start = std::chrono::steady_clock::now();
+  {
+    std::scoped_lock lk(m);
+    ready = true;
+  }
+  cv.notify_all();
+  for (auto &t : threads) {
+    t.join();
+  }
+  double wake_ms = ElapsedMs(start);
+
+  size_t stack_size = 0;
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_getstacksize(&attr, &stack_size);
+  pthread_attr_destroy(&attr);
+
+  std::cout << "threads + condition_variable: " << threads.size() << " waiters\n"
+            << "  spawn: " << spawn_ms << " ms, wake all + join: " << wake_ms << " ms, woken: " << woken.load() << "\n"
+            << "  stack reservation: " << stack_size << " bytes per waiter\n";
+}
+
+// 用法：./coroutine_scheduler [协程等待者数量] [线程等待者数量]
+// 默认创建 100000 个协程等待者。线程版本默认只创建 10000 个线程，因为 100000 个线程通常会超过
+// 系统的线程数限制；需要时可以通过第二个参数调大。
+int main(int argc, char *argv[]) {
+  size_t num_coroutines = argc > 1 ? std::stoul(argv[1]) : 100000;
+  size_t num_threads = argc > 2 ? std::stoul(argv[2]) : 10000;
+  size_t executor_threads = std::max(2u, std::thread::hardware_concurrency());
+
+  // 第一部分：与 condition_variable.cpp 相同的小例子，只是全部用协程实现。
+  {
+    Executor executor(2);
+    AsyncCondition cond(executor);
+    executor.Spawn(waiter_task(cond));
+    executor.Spawn(add_count_and_notify(cond));
+    executor.Spawn(add_count_and_notify(cond));
+    executor.Join();
+  }
+
+  // 第二部分：大量等待者下协程与线程的对比。
+  BenchCoroutines(num_coroutines, executor_threads);
+  BenchThreads(num_threads);
+  return 0;
+}
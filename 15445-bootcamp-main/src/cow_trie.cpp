@@ -0,0 +1,557 @@
+/**
+ * @file cow_trie.cpp
+ * @brief 写时复制（copy-on-write）的持久化字典树（trie）：Put/Remove 返回共享未修改节点的新根，
+ *        存储层让读线程不加锁地读取当前版本，唯一的写线程发布新版本。
+ */
+
+// 持久化（persistent）数据结构的每次修改都产生一个新版本，旧版本保持不变、仍然可以读取。
+// 对于字典树，修改一个键只会改变从根到这个键对应节点的路径上的节点，所以 Put/Remove 只需要复制
+// 这条路径（路径复制，path copying），其余子树由新旧版本共享。节点之间用 std::shared_ptr<const TrieNode>
+// 连接（见 shared_ptr.cpp）：某个版本不再被任何人持有时，只属于它的节点会被引用计数自动释放。
+// 节点一旦创建就不再修改（const），所以多个线程可以同时读同一个版本而不需要任何同步。
+
+// 值保存在 std::shared_ptr<T> 中，Put 按值接收并移动进去，因此只能移动的类型（例如 unique_ptr.cpp 中的
+// std::unique_ptr）也可以作为值。带值的节点是 TrieNodeWithValue<T>，Get<T> 用 dynamic_cast 检查类型，
+// 类型不匹配时与键不存在一样返回 nullptr。
+
+// TrieStore 在 Trie 的基础上提供并发访问：
+// - 当前版本通过 std::atomic<const Trie *> 发布。读线程进入一个基于纪元的读侧临界区（与 rcu.cpp 相同的思路），
+//   读一次根指针，之后只访问这个不可变的版本。整个过程不加锁，也不修改引用计数，
+//   读线程之间唯一写入的是各自独占缓存行的纪元槽位。
+// - 写线程持有 write_lock_（保证同一时刻只有一个写者），在当前根的基础上构造新版本，
+//   原子地替换根指针，旧版本等到没有读线程能看到它时才释放。写线程从不等待读线程。
+// 没有使用 shared_ptr 的 std::atomic_load/std::atomic_store：libstdc++ 用一小组按地址散列的互斥锁实现它们，
+// 所有读线程会在同一把锁和根的引用计数所在的缓存行上串行化。
+// 作为对比，LockedMapStore 用 std::shared_mutex 保护一个 std::map。
+
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 UINT64_MAX。
+#include <cstdint>
+// 包含 std::exit。
+#include <cstdlib>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::map（子节点表与对比用的存储）。
+#include <map>
+// 包含 std::shared_ptr、std::unique_ptr。
+#include <memory>
+// 包含 std::mutex。
+#include <mutex>
+// 包含 std::optional。
+#include <optional>
+// 包含 std::mt19937_64（用于生成随机键）。
+#include <random>
+// 包含 std::shared_mutex。
+#include <shared_mutex>
+// 包含 std::runtime_error。
+#include <stdexcept>
+// 包含 std::string。
+#include <string>
+// 包含 std::string_view。
+#include <string_view>
+// 包含 thread 头文件。
+#include <thread>
+// 包含 std::is_same_v。
+#include <type_traits>
+// 包含 std::move、std::pair。
+#include <utility>
+// 包含 std::vector。
+#include <vector>
+
+// 当前存活的节点数，用于计算每个版本额外占用的内存。
+inline std::atomic<int64_t> live_trie_nodes{0};
+
+class TrieNode {
+ public:
+  TrieNode() { live_trie_nodes.fetch_add(1, std::memory_order_relaxed); }
+  explicit TrieNode(std::map<char, std::shared_ptr<const TrieNode>> children) : children_(std::move(children)) {
+    live_trie_nodes.fetch_add(1, std::memory_order_relaxed);
+  }
+  TrieNode(const TrieNode &other) : children_(other.children_), is_value_node_(other.is_value_node_) {
+    live_trie_nodes.fetch_add(1, std::memory_order_relaxed);
+  }
+  TrieNode &operator=(const TrieNode &) = delete;
+  virtual ~TrieNode() { live_trie_nodes.fetch_sub(1, std::memory_order_relaxed); }
+
+  // 复制节点本身（浅拷贝：子节点仍然共享）。带值的节点会复制出带值的节点。
+  virtual std::unique_ptr<TrieNode> Clone() const { return std::make_unique<TrieNode>(*this); }
+
+  std::map<char, std::shared_ptr<const TrieNode>> children_;
+  bool is_value_node_{false};
+};
+
+template <class T>
+class TrieNodeWithValue : public TrieNode {
+ public:
+  TrieNodeWithValue(std::map<char, std::shared_ptr<const TrieNode>> children, std::shared_ptr<T> value)
+      : TrieNode(std::move(children)), value_(std::move(value)) {
+    is_value_node_ = true;
+  }
+
+  std::unique_ptr<TrieNode> Clone() const override { return std::make_unique<TrieNodeWithValue<T>>(*this); }
+
+  std::shared_ptr<T> value_;
+};
+
+// 不可变的字典树。所有成员函数都是 const 的，修改操作返回新的 Trie。
+class Trie {
+ public:
+  Trie() = default;
+
+  // 返回键对应的值；键不存在或值的类型不是 T 时返回 nullptr。
+  template <class T>
+  const T *Get(std::string_view key) const {
+    const TrieNode *node = root_.get();
+    for (char c : key) {
+      if (node == nullptr) {
+        return nullptr;
+      }
+      auto it = node->children_.find(c);
+      node = it == node->children_.end() ? nullptr : it->second.get();
+    }
+    auto *value_node = dynamic_cast<const TrieNodeWithValue<T> *>(node);
+    return value_node == nullptr ? nullptr : value_node->value_.get();
+  }
+
+  template <class T>
+  Trie Put(std::string_view key, T value) const {
+    return Trie(PutNode<T>(root_, key, std::make_shared<T>(std::move(value))));
+  }
+
+  Trie Remove(std::string_view key) const {
+    auto root = RemoveNode(root_, key);
+    return root == root_ ? *this : Trie(std::move(root));
+  }
+
+  // 从根出发能到达的节点数（共享的子树在这里会被重复计算，即“完整复制一份”时的节点数）。
+  size_t NodeCount() const { return CountNodes(root_.get()); }
+
+ private:
+  explicit Trie(std::shared_ptr<const TrieNode> root) : root_(std::move(root)) {}
+
+  // 返回在 node 下插入 key 之后的新节点：路径上的节点被复制，其余子树共享。
+  template <class T>
+  static std::shared_ptr<const TrieNode> PutNode(const std::shared_ptr<const TrieNode> &node, std::string_view key,
+                                                 std::shared_ptr<T> value) {
+    if (key.empty()) {
+      std::map<char, std::shared_ptr<const TrieNode>> children;
+      if (node != nullptr) {
+        children = node->children_;
+      }
+      return std::make_shared<const TrieNodeWithValue<T>>(std::move(children), std::move(value));
+    }
+    std::unique_ptr<TrieNode> copy = node == nullptr ? std::make_unique<TrieNode>() : node->Clone();
+    std::shared_ptr<const TrieNode> child;
+    if (auto it = copy->children_.find(key[0]); it != copy->children_.end()) {
+      child = it->second;
+    }
+    copy->children_[key[0]] = PutNode<T>(child, key.substr(1), std::move(value));
+    return copy;
+  }
+
+  // 返回在 node 下删除 key 之后的节点；键不存在时原样返回 node。
+  // 不再带值、也没有子节点的节点被删掉（返回 nullptr）。
+  static std::shared_ptr<const TrieNode> RemoveNode(const std::shared_ptr<const TrieNode> &node,
+                                                    std::string_view key) {
+    if (node == nullptr) {
+      return nullptr;
+    }
+    if (key.empty()) {
+      if (!node->is_value_node_) {
+        return node;
+      }
+      return node->children_.empty() ? nullptr : std::make_shared<const TrieNode>(node->children_);
+    }
+    auto it = node->children_.find(key[0]);
+    if (it == node->children_.end()) {
+      return node;
+    }
+    auto child = RemoveNode(it->second, key.substr(1));
+    if (child == it->second) {
+      return node;
+    }
+    std::unique_ptr<TrieNode> copy = node->Clone();
+    if (child == nullptr) {
+      copy->children_.erase(key[0]);
+      if (copy->children_.empty() && !copy->is_value_node_) {
+        return nullptr;
+      }
+    } else {
+      copy->children_[key[0]] = std::move(child);
+    }
+    return copy;
+  }
+
+  static size_t CountNodes(const TrieNode *node) {
+    if (node == nullptr) {
+      return 0;
+    }
+    size_t count = 1;
+    for (auto &[c, child] : node->children_) {
+      count += CountNodes(child.get());
+    }
+    return count;
+  }
+
+  std::shared_ptr<const TrieNode> root_;
+};
+
+// 基于纪元（epoch）的内存回收，与 rcu.cpp 的宽限期检测相同：全局纪元单调递增，读线程进入读侧临界区时
+// 把当前纪元记在自己的槽位中，离开时清零。写线程替换根之后把旧版本连同“退休纪元”（把全局纪元加 1 之后的值）
+// 放进待回收列表；所有槽位都为 0 或不小于退休纪元时，已经没有读线程能看到旧版本，可以释放。
+// 与 rcu.cpp 不同的是，写线程从不等待：它只是顺便释放已经安全的旧版本，其余的留到下一次。
+// 槽位是固定大小的数组，线程用 CAS 领取，线程退出时归还，因此读线程在任何时候都不需要加锁。
+class EpochDomain {
+ public:
+  static constexpr size_t kMaxThreads = 256;
+
+  // 进入读侧临界区。支持嵌套：只有最外层才记录纪元。
+  // acquire 读取全局纪元：如果读到了某个写线程加 1 之后的值，该写线程之前发布的根对我们可见。
+  // 记录纪元之后的 seq_cst 栅栏与 RetireEpoch 后的栅栏配对：要么写线程看到我们记录的纪元，
+  // 要么我们随后读到写线程已经发布的新根。
+  void Enter() {
+    Slot *slot = Self();
+    if (slot->nesting_++ == 0) {
+      slot->epoch_.store(global_epoch_.load(std::memory_order_acquire), std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+  }
+
+  void Exit() {
+    Slot *slot = Self();
+    if (--slot->nesting_ == 0) {
+      slot->epoch_.store(0, std::memory_order_release);
+    }
+  }
+
+  // 写线程替换根之后调用，返回旧版本的退休纪元。
+  uint64_t RetireEpoch() {
+    uint64_t epoch = global_epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return epoch;
+  }
+
+  // 退休纪元小于等于返回值的版本都可以释放。
+  uint64_t SafeEpoch() const {
+    uint64_t safe = UINT64_MAX;
+    for (auto &slot : slots_) {
+      uint64_t epoch = slot.epoch_.load(std::memory_order_acquire);
+      if (epoch != 0 && epoch <= safe) {
+        safe = epoch;
+      }
+    }
+    return safe;
+  }
+
+ private:
+  // 独占一个缓存行，避免不同读线程之间伪共享。
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> epoch_{0};
+    // 只由所属线程访问的嵌套深度。
+    uint64_t nesting_{0};
+    std::atomic<bool> in_use_{false};
+  };
+
+  // 线程局部的句柄：线程第一次进入读侧临界区时领取槽位，线程退出时归还。
+  struct ThreadHandle {
+    Slot *slot_{nullptr};
+    ~ThreadHandle() {
+      if (slot_ != nullptr) {
+        slot_->in_use_.store(false, std::memory_order_release);
+      }
+    }
+  };
+
+  Slot *Self() {
+    thread_local ThreadHandle handle;
+    if (handle.slot_ == nullptr) {
+      for (auto &slot : slots_) {
+        bool expected = false;
+        if (!slot.in_use_.load(std::memory_order_relaxed) &&
+            slot.in_use_.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+          handle.slot_ = &slot;
+          break;
+        }
+      }
+      if (handle.slot_ == nullptr) {
+        throw std::runtime_error("too many threads reading a TrieStore");
+      }
+    }
+    return handle.slot_;
+  }
+
+  std::atomic<uint64_t> global_epoch_{1};
+  Slot slots_[kMaxThreads];
+};
+
+// 全局唯一的纪元域，第一次使用时构造。
+EpochDomain &GetEpochDomain() {
+  static EpochDomain domain;
+  return domain;
+}
+
+// RAII 的读侧临界区：存活期间，进入时能看到的版本都不会被释放。
+class EpochGuard {
+ public:
+  EpochGuard() : active_(true) { GetEpochDomain().Enter(); }
+  EpochGuard(EpochGuard &&other) noexcept : active_(other.active_) { other.active_ = false; }
+  EpochGuard(const EpochGuard &) = delete;
+  EpochGuard &operator=(const EpochGuard &) = delete;
+  EpochGuard &operator=(EpochGuard &&) = delete;
+  ~EpochGuard() {
+    if (active_) {
+      GetEpochDomain().Exit();
+    }
+  }
+
+ private:
+  bool active_;
+};
+
+// Get 的返回值：持有一个读侧临界区，保证取值时的版本在 guard 存活期间不会被释放。
+// guard 不增加任何引用计数；代价是长期持有 guard 会推迟旧版本的回收（但不会阻塞写线程）。
+// guard 必须在取得它的线程上析构。
+template <class T>
+class ValueGuard {
+ public:
+  ValueGuard(EpochGuard guard, const T &value) : guard_(std::move(guard)), value_(value) {}
+  const T &operator*() const { return value_; }
+
+ private:
+  EpochGuard guard_;
+  const T &value_;
+};
+
+class TrieStore {
+ public:
+  TrieStore() : TrieStore(Trie()) {}
+  explicit TrieStore(Trie initial) : root_(new Trie(std::move(initial))) {}
+
+  // 析构时不能再有读线程或 ValueGuard 在使用这个存储。
+  ~TrieStore() {
+    delete root_.load();
+    for (auto &[epoch, trie] : retired_) {
+      delete trie;
+    }
+  }
+
+  TrieStore(const TrieStore &) = delete;
+  TrieStore &operator=(const TrieStore &) = delete;
+
+  // 读线程不加锁，也不修改任何共享的缓存行：只写自己的纪元槽位，再读一次根指针。
+  template <class T>
+  std::optional<ValueGuard<T>> Get(std::string_view key) const {
+    EpochGuard guard;
+    const T *value = root_.load(std::memory_order_acquire)->Get<T>(key);
+    if (value == nullptr) {
+      return std::nullopt;
+    }
+    return ValueGuard<T>(std::move(guard), *value);
+  }
+
+  template <class T>
+  void Put(std::string_view key, T value) {
+    std::scoped_lock lk(write_lock_);
+    Publish(root_.load(std::memory_order_relaxed)->Put<T>(key, std::move(value)));
+  }
+
+  void Remove(std::string_view key) {
+    std::scoped_lock lk(write_lock_);
+    Publish(root_.load(std::memory_order_relaxed)->Remove(key));
+  }
+
+  // 取得当前版本的一个长期有效的拷贝。与 Get 不同，拷贝会增加根节点的引用计数。
+  Trie Snapshot() const {
+    EpochGuard guard;
+    return *root_.load(std::memory_order_acquire);
+  }
+
+ private:
+  // 调用者持有 write_lock_。发布新根，旧根进入待回收列表，顺便释放已经没有读线程能看到的旧版本。
+  void Publish(Trie trie) {
+    const Trie *old = root_.exchange(new Trie(std::move(trie)), std::memory_order_seq_cst);
+    retired_.emplace_back(GetEpochDomain().RetireEpoch(), old);
+    if (retired_.size() >= kReclaimBatch) {
+      uint64_t safe = GetEpochDomain().SafeEpoch();
+      size_t kept = 0;
+      for (auto &[epoch, trie] : retired_) {
+        if (epoch <= safe) {
+          delete trie;
+        } else {
+          retired_[kept++] = {epoch, trie};
+        }
+      }
+      retired_.resize(kept);
+    }
+  }
+
+  // 每积累这么多个旧版本扫描一次所有纪元槽位。
+  static constexpr size_t kReclaimBatch = 32;
+
+  std::mutex write_lock_;
+  std::atomic<const Trie *> root_;
+  // 由 write_lock_ 保护：（退休纪元，旧版本）。
+  std::vector<std::pair<uint64_t, const Trie *>> retired_;
+};
+
+// 对比用的存储：读写锁保护的 std::map。
+class LockedMapStore {
+ public:
+  std::optional<uint64_t> Get(std::string_view key) const {
+    std::shared_lock lk(latch_);
+    auto it = map_.find(key);
+    return it == map_.end() ? std::nullopt : std::optional<uint64_t>(it->second);
+  }
+
+  void Put(std::string_view key, uint64_t value) {
+    std::unique_lock lk(latch_);
+    map_.insert_or_assign(std::string(key), value);
+  }
+
+ private:
+  mutable std::shared_mutex latch_;
+  std::map<std::string, uint64_t, std::less<>> map_;
+};
+
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::cout << "CHECK FAILED: " << what << std::endl;
+    std::exit(1);
+  }
+}
+
+void CheckSemantics() {
+  Trie empty;
+  Trie t1 = empty.Put<uint32_t>("ab", 1);
+  Trie t2 = t1.Put<std::string>("abc", "three");
+  Trie t3 = t2.Put<uint32_t>("ab", 2);
+  Trie t4 = t3.Remove("abc");
+
+  // 旧版本保持不变。
+  Check(empty.Get<uint32_t>("ab") == nullptr, "the empty trie stays empty");
+  Check(*t1.Get<uint32_t>("ab") == 1 && t1.Get<std::string>("abc") == nullptr, "t1 only has ab");
+  Check(*t2.Get<std::string>("abc") == "three", "t2 has abc");
+  Check(*t3.Get<uint32_t>("ab") == 2 && *t2.Get<uint32_t>("ab") == 1, "overwriting ab does not change t2");
+  Check(t4.Get<std::string>("abc") == nullptr && *t3.Get<std::string>("abc") == "three", "removing abc keeps t3");
+  Check(t2.Get<uint32_t>("abc") == nullptr, "a value of a different type is not found");
+  Check(t4.NodeCount() == 3, "removing abc prunes its node");
+  Check(t4.Remove("ab").NodeCount() == 0, "removing the last key prunes the whole path");
+  Check(t1.Put<uint32_t>("", 7).Get<uint32_t>("") != nullptr, "the empty key is stored at the root");
+
+  // 只能移动的值。
+  Trie t5 = t4.Put<std::unique_ptr<int>>("p", std::make_unique<int>(42));
+  Check(**t5.Get<std::unique_ptr<int>>("p") == 42, "move-only values can be stored");
+
+  // Get 返回的 guard 让值在新版本发布之后仍然有效。
+  TrieStore store;
+  store.Put<std::string>("key", "old");
+  auto guard = store.Get<std::string>("key");
+  store.Put<std::string>("key", "new");
+  store.Remove("key");
+  Check(guard.has_value() && **guard == "old", "a value guard keeps its version alive");
+  Check(!store.Get<std::string>("key").has_value(), "the store sees the removal");
+  std::cout << "Semantics checks passed\n";
+}
+
+std::vector<std::string> MakeKeys(size_t n) {
+  std::mt19937_64 rng(42);
+  std::vector<std::string> keys;
+  keys.reserve(n);
+  for (size_t i = 0; i < n; i++) {
+    keys.push_back("user" + std::to_string(rng() % 100'000'000));
+  }
+  return keys;
+}
+
+// 一个写线程不停地更新随机键，readers 个读线程在 duration 内不停地读随机键。
+template <typename Store>
+void BenchReadsDuringWrites(const char *name, Store *store, const std::vector<std::string> &keys, size_t readers,
+                            std::chrono::milliseconds duration) {
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> reads{0};
+  uint64_t writes = 0;
+  std::thread writer([&] {
+    std::mt19937_64 rng(7);
+    while (!stop.load(std::memory_order_relaxed)) {
+      store->Put(keys[rng() % keys.size()], static_cast<uint64_t>(writes));
+      writes++;
+    }
+  });
+  std::vector<std::thread> workers;
+  for (size_t r = 0; r < readers; r++) {
+    workers.emplace_back([&, r] {
+      std::mt19937_64 rng(r);
+      uint64_t local = 0;
+      uint64_t found = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        for (int i = 0; i < 64; i++) {
+          if constexpr (std::is_same_v<Store, TrieStore>) {
+            found += store->template Get<uint64_t>(keys[rng() % keys.size()]).has_value();
+          } else {
+            found += store->Get(keys[rng() % keys.size()]).has_value();
+          }
+        }
+        local += 64;
+      }
+      reads.fetch_add(local);
+      Check(found == local, "every preloaded key is found");
+    });
+  }
+  std::this_thread::sleep_for(duration);
+  stop = true;
+  writer.join();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  double seconds = duration.count() / 1000.0;
+  std::cout << "  " << name << " " << readers << " readers:\t" << reads / seconds / 1e6 << " M reads/s, "
+            << writes / seconds / 1000 << " K writes/s\n";
+}
+
+// 用法：./cow_trie [键数] [最大读线程数] [每轮毫秒数]
+int main(int argc, char *argv[]) {
+  size_t num_keys = argc > 1 ? std::stoul(argv[1]) : 100'000;
+  size_t max_readers = argc > 2 ? std::stoul(argv[2]) : 4;
+  std::chrono::milliseconds duration(argc > 3 ? std::stoi(argv[3]) : 300);
+
+  // 第一部分：版本语义。
+  CheckSemantics();
+
+  // 第二部分：每个版本额外占用的节点数。保留连续的 versions 个版本，新增节点数除以版本数，
+  // 与完整复制一份字典树的节点数比较。
+  auto keys = MakeKeys(num_keys);
+  Trie base;
+  for (size_t i = 0; i < keys.size(); i++) {
+    base = base.Put<uint64_t>(keys[i], i);
+  }
+  {
+    const size_t versions = 1000;
+    int64_t before = live_trie_nodes.load();
+    std::vector<Trie> history{base};
+    std::mt19937_64 rng(1);
+    for (size_t v = 0; v < versions; v++) {
+      history.push_back(history.back().Put<uint64_t>(keys[rng() % keys.size()], v));
+    }
+    double per_version = static_cast<double>(live_trie_nodes.load() - before) / versions;
+    // 粗略估计每个节点的字节数：节点本身，加上 shared_ptr 控制块与父节点 std::map 中的一个表项（约 64 字节）。
+    std::cout << "Memory per version: " << per_version << " new nodes (~"
+              << per_version * (sizeof(TrieNodeWithValue<uint64_t>) + 64) << " bytes), versus " << base.NodeCount()
+              << " nodes in a full copy\n";
+  }
+
+  // 第三部分：一个写线程持续更新时的读吞吐量。
+  std::cout << "Reads during continuous writes (" << num_keys << " keys):\n";
+  for (size_t readers = 1; readers <= max_readers; readers *= 2) {
+    TrieStore trie_store(base);
+    LockedMapStore map_store;
+    for (size_t i = 0; i < keys.size(); i++) {
+      map_store.Put(keys[i], i);
+    }
+    BenchReadsDuringWrites("cow trie  ", &trie_store, keys, readers, duration);
+    BenchReadsDuringWrites("locked map", &map_store, keys, readers, duration);
+  }
+  return 0;
+}
@@ -0,0 +1,297 @@
+/**
+ * @file event_count.cpp
+ * @brief 基于 eventfd 的合并唤醒（coalescing）事件计数器，以及它与 epoll 事件循环集成的教学示例。
+ */
+
+// 在 condition_variable.cpp 中，add_count_and_notify 每次修改状态都会调用 cv.notify_one()。
+// 当状态变化非常频繁时（例如很多生产者不断提交工作），每次通知都可能导致一次真正的线程唤醒，
+// 而消费者每次醒来往往只处理一件事，大量 CPU 时间花在了上下文切换上。
+
+// 本文件实现一个 EventCount：
+// 1. 生产者调用 Notify() 只是把一个原子计数器加 1。只有当计数器从 0 变为 1 时才真正去唤醒消费者，
+//    因此在消费者处理上一批期间到来的所有通知会被合并成一次唤醒。
+// 2. 消费者调用 Wait()（或 Consume()）一次取走所有累积的通知数量，按批处理。
+// 3. 唤醒机制使用 Linux 的 eventfd。eventfd 是一个文件描述符，因此可以像 socket 一样注册到 epoll 中，
+//    让一个同时处理 I/O 的线程也能等待进程内的事件。
+
+// 关于 eventfd 与 epoll 的文档：
+// https://man7.org/linux/man-pages/man2/eventfd.2.html
+// https://man7.org/linux/man-pages/man7/epoll.7.html
+
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 condition_variable 头文件（用于对比基准）。
+#include <condition_variable>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 mutex 头文件。
+#include <mutex>
+// 包含 std::string（用于解析命令行参数）。
+#include <string>
+// 包含 std::string_view。
+#include <string_view>
+// 包含 std::system_error（系统调用失败时抛出）。
+#include <system_error>
+// 包含 thread 头文件。
+#include <thread>
+// 包含 std::vector。
+#include <vector>
+
+// Linux 系统调用相关头文件。
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// EventCount 是一个合并唤醒的事件计数器。它是一个管理 eventfd 的包装类（参见 wrapper_class.cpp），
+// 因此不可拷贝也不可移动。
+class EventCount {
+ public:
+  // eventfd 以非阻塞模式创建，这样 epoll 循环可以在 fd 可读后调用 Consume() 而不必担心阻塞。
+  EventCount() {
+    fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd_ < 0) {
+      throw std::system_error(errno, std::generic_category(), "eventfd");
+    }
+  }
+
+  ~EventCount() { close(fd_); }
+
+  EventCount(const EventCount &) = delete;
+  EventCount &operator=(const EventCount &) = delete;
+
+  // 记录一次通知。只有 pending_ 从 0 变为 1 的那次通知会写 eventfd，
+  // 其余通知只是一次原子加法，不会进入内核。
+  void Notify() {
+    if (pending_.fetch_add(1, std::memory_order_acq_rel) == 0) {
+      uint64_t one = 1;
+      // eventfd 计数器不会溢出到需要阻塞的程度，因此这里忽略 EAGAIN。
+      [[maybe_unused]] ssize_t ret = write(fd_, &one, sizeof(one));
+      wakeups_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  // 非阻塞地取走所有累积的通知，返回其数量（可能为 0）。
+  // 注意顺序：必须先清空 eventfd，再把 pending_ 置零。反过来的话，一个在两步之间到来的 Notify
+  // 会看到 pending_ == 0 并写 eventfd，随后 eventfd 又被我们清空，这次通知就丢失了。
+  uint64_t Consume() {
+    uint64_t value;
+    [[maybe_unused]] ssize_t ret = read(fd_, &value, sizeof(value));
+    return pending_.exchange(0, std::memory_order_acq_rel);
+  }
+
+  // 阻塞直到至少有一个通知，然后返回累积的通知数量。
+  // 由于 Consume 与 Notify 之间的竞争，eventfd 可能出现一次“多余”的可读，此时 Consume 返回 0，继续等待即可。
+  uint64_t Wait() {
+    while (true) {
+      uint64_t n = Consume();
+      if (n > 0) {
+        return n;
+      }
+      pollfd pfd{fd_, POLLIN, 0};
+      poll(&pfd, 1, -1);
+    }
+  }
+
+  // 返回底层的 eventfd，可以注册到 epoll 中（关注 EPOLLIN）。
+  int Fd() const { return fd_; }
+
+  // 真正写 eventfd 的次数，即唤醒次数的上界。
+  uint64_t Wakeups() const { return wakeups_.load(std::memory_order_relaxed); }
+
+ private:
+  int fd_;
+  std::atomic<uint64_t> pending_{0};
+  std::atomic<uint64_t> wakeups_{0};
+};
+
+// 一个基于 epoll 的事件循环，演示 I/O 线程如何同时等待管道上的数据和 EventCount 的通知。
+// 这里用管道模拟“I/O”，真实场景中可以是 socket。
+void EpollDemo() {
+  EventCount ec;
+  int pipe_fds[2];
+  if (pipe(pipe_fds) != 0) {
+    throw std::system_error(errno, std::generic_category(), "pipe");
+  }
+
+  int epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (epfd < 0) {
+    int err = errno;
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    throw std::system_error(err, std::generic_category(), "epoll_create1");
+  }
+  for (int fd : {ec.Fd(), pipe_fds[0]}) {
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+      int err = errno;
+      close(epfd);
+      close(pipe_fds[0]);
+      close(pipe_fds[1]);
+      throw std::system_error(err, std::generic_category(), "epoll_ctl");
+    }
+  }
+
+  // 一个线程产生进程内事件，另一个线程产生 I/O。
+  std::thread notifier([&] {
+    for (int i = 0; i < 1000; i++) {
+      ec.Notify();
+    }
+  });
+  std::thread writer([&] {
+    const char msg[] = "hello from the pipe";
+    [[maybe_unused]] ssize_t ret = write(pipe_fds[1], msg, sizeof(msg) - 1);
+  });
+
+  uint64_t events_seen = 0;
+  bool got_io = false;
+  while (events_seen < 1000 || !got_io) {
+    epoll_event events[2];
+    int n = epoll_wait(epfd, events, 2, -1);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      throw std::system_error(errno, std::generic_category(), "epoll_wait");
+    }
+    for (int i = 0; i < n; i++) {
+      if (events[i].data.fd == ec.Fd()) {
+        events_seen += ec.Consume();
+      } else {
+        char buf[64];
+        ssize_t len = read(pipe_fds[0], buf, sizeof(buf));
+        if (len > 0) {
+          got_io = true;
+          std::cout << "epoll loop read from pipe: " << std::string_view(buf, len) << "\n";
+        }
+      }
+    }
+  }
+  notifier.join();
+  writer.join();
+  std::cout << "epoll loop consumed " << events_seen << " notifications with " << ec.Wakeups()
+            << " eventfd wakeups\n";
+
+  close(epfd);
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+}
+
+// 返回进程至今消耗的 CPU 时间（用户态 + 内核态），单位秒。
+double CpuSeconds() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// 打印一次基准的结果：消费者醒来次数、每次醒来处理的通知数、吞吐以及 CPU 占用。
+void Report(const char *name, uint64_t notifications, uint64_t wakeups, double wall_s, double cpu_s) {
+  std::cout << name << ":\n"
+            << "  " << notifications << " notifications, " << wakeups << " consumer wakeups ("
+            << static_cast<double>(notifications) / wakeups << " notifications per wakeup)\n"
+            << "  " << wakeups / wall_s << " wakeups/s, " << notifications / wall_s << " notifications/s\n"
+            << "  wall " << wall_s << " s, cpu " << cpu_s << " s (" << 100.0 * cpu_s / wall_s << "% of one core)\n";
+}
+
+// 现有做法：每次状态变化都加锁、修改 count、notify_one；消费者等待 count 超过已处理的值。
+void BenchConditionVariable(int producers, uint64_t per_producer) {
+  std::mutex m;
+  std::condition_variable cv;
+  uint64_t count = 0;
+  uint64_t total = producers * per_producer;
+
+  auto start = std::chrono::steady_clock::now();
+  double cpu_start = CpuSeconds();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < producers; i++) {
+    threads.emplace_back([&] {
+      for (uint64_t j = 0; j < per_producer; j++) {
+        std::scoped_lock slk(m);
+        count += 1;
+        cv.notify_one();
+      }
+    });
+  }
+
+  uint64_t seen = 0;
+  uint64_t wakeups = 0;
+  while (seen < total) {
+    std::unique_lock lk(m);
+    cv.wait(lk, [&] { return count > seen; });
+    seen = count;
+    wakeups += 1;
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  Report("condition_variable (notify per change)", total, wakeups, wall_s, CpuSeconds() - cpu_start);
+}
+
+// EventCount 做法：生产者只做一次原子加法，只有计数器从 0 变为 1 时才写 eventfd。
+void BenchEventCount(int producers, uint64_t per_producer) {
+  EventCount ec;
+  uint64_t total = producers * per_producer;
+
+  auto start = std::chrono::steady_clock::now();
+  double cpu_start = CpuSeconds();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < producers; i++) {
+    threads.emplace_back([&] {
+      for (uint64_t j = 0; j < per_producer; j++) {
+        ec.Notify();
+      }
+    });
+  }
+
+  uint64_t seen = 0;
+  uint64_t wakeups = 0;
+  while (seen < total) {
+    seen += ec.Wait();
+    wakeups += 1;
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  Report("EventCount (coalesced eventfd)", total, wakeups, wall_s, CpuSeconds() - cpu_start);
+  std::cout << "  eventfd writes: " << ec.Wakeups() << "\n";
+}
+
+// 与 condition_variable.cpp 相同的小例子：两个线程各通知一次，等待者在收到两个通知后打印 count。
+// 这两个通知可能被合并为一次唤醒。
+void CountDemo() {
+  EventCount ec;
+  std::atomic<int> count{0};
+  auto add_count_and_notify = [&] {
+    count.fetch_add(1);
+    ec.Notify();
+  };
+  std::thread t1(add_count_and_notify);
+  std::thread t2(add_count_and_notify);
+  uint64_t seen = 0;
+  while (seen < 2) {
+    seen += ec.Wait();
+  }
+  std::cout << "Printing count: " << count.load() << std::endl;
+  t1.join();
+  t2.join();
+}
+
+// 用法：./event_count [生产者线程数] [每个生产者的通知数]
+int main(int argc, char *argv[]) {
+  int producers = argc > 1 ? std::stoi(argv[1]) : 4;
+  uint64_t per_producer = argc > 2 ? std::stoull(argv[2]) : 250000;
+
+  CountDemo();
+  EpollDemo();
+
+  BenchConditionVariable(producers, per_producer);
+  BenchEventCount(producers, per_producer);
+  return 0;
+}
@@ -0,0 +1,285 @@
+/**
+ * @file expression_templates.cpp
+ * @brief 表达式模板（expression templates）的教学示例：把逐元素的数组运算融合成一个循环。
+ */
+
+// 如果把 templated_functions.cpp 中的 add<T> 直接推广到数组，写成
+//   std::vector<T> add(const std::vector<T> &a, const std::vector<T> &b);
+// 那么 add(add(a, b), c) 会先分配一个临时数组保存 a + b，再分配一个数组保存结果。
+// 表达式 a + b * c - d 会产生三个临时数组，每个元素要在内存中读写很多次。
+// 对于放不进缓存的大数组，这些额外的内存流量直接决定了运行时间。
+
+// 表达式模板的思路是：运算符不立即计算，而是返回一个描述“这个运算”的轻量对象。例如 a + b 返回
+// BinaryExpr<Add, Array, Array>，它只保存对 a 和 b 的引用。整个表达式 a + b * c - d 的类型是一棵
+// 嵌套的模板类型树。只有在把表达式赋值给 Array 时，才用一个循环逐元素求值：
+//   for (i ...) out[i] = a[i] + b[i] * c[i] - d[i];
+// 这个循环没有临时数组，每个输入只读一次，结果只写一次，而且编译器可以对它自动向量化。
+
+// 这是 Eigen、Blaze 等线性代数库的核心技术。参考：
+// https://en.wikipedia.org/wiki/Expression_templates
+
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::invalid_argument。
+#include <stdexcept>
+// 包含 std::string（用于解析命令行参数）。
+#include <string>
+// 包含 std::is_same_v。
+#include <type_traits>
+// 包含 std::vector。
+#include <vector>
+
+// 所有表达式的基类，使用 CRTP（奇异递归模板模式）：Derived 是具体的表达式类型。
+// 运算符只接受 Expr<...> 的派生类，从而不会误匹配其他类型。Self() 把基类引用转换回具体类型。
+template <typename Derived>
+class Expr {
+ public:
+  const Derived &Self() const { return static_cast<const Derived &>(*this); }
+};
+
+// 四种逐元素运算。每个运算是一个只有静态函数的空类型，作为模板参数传入 BinaryExpr。
+struct AddOp {
+  template <typename T>
+  static T Apply(T a, T b) {
+    return a + b;
+  }
+};
+struct SubOp {
+  template <typename T>
+  static T Apply(T a, T b) {
+    return a - b;
+  }
+};
+struct MulOp {
+  template <typename T>
+  static T Apply(T a, T b) {
+    return a * b;
+  }
+};
+struct DivOp {
+  template <typename T>
+  static T Apply(T a, T b) {
+    return a / b;
+  }
+};
+
+// 表达式树中的内部节点：保存左右子表达式，operator[] 在需要时才计算第 i 个元素。
+// 子表达式按引用保存。因为 Array 之外的节点都是临时对象，表达式必须在同一个完整表达式内被求值，
+// 不要用 auto 保存一个表达式再在之后使用（那时临时节点已被销毁）。
+template <typename Op, typename L, typename R>
+class BinaryExpr : public Expr<BinaryExpr<Op, L, R>> {
+ public:
+  using value_type = typename L::value_type;
+
+  BinaryExpr(const L &lhs, const R &rhs) : lhs_(lhs), rhs_(rhs) {}
+
+  value_type operator[](size_t i) const { return Op::Apply(lhs_[i], rhs_[i]); }
+  size_t size() const { return lhs_.size(); }
+
+ private:
+  const L &lhs_;
+  const R &rhs_;
+};
+
+// 数组，同时也是表达式树的叶子节点。
+template <typename T>
+class Array : public Expr<Array<T>> {
+ public:
+  using value_type = T;
+
+  explicit Array(size_t size, T init = T()) : data_(size, init) {}
+
+  // 从任意表达式构造：这里才真正执行计算，而且只有一个循环。
+  template <typename E>
+  Array(const Expr<E> &expr) : data_(expr.Self().size()) {
+    Assign(expr.Self());
+  }
+
+  template <typename E>
+  Array &operator=(const Expr<E> &expr) {
+    if (expr.Self().size() != size()) {
+      throw std::invalid_argument("array sizes do not match");
+    }
+    Assign(expr.Self());
+    return *this;
+  }
+
+  T &operator[](size_t i) { return data_[i]; }
+  T operator[](size_t i) const { return data_[i]; }
+  size_t size() const { return data_.size(); }
+  T *data() { return data_.data(); }
+
+ private:
+  // 融合循环。E::operator[] 会被完全内联，最终得到一个简单的、可向量化的循环。
+  // 注意：a = a + b 这种右侧引用自身的写法是安全的，因为第 i 个结果只依赖各输入的第 i 个元素。
+  template <typename E>
+  void Assign(const E &expr) {
+    T *out = data_.data();
+    const size_t n = data_.size();
+    for (size_t i = 0; i < n; i++) {
+      out[i] = expr[i];
+    }
+  }
+
+  std::vector<T> data_;
+};
+
+// 构造 BinaryExpr 之前检查两侧大小一致。
+template <typename Op, typename L, typename R>
+BinaryExpr<Op, L, R> MakeExpr(const L &lhs, const R &rhs) {
+  if (lhs.size() != rhs.size()) {
+    throw std::invalid_argument("array sizes do not match");
+  }
+  return BinaryExpr<Op, L, R>(lhs, rhs);
+}
+
+// 运算符重载：两侧都是表达式时构造 BinaryExpr。
+template <typename L, typename R>
+BinaryExpr<AddOp, L, R> operator+(const Expr<L> &lhs, const Expr<R> &rhs) {
+  return MakeExpr<AddOp>(lhs.Self(), rhs.Self());
+}
+template <typename L, typename R>
+BinaryExpr<SubOp, L, R> operator-(const Expr<L> &lhs, const Expr<R> &rhs) {
+  return MakeExpr<SubOp>(lhs.Self(), rhs.Self());
+}
+template <typename L, typename R>
+BinaryExpr<MulOp, L, R> operator*(const Expr<L> &lhs, const Expr<R> &rhs) {
+  return MakeExpr<MulOp>(lhs.Self(), rhs.Self());
+}
+template <typename L, typename R>
+BinaryExpr<DivOp, L, R> operator/(const Expr<L> &lhs, const Expr<R> &rhs) {
+  return MakeExpr<DivOp>(lhs.Self(), rhs.Self());
+}
+
+// 表达式与标量的乘法，使 (a + b) * 10.0f 这样的写法也能参与融合。
+// 标量很小，按值保存；子表达式仍按引用保存。
+template <typename E>
+class ScaledExpr : public Expr<ScaledExpr<E>> {
+ public:
+  using value_type = typename E::value_type;
+
+  ScaledExpr(const E &expr, value_type factor) : expr_(expr), factor_(factor) {}
+
+  value_type operator[](size_t i) const { return expr_[i] * factor_; }
+  size_t size() const { return expr_.size(); }
+
+ private:
+  const E &expr_;
+  value_type factor_;
+};
+
+template <typename E>
+ScaledExpr<E> operator*(const Expr<E> &expr, typename E::value_type factor) {
+  return ScaledExpr<E>(expr.Self(), factor);
+}
+
+// 对照组：add<T> 直接推广到数组的“朴素”写法，每一步都分配并写出一个临时数组。
+template <typename T>
+std::vector<T> add(const std::vector<T> &a, const std::vector<T> &b) {
+  std::vector<T> out(a.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    out[i] = a[i] + b[i];
+  }
+  return out;
+}
+
+template <typename T>
+std::vector<T> sub(const std::vector<T> &a, const std::vector<T> &b) {
+  std::vector<T> out(a.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    out[i] = a[i] - b[i];
+  }
+  return out;
+}
+
+template <typename T>
+std::vector<T> mul(const std::vector<T> &a, const std::vector<T> &b) {
+  std::vector<T> out(a.size());
+  for (size_t i = 0; i < a.size(); i++) {
+    out[i] = a[i] * b[i];
+  }
+  return out;
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 打印一次测量的结果。bytes 是按“每个数组读/写一次”估算的内存流量（不含缓存未命中的额外开销）。
+void Report(const char *name, size_t n, double seconds, double bytes) {
+  std::cout << "    " << name << ": " << seconds * 1000 << " ms, " << n / seconds / 1e6 << " M elements/s, "
+            << bytes / 1e6 << " MB moved, " << bytes / seconds / 1e9 << " GB/s\n";
+}
+
+// 比较 out = a + b * c - d 的三种写法。
+void Bench(size_t n) {
+  using T = float;
+  std::cout << "n = " << n << "\n";
+  std::vector<T> va(n, 1.0f);
+  std::vector<T> vb(n, 2.0f);
+  std::vector<T> vc(n, 3.0f);
+  std::vector<T> vd(n, 4.0f);
+
+  // 朴素写法：b * c、a + (b * c)、(...) - d 各产生一个新数组。
+  // 每步读两个数组、写一个数组，共 9 次数组大小的内存流量，外加三次分配。
+  auto start = std::chrono::steady_clock::now();
+  std::vector<T> naive = sub(add(va, mul(vb, vc)), vd);
+  Report("naive temporaries  ", n, SecondsSince(start), 9.0 * n * sizeof(T));
+
+  // 表达式模板：一个循环，读四个数组、写一个数组，共 5 次数组大小的内存流量。
+  Array<T> a(n, 1.0f);
+  Array<T> b(n, 2.0f);
+  Array<T> c(n, 3.0f);
+  Array<T> d(n, 4.0f);
+  Array<T> out(n);
+  start = std::chrono::steady_clock::now();
+  out = a + b * c - d;
+  Report("expression template", n, SecondsSince(start), 5.0 * n * sizeof(T));
+
+  // 手写的融合循环，作为表达式模板能达到的上限。
+  std::vector<T> manual(n);
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < n; i++) {
+    manual[i] = va[i] + vb[i] * vc[i] - vd[i];
+  }
+  Report("hand-written loop  ", n, SecondsSince(start), 5.0 * n * sizeof(T));
+
+  if (naive[n - 1] != out[n - 1] || manual[n - 1] != out[n - 1]) {
+    std::cout << "    results disagree!\n";
+  }
+}
+
+// 用法：./expression_templates [最大数组长度]
+// 默认只测到 1000 万个元素；测 1 亿个元素时需要约 3GB 内存。
+int main(int argc, char *argv[]) {
+  size_t max_size = argc > 1 ? std::stoul(argv[1]) : 10'000'000;
+
+  // 第一部分：表达式的类型与求值。
+  Array<float> a(4, 1.0f);
+  Array<float> b(4, 2.0f);
+  Array<float> c(4, 3.0f);
+  Array<float> d(4, 4.0f);
+  Array<float> result = a + b * c - d;
+  std::cout << "Printing a + b * c - d: ";
+  for (size_t i = 0; i < result.size(); i++) {
+    std::cout << result[i] << " ";
+  }
+  std::cout << std::endl;
+
+  Array<float> scaled = (a + b) * 10.0f;
+  std::cout << "Printing (a + b) * 10: " << scaled[0] << std::endl;
+
+  // a + b * c - d 的类型是一棵嵌套的模板类型树，而不是数组：
+  // BinaryExpr<SubOp, BinaryExpr<AddOp, Array<float>, BinaryExpr<MulOp, Array<float>, Array<float>>>, Array<float>>
+  using Product = BinaryExpr<MulOp, Array<float>, Array<float>>;
+  static_assert(std::is_same_v<decltype(a + b * c - d),
+                               BinaryExpr<SubOp, BinaryExpr<AddOp, Array<float>, Product>, Array<float>>>);
+
+  // 第二部分：从 100 万到 max_size 个元素的性能对比。
+  for (size_t n = 1'000'000; n <= max_size; n *= 10) {
+    Bench(n);
+  }
+  return 0;
+}
@@ -0,0 +1,554 @@
+/**
+ * @file external_sort.cpp
+ * @brief 外部归并排序：在内存预算内并行生成有序的归并段（run）并写入临时文件，
+ *        再用败者树（loser tree）做 k 路归并，归并时由后台 I/O 线程异步预读。
+ */
+
+// vectors.cpp 中的 std::vector<int> 可以直接用 std::sort 排序，前提是所有数据都能放进内存。
+// 数据比内存大时使用外部排序，分两个阶段：
+// 1. 生成归并段：每次读入内存预算能容纳的一段数据，在内存中排好序，写入一个临时文件。
+//    内存预算平均分给 threads 个工作线程，每个线程独立地读、排序、写，因此 CPU 与 I/O 可以重叠。
+// 2. 归并：同时打开 k 个归并段，每次输出 k 个段当前最小的那个元素。用败者树选出最小值只需要
+//    log2(k) 次比较：树的内部节点记录“比赛”的败者，胜者一路向上，根之上记录总冠军。
+//    某个段输出一个元素之后，只需要沿着它的叶子到根的路径重新比赛（Knuth，TAOCP 第 3 卷 5.4.1）。
+//    每个段有两个缓冲块：归并线程消耗其中一个时，后台 I/O 线程已经在读下一块（预读），
+//    输出同样使用两个缓冲块，一个在写盘时另一个接收归并结果。
+//    段太多、每个段分到的缓冲块太小时，先把段分组归并成更少、更长的段（多趟归并）。
+// 程序统计读写的总字节数：生成归并段读写各一遍，每一趟归并再读写各一遍。
+
+// 包含 fcntl 头文件（open）。
+#include <fcntl.h>
+// 包含 pread、pwrite、close、unlink。
+#include <unistd.h>
+
+// 包含 std::sort、std::is_sorted。
+#include <algorithm>
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 errno。
+#include <cerrno>
+// 包含 std::exit。
+#include <cstdlib>
+// 包含 std::condition_variable。
+#include <condition_variable>
+// 包含 std::deque。
+#include <deque>
+// 包含 std::function。
+#include <functional>
+// 包含 std::future 与 std::packaged_task。
+#include <future>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::numeric_limits。
+#include <limits>
+// 包含 std::mutex。
+#include <mutex>
+// 包含 std::queue。
+#include <queue>
+// 包含 std::mt19937（用于生成数据）。
+#include <random>
+// 包含 std::invalid_argument。
+#include <stdexcept>
+// 包含 std::string。
+#include <string>
+// 包含 std::system_error。
+#include <system_error>
+// 包含 thread 头文件。
+#include <thread>
+// 包含 std::move、std::swap。
+#include <utility>
+// 包含 std::vector。
+#include <vector>
+
+// 读写的总字节数。
+std::atomic<uint64_t> bytes_read{0};
+std::atomic<uint64_t> bytes_written{0};
+
+// 管理一个临时文件的 RAII 包装类，析构时关闭并删除文件。
+class TempFile {
+ public:
+  explicit TempFile(std::string path) : path_(std::move(path)) {
+    fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+      throw std::system_error(errno, std::generic_category(), "open " + path_);
+    }
+  }
+
+  ~TempFile() {
+    if (fd_ >= 0) {
+      close(fd_);
+      unlink(path_.c_str());
+    }
+  }
+
+  TempFile(TempFile &&other) noexcept : path_(std::move(other.path_)), fd_(other.fd_) { other.fd_ = -1; }
+  TempFile(const TempFile &) = delete;
+  TempFile &operator=(const TempFile &) = delete;
+  TempFile &operator=(TempFile &&) = delete;
+
+  // 从 offset 处读 count 个 int，返回实际读到的个数。
+  size_t Read(int *data, size_t count, uint64_t offset) const {
+    size_t done = 0;
+    while (done < count * sizeof(int)) {
+      ssize_t n = pread(fd_, reinterpret_cast<char *>(data) + done, count * sizeof(int) - done, offset + done);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        throw std::system_error(errno, std::generic_category(), "pread " + path_);
+      }
+      if (n == 0) {
+        break;
+      }
+      done += n;
+    }
+    bytes_read += done;
+    return done / sizeof(int);
+  }
+
+  void Write(const int *data, size_t count, uint64_t offset) const {
+    size_t done = 0;
+    while (done < count * sizeof(int)) {
+      ssize_t n = pwrite(fd_, reinterpret_cast<const char *>(data) + done, count * sizeof(int) - done, offset + done);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        throw std::system_error(errno, std::generic_category(), "pwrite " + path_);
+      }
+      done += n;
+    }
+    bytes_written += done;
+  }
+
+ private:
+  std::string path_;
+  int fd_;
+};
+
+// 一个归并段：文件中从 offset_ 开始的 count_ 个有序的 int。
+struct Run {
+  const TempFile *file_;
+  uint64_t offset_;
+  size_t count_;
+};
+
+// 后台 I/O 线程：按提交顺序执行读写任务，通过 std::future 通知完成。
+class IoThread {
+ public:
+  IoThread() : thread_([this] { Loop(); }) {}
+
+  ~IoThread() {
+    {
+      std::scoped_lock lk(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+  }
+
+  IoThread(const IoThread &) = delete;
+  IoThread &operator=(const IoThread &) = delete;
+
+  template <typename Fn>
+  auto Submit(Fn fn) {
+    std::packaged_task<decltype(fn())()> task(std::move(fn));
+    auto future = task.get_future();
+    {
+      std::scoped_lock lk(mutex_);
+      queue_.emplace([task = std::make_shared<decltype(task)>(std::move(task))] { (*task)(); });
+    }
+    cv_.notify_one();
+    return future;
+  }
+
+ private:
+  void Loop() {
+    std::unique_lock lk(mutex_);
+    while (true) {
+      cv_.wait(lk, [&] { return stop_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      auto task = std::move(queue_.front());
+      queue_.pop();
+      lk.unlock();
+      task();
+      lk.lock();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::queue<std::function<void()>> queue_;
+  bool stop_{false};
+  std::thread thread_;
+};
+
+// 顺序读一个归并段，两个缓冲块轮流使用：当前块被消耗时，下一块已经交给 I/O 线程去读。
+class RunReader {
+ public:
+  RunReader(const Run &run, size_t block, IoThread *io) : run_(run), block_(block), io_(io) {
+    current_.resize(block);
+    next_.resize(block);
+    Prefetch();
+    Swap();
+  }
+
+  bool Exhausted() const { return pos_ == size_; }
+  int Head() const { return current_[pos_]; }
+
+  void Advance() {
+    if (++pos_ == size_ && pending_.valid()) {
+      Swap();
+    }
+  }
+
+ private:
+  void Prefetch() {
+    size_t count = std::min(block_, run_.count_ - requested_);
+    if (count == 0) {
+      return;
+    }
+    uint64_t offset = run_.offset_ + requested_ * sizeof(int);
+    requested_ += count;
+    int *dest = next_.data();
+    const TempFile *file = run_.file_;
+    pending_ = io_->Submit([file, dest, count, offset] { return file->Read(dest, count, offset); });
+  }
+
+  // 等待预读的块，把它变成当前块，再预读下一块。
+  void Swap() {
+    size_ = pending_.valid() ? pending_.get() : 0;
+    pos_ = 0;
+    std::swap(current_, next_);
+    Prefetch();
+  }
+
+  Run run_;
+  size_t block_;
+  IoThread *io_;
+  std::vector<int> current_;
+  std::vector<int> next_;
+  std::future<size_t> pending_;
+  size_t requested_{0};
+  size_t pos_{0};
+  size_t size_{0};
+};
+
+// 顺序写，两个缓冲块轮流使用：一块交给 I/O 线程写盘时，归并结果写入另一块。
+class RunWriter {
+ public:
+  RunWriter(const TempFile *file, uint64_t offset, size_t block, IoThread *io)
+      : file_(file), offset_(offset), block_(block), io_(io) {
+    current_.reserve(block);
+    flushing_.reserve(block);
+  }
+
+  void Append(int value) {
+    current_.push_back(value);
+    if (current_.size() == block_) {
+      Flush();
+    }
+  }
+
+  // 写出剩余的数据并等待所有写入完成，返回写入的 int 个数。
+  size_t Finish() {
+    Flush();
+    if (pending_.valid()) {
+      pending_.get();
+    }
+    return written_;
+  }
+
+ private:
+  void Flush() {
+    if (pending_.valid()) {
+      pending_.get();
+    }
+    if (current_.empty()) {
+      return;
+    }
+    std::swap(current_, flushing_);
+    current_.clear();
+    const TempFile *file = file_;
+    const int *data = flushing_.data();
+    size_t count = flushing_.size();
+    uint64_t offset = offset_ + written_ * sizeof(int);
+    written_ += count;
+    pending_ = io_->Submit([file, data, count, offset] { file->Write(data, count, offset); });
+  }
+
+  const TempFile *file_;
+  uint64_t offset_;
+  size_t block_;
+  IoThread *io_;
+  std::vector<int> current_;
+  std::vector<int> flushing_;
+  std::future<void> pending_;
+  size_t written_{0};
+};
+
+// 败者树。叶子是 k 个归并段，tree_[1..k-1] 记录每场比赛的败者，tree_[0] 是当前的总冠军。
+// 每个节点同时保存选手的编号与它当前的首元素（键），比赛只比较节点中的键，不需要访问 RunReader。
+// 读完的段的键是 kExhausted，比所有 int 都大；编号 k 是一个键为 kSentinel 的虚拟选手，
+// 比所有 int 都小，只在建树时使用。
+class LoserTree {
+ public:
+  explicit LoserTree(std::vector<RunReader> *readers)
+      : readers_(readers), k_(readers->size()), tree_(std::max<size_t>(k_, 1), Entry{kSentinel, k_}) {
+    if (k_ == 0) {
+      tree_[0] = Entry{kExhausted, 0};
+    }
+    for (size_t i = k_; i-- > 0;) {
+      Replay(i);
+    }
+  }
+
+  // 返回当前最小元素所在的段，所有段都读完时返回 -1。
+  int Winner() const { return tree_[0].key_ == kExhausted ? -1 : static_cast<int>(tree_[0].index_); }
+
+  // 段 s 前进一个元素之后，沿着它到根的路径重新比赛：每一层与记录的败者比较，较小者继续向上。
+  // 比较的结果难以预测，所以写成条件交换，让编译器生成无分支的条件传送指令。
+  void Replay(size_t s) {
+    const RunReader &reader = (*readers_)[s];
+    Entry winner{reader.Exhausted() ? kExhausted : reader.Head(), s};
+    for (size_t t = (s + k_) / 2; t > 0; t /= 2) {
+      Entry loser = tree_[t];
+      bool swap = loser.key_ < winner.key_;
+      tree_[t] = swap ? winner : loser;
+      winner = swap ? loser : winner;
+    }
+    tree_[0] = winner;
+  }
+
+ private:
+  static constexpr int64_t kExhausted = std::numeric_limits<int64_t>::max();
+  static constexpr int64_t kSentinel = std::numeric_limits<int64_t>::min();
+
+  struct Entry {
+    int64_t key_;
+    size_t index_;
+  };
+
+  std::vector<RunReader> *readers_;
+  size_t k_;
+  std::vector<Entry> tree_;
+};
+
+struct SortStats {
+  size_t initial_runs_{0};
+  size_t merge_passes_{0};
+  double run_generation_s_{0};
+  double merge_s_{0};
+};
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+class ExternalSorter {
+ public:
+  ExternalSorter(std::string dir, size_t memory_budget_bytes, size_t threads)
+      : dir_(std::move(dir)), budget_(memory_budget_bytes / sizeof(int)), threads_(threads) {
+    if (threads_ == 0) {
+      throw std::invalid_argument("external sort needs at least one thread");
+    }
+    // 归并时每块至少 kMinBlock 个 int。两路归并需要 4 个读缓冲块和 2 个写缓冲块，预算连这都放不下就拒绝。
+    if (budget_ < kMinBudget) {
+      throw std::invalid_argument("memory budget must be at least " + std::to_string(kMinBudget * sizeof(int)) +
+                                  " bytes");
+    }
+  }
+
+  // 对 input 中的 count 个 int 排序，结果写入 output。
+  void Sort(const TempFile &input, size_t count, const TempFile &output, SortStats *stats) {
+    if (count == 0) {
+      return;
+    }
+    // 归并段通过指针引用这些文件。std::deque 在末尾添加元素时不会移动已有元素，所以指针一直有效。
+    std::deque<TempFile> files;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Run> runs = GenerateRuns(input, count, &files);
+    stats->initial_runs_ = runs.size();
+    stats->run_generation_s_ = SecondsSince(start);
+    start = std::chrono::steady_clock::now();
+
+    // 每个段两个读缓冲块、输出两个写缓冲块，都要放进内存预算。每块至少 kMinBlock 个 int（16 KB）。
+    // 构造函数保证 budget_ >= kMinBudget，所以 max_fan_in >= 2，Merge 算出的块大小也不会低于 kMinBlock。
+    const size_t max_fan_in = budget_ / (2 * kMinBlock) - 1;
+    while (runs.size() > max_fan_in) {
+      std::vector<Run> merged;
+      files.emplace_back(dir_ + "/external_sort.pass" + std::to_string(stats->merge_passes_));
+      uint64_t offset = 0;
+      for (size_t i = 0; i < runs.size(); i += max_fan_in) {
+        std::vector<Run> group(runs.begin() + i, runs.begin() + std::min(runs.size(), i + max_fan_in));
+        size_t merged_count = Merge(group, &files.back(), offset);
+        merged.push_back(Run{&files.back(), offset, merged_count});
+        offset += merged_count * sizeof(int);
+      }
+      runs = std::move(merged);
+      stats->merge_passes_++;
+    }
+    Merge(runs, &output, 0);
+    stats->merge_passes_++;
+    stats->merge_s_ = SecondsSince(start);
+  }
+
+ private:
+  static constexpr size_t kMinBlock = 4096;
+  static constexpr size_t kMinBudget = 2 * (2 + 1) * kMinBlock;
+
+  // 每个线程分到 budget_ / threads_ 个 int 的缓冲区，轮流领取输入中的一段，排序后写入自己的文件。
+  std::vector<Run> GenerateRuns(const TempFile &input, size_t count, std::deque<TempFile> *files) {
+    const size_t chunk = std::max<size_t>(1, budget_ / threads_);
+    const size_t chunks = (count + chunk - 1) / chunk;
+    std::vector<Run> runs(chunks);
+    for (size_t t = 0; t < threads_; t++) {
+      files->emplace_back(dir_ + "/external_sort.runs" + std::to_string(t));
+    }
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads_; t++) {
+      workers.emplace_back([&, t] {
+        std::vector<int> buffer(chunk);
+        const TempFile *file = &(*files)[t];
+        uint64_t offset = 0;
+        for (size_t c = next++; c < chunks; c = next++) {
+          size_t n = input.Read(buffer.data(), std::min(chunk, count - c * chunk), c * chunk * sizeof(int));
+          std::sort(buffer.begin(), buffer.begin() + n);
+          file->Write(buffer.data(), n, offset);
+          runs[c] = Run{file, offset, n};
+          offset += n * sizeof(int);
+        }
+      });
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+    return runs;
+  }
+
+  // 把一组段归并到 output 的 offset 处，返回写入的 int 个数。
+  size_t Merge(const std::vector<Run> &runs, const TempFile *output, uint64_t offset) {
+    const size_t block = std::max(kMinBlock, budget_ / (2 * (runs.size() + 1)));
+    IoThread io;
+    std::vector<RunReader> readers;
+    readers.reserve(runs.size());
+    for (auto &run : runs) {
+      readers.emplace_back(run, block, &io);
+    }
+    RunWriter writer(output, offset, block, &io);
+    LoserTree tree(&readers);
+    for (int w = tree.Winner(); w >= 0; w = tree.Winner()) {
+      writer.Append(readers[w].Head());
+      readers[w].Advance();
+      tree.Replay(w);
+    }
+    return writer.Finish();
+  }
+
+  std::string dir_;
+  size_t budget_;
+  size_t threads_;
+};
+
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::cout << "CHECK FAILED: " << what << std::endl;
+    std::exit(1);
+  }
+}
+
+// 写入 count 个随机 int，返回它们的和（用于检查排序结果）。
+uint64_t GenerateInput(const TempFile &file, size_t count) {
+  std::mt19937 rng(42);
+  std::vector<int> buffer(1 << 20);
+  uint64_t sum = 0;
+  for (size_t done = 0; done < count;) {
+    size_t n = std::min(buffer.size(), count - done);
+    for (size_t i = 0; i < n; i++) {
+      buffer[i] = static_cast<int>(rng());
+      sum += static_cast<uint32_t>(buffer[i]);
+    }
+    file.Write(buffer.data(), n, done * sizeof(int));
+    done += n;
+  }
+  return sum;
+}
+
+// 顺序读回输出文件，检查有序且元素之和不变。
+void VerifyOutput(const TempFile &file, size_t count, uint64_t expected_sum) {
+  std::vector<int> buffer(1 << 20);
+  uint64_t sum = 0;
+  int previous = std::numeric_limits<int>::min();
+  size_t total = 0;
+  for (size_t n; (n = file.Read(buffer.data(), buffer.size(), total * sizeof(int))) > 0; total += n) {
+    Check(buffer[0] >= previous && std::is_sorted(buffer.begin(), buffer.begin() + n), "the output is sorted");
+    previous = buffer[n - 1];
+    for (size_t i = 0; i < n; i++) {
+      sum += static_cast<uint32_t>(buffer[i]);
+    }
+  }
+  Check(total == count && sum == expected_sum, "the output is a permutation of the input");
+}
+
+// 边界情况：空输入，以及线程数多于内存预算能容纳的 int 个数（每个线程的缓冲区至少 1 个 int）。
+void CheckEdgeCases(const std::string &dir) {
+  // 最小预算 96 KB：扇入只有 2，8 个线程各分到 3072 个 int，会产生很多段和多趟归并。
+  const size_t min_budget = 6 * 4096 * sizeof(int);
+  for (size_t count : {0, 100, 100000}) {
+    TempFile input(dir + "/external_sort.input");
+    TempFile output(dir + "/external_sort.output");
+    uint64_t sum = GenerateInput(input, count);
+    SortStats stats;
+    ExternalSorter(dir, min_budget, 8).Sort(input, count, output, &stats);
+    VerifyOutput(output, count, sum);
+    Check(count < 100000 || stats.merge_passes_ > 1, "the smallest budget merges in several passes");
+  }
+  bool rejected = false;
+  try {
+    ExternalSorter(dir, min_budget - 1, 1);
+  } catch (const std::invalid_argument &) {
+    rejected = true;
+  }
+  Check(rejected, "a budget that cannot hold the merge buffers is rejected");
+  std::cout << "Empty input and the smallest allowed budget sort correctly; smaller budgets are rejected\n";
+}
+
+// 用法：./external_sort [内存预算（MB）] [线程数] [临时文件目录]
+int main(int argc, char *argv[]) {
+  size_t budget_mb = argc > 1 ? std::stoul(argv[1]) : 8;
+  size_t threads = argc > 2 ? std::stoul(argv[2]) : 4;
+  std::string dir = argc > 3 ? argv[3] : ".";
+  const size_t budget_bytes = budget_mb << 20;
+
+  CheckEdgeCases(dir);
+  std::cout << "External sort with a " << budget_mb << " MB memory budget and " << threads << " threads\n";
+  for (size_t multiple : {1, 4, 16}) {
+    size_t count = budget_bytes * multiple / sizeof(int);
+    TempFile input(dir + "/external_sort.input");
+    TempFile output(dir + "/external_sort.output");
+    uint64_t sum = GenerateInput(input, count);
+
+    bytes_read = 0;
+    bytes_written = 0;
+    SortStats stats;
+    auto start = std::chrono::steady_clock::now();
+    ExternalSorter(dir, budget_bytes, threads).Sort(input, count, output, &stats);
+    double seconds = SecondsSince(start);
+    uint64_t read = bytes_read;
+    uint64_t written = bytes_written;
+    VerifyOutput(output, count, sum);
+
+    double input_mb = static_cast<double>(count * sizeof(int)) / (1 << 20);
+    std::cout << "  " << multiple << "x budget (" << input_mb << " MB): " << stats.initial_runs_ << " runs, "
+              << stats.merge_passes_ << " merge pass(es), " << seconds << " s (runs " << stats.run_generation_s_
+              << " s, merge " << stats.merge_s_ << " s), " << input_mb / seconds
+              << " MB/s, read " << read / (1 << 20) << " MB, wrote " << written / (1 << 20) << " MB ("
+              << static_cast<double>(read + written) / (count * sizeof(int)) << "x the input)\n";
+  }
+  return 0;
+}
@@ -0,0 +1,584 @@
+/**
+ * @file hash_aggregation.cpp
+ * @brief 流式哈希聚合：每个线程先在本地哈希表中做部分预聚合，超出内存预算时把哈希表按哈希值分区
+ *        溢出（spill）到本地临时文件，最后逐个分区读回并合并，分区仍然放不下时递归地再分区。
+ */
+
+// unordered_maps.cpp 中用 map["spam"] = 15 这样的写法更新 std::unordered_map，做计数或分组聚合
+// （GROUP BY）非常方便。但分组数很多（高基数）时，这个 map 会一直增长直到耗尽内存。
+// 本文件实现 SELECT key, COUNT(*), SUM(value) ... GROUP BY key 的哈希聚合算子，内存使用有上限：
+// 1. 预聚合：输入被切成 morsel（每块 kMorselSize 行），工作线程动态领取 morsel，
+//    把每一行累加到自己的本地哈希表中，线程之间没有任何同步。分组数少（低基数）时，
+//    本地表很小，整个聚合在内存中完成，最后按分区并行地合并各个线程的本地表。
+// 2. 溢出：内存预算平均分给各个线程。预聚合的本地表最多使用每个线程预算的一半，另一半留给
+//    没有溢出时合并本地表用的哈希表。本地表达到容量上限时，把其中所有分组按哈希值的
+//    高 kFanoutBits 位分成 kFanout 个分区，经过每个分区一个的小写缓冲区追加到该线程的临时文件中，
+//    然后清空哈希表继续聚合。预聚合使同一个键在溢出之前已经合并，写出的数据量小于输入。
+// 3. 合并：一旦有线程溢出，所有本地表都溢出到文件中，然后工作线程逐个领取分区，读回该分区
+//    所有的片段（segment）并用一个新的哈希表合并。同一个键的所有部分结果都在同一个分区中，
+//    所以每个分区合并完就可以输出。某个分区仍然放不下时，用哈希值中接下来的 kFanoutBits 位
+//    对它再分区、再合并（递归深度记录在统计信息中）。
+// 哈希表使用线性探测的开放寻址（与 radix_hash_join.cpp 相同），count_ 为 0 的槽位是空槽位。
+// 哈希函数是一个双射，不同的键的哈希值一定不同，所以递归地再分区最终一定能放进内存。
+
+// 包含 fcntl 头文件（open）。
+#include <fcntl.h>
+// 包含 mallinfo2（用于统计 std::unordered_map 使用的堆内存）。
+#include <malloc.h>
+// 包含 pread、pwrite、close、unlink。
+#include <unistd.h>
+
+// 包含 std::min、std::max。
+#include <algorithm>
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 errno。
+#include <cerrno>
+// 包含 std::exit。
+#include <cstdlib>
+// 包含 std::function。
+#include <functional>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::shared_ptr、std::unique_ptr。
+#include <memory>
+// 包含 std::mutex。
+#include <mutex>
+// 包含 std::mt19937_64（用于生成数据）。
+#include <random>
+// 包含 std::invalid_argument、std::logic_error。
+#include <stdexcept>
+// 包含 std::string。
+#include <string>
+// 包含 std::system_error。
+#include <system_error>
+// 包含 thread 头文件。
+#include <thread>
+// 包含 std::unordered_map。
+#include <unordered_map>
+// 包含 std::move。
+#include <utility>
+// 包含 std::vector。
+#include <vector>
+
+// 输入的一行。
+struct Row {
+  uint64_t key_;
+  int64_t value_;
+};
+
+// 一个分组的（部分）聚合结果。count_ 为 0 表示哈希表中的空槽位。
+struct Group {
+  uint64_t key_;
+  uint64_t count_;
+  int64_t sum_;
+};
+
+// 每次分区使用的哈希值位数与分区数。
+constexpr int kFanoutBits = 5;
+constexpr size_t kFanout = size_t{1} << kFanoutBits;
+// 每个分区的溢出写缓冲区，以及读回时每次读入的分组数。
+constexpr size_t kSpillBlock = 256;
+// 每个 morsel 的行数。
+constexpr size_t kMorselSize = 4096;
+// 哈希表的初始容量，达到容量的 3/4 时翻倍（或溢出）。
+constexpr size_t kInitialCapacity = 1024;
+
+// MurmurHash3 的 64 位终结函数，是一个双射。
+inline uint64_t Hash(uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xFF51AFD7ED558CCDULL;
+  key ^= key >> 33;
+  key *= 0xC4CEB9FE1A85EC53ULL;
+  key ^= key >> 33;
+  return key;
+}
+
+// 第 depth 层分区使用哈希值的第 depth 组高 kFanoutBits 位；哈希表的槽位使用低位，与分区无关。
+inline size_t PartitionOf(uint64_t hash, int depth) {
+  return (hash >> (64 - kFanoutBits * (depth + 1))) & (kFanout - 1);
+}
+
+// 溢出文件读写的总字节数。
+std::atomic<uint64_t> bytes_spilled{0};
+std::atomic<uint64_t> bytes_read_back{0};
+
+// 一个只追加的溢出文件的 RAII 包装类，析构时关闭并删除文件。只有创建它的线程追加，
+// 读回时可以有多个线程并发地 pread。
+class SpillFile {
+ public:
+  explicit SpillFile(std::string path) : path_(std::move(path)) {
+    fd_ = open(path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+      throw std::system_error(errno, std::generic_category(), "open " + path_);
+    }
+  }
+
+  ~SpillFile() {
+    close(fd_);
+    unlink(path_.c_str());
+  }
+
+  SpillFile(const SpillFile &) = delete;
+  SpillFile &operator=(const SpillFile &) = delete;
+
+  // 把 count 个分组追加到文件末尾，返回它们的偏移量。
+  uint64_t Append(const Group *groups, size_t count) {
+    const uint64_t offset = size_;
+    const size_t bytes = count * sizeof(Group);
+    size_t done = 0;
+    while (done < bytes) {
+      ssize_t n = pwrite(fd_, reinterpret_cast<const char *>(groups) + done, bytes - done, offset + done);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        throw std::system_error(errno, std::generic_category(), "pwrite " + path_);
+      }
+      done += n;
+    }
+    size_ += bytes;
+    bytes_spilled += bytes;
+    return offset;
+  }
+
+  void Read(Group *groups, size_t count, uint64_t offset) const {
+    const size_t bytes = count * sizeof(Group);
+    size_t done = 0;
+    while (done < bytes) {
+      ssize_t n = pread(fd_, reinterpret_cast<char *>(groups) + done, bytes - done, offset + done);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        throw std::system_error(errno, std::generic_category(), "pread " + path_);
+      }
+      if (n == 0) {
+        throw std::runtime_error("unexpected end of spill file " + path_);
+      }
+      done += n;
+    }
+    bytes_read_back += bytes;
+  }
+
+ private:
+  std::string path_;
+  int fd_;
+  uint64_t size_{0};
+};
+
+// 某个分区在某个溢出文件中的一段。最后一个引用它的片段被释放时，文件被删除。
+struct Segment {
+  std::shared_ptr<SpillFile> file_;
+  uint64_t offset_;
+  size_t count_;
+};
+
+using Partitions = std::vector<std::vector<Segment>>;
+
+// 线性探测的聚合哈希表，最多 max_capacity_ 个槽位；满了就按第 depth_ 层分区溢出到自己的文件中。
+class AggregationTable {
+ public:
+  AggregationTable(size_t max_capacity, int depth, std::string dir)
+      : slots_(std::min(kInitialCapacity, max_capacity)),
+        max_capacity_(max_capacity),
+        depth_(depth),
+        dir_(std::move(dir)) {}
+
+  AggregationTable(const AggregationTable &) = delete;
+  AggregationTable &operator=(const AggregationTable &) = delete;
+
+  void Add(const Group &group) {
+    const size_t mask = slots_.size() - 1;
+    for (size_t i = Hash(group.key_) & mask;; i = (i + 1) & mask) {
+      Group &slot = slots_[i];
+      if (slot.count_ == 0) {
+        slot = group;
+        if (++size_ * 4 > slots_.size() * 3) {
+          GrowOrSpill();
+        }
+        return;
+      }
+      if (slot.key_ == group.key_) {
+        slot.count_ += group.count_;
+        slot.sum_ += group.sum_;
+        return;
+      }
+    }
+  }
+
+  // 把表中剩下的所有分组溢出到文件中。
+  void Spill() {
+    if (depth_ >= 64 / kFanoutBits) {
+      throw std::logic_error("hash aggregation partitioned deeper than the hash has bits");
+    }
+    if (file_ == nullptr) {
+      static std::atomic<uint64_t> next_file{0};
+      file_ = std::make_shared<SpillFile>(dir_ + "/hash_aggregation.spill" + std::to_string(next_file++));
+      buffers_.resize(kFanout);
+      for (auto &buffer : buffers_) {
+        buffer.reserve(kSpillBlock);
+      }
+      partitions_.resize(kFanout);
+    }
+    for (auto &slot : slots_) {
+      if (slot.count_ != 0) {
+        size_t p = PartitionOf(Hash(slot.key_), depth_);
+        buffers_[p].push_back(slot);
+        if (buffers_[p].size() == kSpillBlock) {
+          WriteBlock(p);
+        }
+        slot.count_ = 0;
+      }
+    }
+    for (size_t p = 0; p < kFanout; p++) {
+      WriteBlock(p);
+    }
+    size_ = 0;
+  }
+
+  bool Spilled() const { return file_ != nullptr; }
+  size_t Size() const { return size_; }
+
+  // 取走所有溢出片段（调用之前应先 Spill()，使表中不再有分组）。
+  Partitions TakePartitions() { return std::move(partitions_); }
+
+  template <typename Fn>
+  void ForEach(Fn fn) const {
+    for (auto &slot : slots_) {
+      if (slot.count_ != 0) {
+        fn(slot);
+      }
+    }
+  }
+
+ private:
+  void GrowOrSpill() {
+    if (slots_.size() >= max_capacity_) {
+      Spill();
+      return;
+    }
+    std::vector<Group> old = std::move(slots_);
+    slots_.assign(old.size() * 2, Group{0, 0, 0});
+    size_ = 0;
+    for (auto &group : old) {
+      if (group.count_ != 0) {
+        Add(group);
+      }
+    }
+  }
+
+  void WriteBlock(size_t p) {
+    auto &buffer = buffers_[p];
+    if (!buffer.empty()) {
+      uint64_t offset = file_->Append(buffer.data(), buffer.size());
+      partitions_[p].push_back(Segment{file_, offset, buffer.size()});
+      buffer.clear();
+    }
+  }
+
+  std::vector<Group> slots_;
+  size_t size_{0};
+  size_t max_capacity_;
+  int depth_;
+  std::string dir_;
+  std::shared_ptr<SpillFile> file_;
+  std::vector<std::vector<Group>> buffers_;
+  Partitions partitions_;
+};
+
+struct AggregationStats {
+  size_t groups_{0};
+  bool spilled_{false};
+  // 合并时最深的再分区层数（0 表示只在预聚合时溢出过，或者没有溢出）。
+  int max_depth_{0};
+  double pre_aggregation_s_{0};
+  double merge_s_{0};
+};
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 启动 threads 个线程运行 worker(t)，等待它们全部结束。
+void RunWorkers(size_t threads, const std::function<void(size_t)> &worker) {
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < threads; t++) {
+    workers.emplace_back(worker, t);
+  }
+  for (auto &thread : workers) {
+    thread.join();
+  }
+}
+
+class HashAggregation {
+ public:
+  // 内存预算涵盖所有线程的哈希表与溢出写缓冲区。
+  // - 预聚合与内存中合并：每个线程同时持有一个本地表和一个合并用的表，各占每个线程预算的一半；
+  // - 溢出之后：本地表已经释放，每个线程同时只持有一个哈希表，可以使用每个线程的全部预算。
+  HashAggregation(std::string dir, size_t memory_budget_bytes, size_t threads)
+      : dir_(std::move(dir)), budget_(memory_budget_bytes), threads_(threads) {
+    const size_t per_thread = budget_ / threads_;
+    const size_t buffer_bytes = kFanout * kSpillBlock * sizeof(Group);
+    if (per_thread / 2 < 2 * buffer_bytes) {
+      throw std::invalid_argument("memory budget is too small for " + std::to_string(threads_) + " threads");
+    }
+    local_capacity_ = CapacityFor(per_thread / 2 - buffer_bytes);
+    max_capacity_ = CapacityFor(per_thread - buffer_bytes);
+  }
+
+  // 对 morsels 个 morsel 做分组聚合。fill(m, rows) 把第 m 个 morsel 写入 rows（至多 kMorselSize 行）
+  // 并返回行数，会被多个线程并发调用。每个分组恰好调用 emit 一次，emit 在互斥锁下调用。
+  AggregationStats Run(size_t morsels, const std::function<size_t(size_t, Row *)> &fill,
+                       const std::function<void(const Group &)> &emit) {
+    AggregationStats stats;
+    stats_ = &stats;
+    emit_ = &emit;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<AggregationTable>> locals(threads_);
+    std::atomic<size_t> next{0};
+    RunWorkers(threads_, [&](size_t t) {
+      locals[t] = std::make_unique<AggregationTable>(local_capacity_, 0, dir_);
+      std::vector<Row> rows(kMorselSize);
+      for (size_t m = next++; m < morsels; m = next++) {
+        size_t n = fill(m, rows.data());
+        for (size_t i = 0; i < n; i++) {
+          locals[t]->Add(Group{rows[i].key_, 1, rows[i].value_});
+        }
+      }
+    });
+    stats.pre_aggregation_s_ = SecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (auto &local : locals) {
+      stats.spilled_ = stats.spilled_ || local->Spilled();
+    }
+    if (!stats.spilled_) {
+      // 全部在内存中：每个分区用一个新的哈希表合并所有本地表中属于该分区的分组。
+      // 本地表最多占一半预算，合并用的表使用另一半；合并用的表放不下时照常溢出。
+      next = 0;
+      RunWorkers(threads_, [&](size_t) {
+        for (size_t p = next++; p < kFanout; p = next++) {
+          auto table = std::make_unique<AggregationTable>(local_capacity_, 1, dir_);
+          for (auto &local : locals) {
+            local->ForEach([&](const Group &group) {
+              if (PartitionOf(Hash(group.key_), 0) == p) {
+                table->Add(group);
+              }
+            });
+          }
+          Finish(std::move(table), 1);
+        }
+      });
+    } else {
+      // 溢出：所有本地表都写到文件中，释放内存，再逐个分区合并。
+      RunWorkers(threads_, [&](size_t t) { locals[t]->Spill(); });
+      Partitions partitions(kFanout);
+      for (auto &local : locals) {
+        Partitions parts = local->TakePartitions();
+        for (size_t p = 0; p < kFanout; p++) {
+          partitions[p].insert(partitions[p].end(), parts[p].begin(), parts[p].end());
+        }
+        local.reset();
+      }
+      stats.spilled_ = true;
+      next = 0;
+      RunWorkers(threads_, [&](size_t) {
+        for (size_t p = next++; p < kFanout; p = next++) {
+          MergePartition(std::move(partitions[p]), 1);
+        }
+      });
+    }
+    stats.merge_s_ = SecondsSince(start);
+    return stats;
+  }
+
+ private:
+  // 读回一个第 depth - 1 层分区的所有片段并合并。片段读完就释放，不再被引用的溢出文件随之删除。
+  void MergePartition(std::vector<Segment> segments, int depth) {
+    auto table = std::make_unique<AggregationTable>(max_capacity_, depth, dir_);
+    std::vector<Group> block(kSpillBlock);
+    for (auto &segment : segments) {
+      segment.file_->Read(block.data(), segment.count_, segment.offset_);
+      for (size_t i = 0; i < segment.count_; i++) {
+        table->Add(block[i]);
+      }
+    }
+    segments.clear();
+    Finish(std::move(table), depth);
+  }
+
+  // 没有溢出过的表直接输出；否则它的分组都已在文件中，释放表之后递归地合并它的每个子分区。
+  void Finish(std::unique_ptr<AggregationTable> table, int depth) {
+    if (!table->Spilled()) {
+      std::scoped_lock lk(mutex_);
+      table->ForEach([&](const Group &group) { (*emit_)(group); });
+      stats_->groups_ += table->Size();
+      return;
+    }
+    table->Spill();
+    Partitions partitions = table->TakePartitions();
+    table.reset();
+    {
+      std::scoped_lock lk(mutex_);
+      stats_->spilled_ = true;
+      stats_->max_depth_ = std::max(stats_->max_depth_, depth);
+    }
+    for (auto &segments : partitions) {
+      MergePartition(std::move(segments), depth + 1);
+    }
+  }
+
+  std::string dir_;
+  size_t budget_;
+  size_t threads_;
+  // 不大于 bytes / sizeof(Group) 的 2 的幂，至少 kInitialCapacity。
+  static size_t CapacityFor(size_t bytes) {
+    size_t capacity = kInitialCapacity;
+    while (capacity * 2 * sizeof(Group) <= bytes) {
+      capacity *= 2;
+    }
+    return capacity;
+  }
+
+  size_t local_capacity_;
+  size_t max_capacity_;
+  std::mutex mutex_;
+  AggregationStats *stats_{nullptr};
+  const std::function<void(const Group &)> *emit_{nullptr};
+};
+
+// 合成输入：rows 行，键在 [0, groups) 中均匀分布，值在 [0, 1000) 中。
+// 第 m 个 morsel 只由 m 决定，所以可以被多个线程并发地、重复地生成，不需要把输入放在内存中。
+class SyntheticInput {
+ public:
+  SyntheticInput(size_t rows, uint64_t groups) : rows_(rows), groups_(groups) {}
+
+  size_t Morsels() const { return (rows_ + kMorselSize - 1) / kMorselSize; }
+
+  size_t Fill(size_t morsel, Row *rows) const {
+    std::mt19937_64 rng(morsel);
+    size_t n = std::min(kMorselSize, rows_ - morsel * kMorselSize);
+    for (size_t i = 0; i < n; i++) {
+      rows[i] = Row{rng() % groups_, static_cast<int64_t>(rng() % 1000)};
+    }
+    return n;
+  }
+
+ private:
+  size_t rows_;
+  uint64_t groups_;
+};
+
+// 对比用：单线程，不限内存的 std::unordered_map，像 unordered_maps.cpp 那样用 map[key] 更新。
+std::unordered_map<uint64_t, Group> UnboundedAggregate(const SyntheticInput &input) {
+  std::unordered_map<uint64_t, Group> map;
+  std::vector<Row> rows(kMorselSize);
+  for (size_t m = 0; m < input.Morsels(); m++) {
+    size_t n = input.Fill(m, rows.data());
+    for (size_t i = 0; i < n; i++) {
+      Group &group = map[rows[i].key_];
+      group.key_ = rows[i].key_;
+      group.count_++;
+      group.sum_ += rows[i].value_;
+    }
+  }
+  return map;
+}
+
+// 与输出顺序无关的结果指纹。
+uint64_t Fingerprint(const Group &group) {
+  return Hash(group.key_ ^ Hash(group.count_)) + static_cast<uint64_t>(group.sum_);
+}
+
+size_t HeapBytes() { return mallinfo2().uordblks; }
+
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::cout << "CHECK FAILED: " << what << std::endl;
+    std::exit(1);
+  }
+}
+
+// 分别用很小的内存预算（迫使多层溢出）和足够大的预算（完全在内存中）聚合，逐个分组与 std::unordered_map 对比。
+void CheckAgainstMap(const std::string &dir) {
+  struct Case {
+    size_t budget_;
+    uint64_t groups_;
+    bool spills_;
+  };
+  for (Case c : {Case{size_t{2} << 20, 1'000'000, true}, Case{size_t{64} << 20, 100'000, false}}) {
+    const size_t budget = c.budget_;
+    SyntheticInput input(2'000'000, c.groups_);
+    auto expected = UnboundedAggregate(input);
+    size_t groups = 0;
+    bool all_match = true;
+    AggregationStats stats = HashAggregation(dir, budget, 2).Run(
+        input.Morsels(), [&](size_t m, Row *rows) { return input.Fill(m, rows); },
+        [&](const Group &group) {
+          auto it = expected.find(group.key_);
+          all_match = all_match && it != expected.end() && it->second.count_ == group.count_ &&
+                      it->second.sum_ == group.sum_;
+          groups++;
+        });
+    Check(all_match && groups == expected.size() && stats.groups_ == groups,
+          "hash aggregation emits every group exactly once with the right aggregates");
+    Check(stats.spilled_ == c.spills_ && (!c.spills_ || stats.max_depth_ >= 1),
+          c.spills_ ? "a small budget spills and repartitions" : "a large enough budget stays in memory");
+    std::cout << "Aggregated " << groups << " groups with a " << (budget >> 20) << " MB budget: "
+              << (stats.spilled_ ? "spilled, " : "in memory, ") << "max partitioning depth " << stats.max_depth_
+              << "\n";
+  }
+}
+
+// 用法：./hash_aggregation [行数] [内存预算（MB）] [线程数] [临时文件目录]
+int main(int argc, char *argv[]) {
+  size_t rows = argc > 1 ? std::stoul(argv[1]) : 8'000'000;
+  size_t budget_mb = argc > 2 ? std::stoul(argv[2]) : 16;
+  size_t threads = argc > 3 ? std::stoul(argv[3]) : 4;
+  std::string dir = argc > 4 ? argv[4] : ".";
+
+  CheckAgainstMap(dir);
+
+  std::cout << "GROUP BY over " << rows << " rows, " << budget_mb << " MB budget, " << threads << " threads\n";
+  for (uint64_t groups : {uint64_t{1'000}, uint64_t{20'000}, uint64_t{4'000'000}}) {
+    SyntheticInput input(rows, groups);
+    size_t heap_before = HeapBytes();
+    auto start = std::chrono::steady_clock::now();
+    auto map = UnboundedAggregate(input);
+    double map_s = SecondsSince(start);
+    size_t map_bytes = HeapBytes() - heap_before;
+    uint64_t expected = 0;
+    for (auto &[key, group] : map) {
+      expected += Fingerprint(group);
+    }
+    size_t expected_groups = map.size();
+    map = {};
+
+    bytes_spilled = 0;
+    bytes_read_back = 0;
+    uint64_t fingerprint = 0;
+    start = std::chrono::steady_clock::now();
+    HashAggregation aggregation(dir, budget_mb << 20, threads);
+    AggregationStats stats =
+        aggregation.Run(input.Morsels(), [&](size_t m, Row *out) { return input.Fill(m, out); },
+                        [&](const Group &group) { fingerprint += Fingerprint(group); });
+    double seconds = SecondsSince(start);
+    Check(stats.groups_ == expected_groups && fingerprint == expected,
+          "hash aggregation matches the unordered_map aggregation");
+
+    std::cout << "  " << groups << " groups:\n";
+    std::cout << "    unordered_map:    " << map_s << " s, " << rows / map_s / 1e6 << " M rows/s, "
+              << static_cast<double>(map_bytes) / (1 << 20) << " MB of heap\n";
+    std::cout << "    hash aggregation: " << seconds << " s (pre-aggregation " << stats.pre_aggregation_s_
+              << " s, merge " << stats.merge_s_ << " s), " << rows / seconds / 1e6 << " M rows/s, "
+              << (stats.spilled_ ? "spilled " + std::to_string(bytes_spilled / (1 << 20)) + " MB (depth " +
+                                       std::to_string(stats.max_depth_) + ")"
+                                 : std::string("in memory"))
+              << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,293 @@
+/**
+ * @file kernel_specialization.cpp
+ * @brief 用非类型模板参数把运行时参数变成编译期常量：通过生成的跳转表分派到特化的内核。
+ */
+
+// templated_functions.cpp 中的 add3<bool> 和 templated_classes.cpp 中的 Bar<int T> 展示了非类型模板参数，
+// 但只是把它们打印出来。非类型模板参数真正有用的地方在于性能：模板参数是编译期常量，
+// 编译器会为每组参数生成一份专门的代码，删去不可能走到的分支、展开固定次数的循环。
+
+// 数据库执行引擎中的过滤/聚合内核通常有很多运行时参数：
+// - 元素宽度（1/2/4/8 字节的整数列）
+// - 是否需要处理 NULL（列上有没有空值位图）
+// - 步长（stride，按行存储时相邻两个值之间隔了几个元素）
+// - 展开因子（unroll，每次循环迭代处理几行）
+// 如果在内层循环中用 if/switch 判断这些参数，每处理一行都要执行这些分支，还会阻碍编译器优化。
+
+// 本文件的做法是：
+// 1. 把内核写成模板 FilterSumKernel<kWidth, kHasNulls, kStride, kUnroll>，内层循环中没有任何运行时分支。
+// 2. 用 std::index_sequence 在编译期为所有参数组合实例化内核，生成一张函数指针表（跳转表）。
+// 3. 运行时把参数映射为表的下标，一次间接调用就进入对应的特化内核。
+// 内核计算：对所有非 NULL 且大于 threshold 的值求和并计数，即
+//   SELECT SUM(v), COUNT(*) FROM t WHERE v > threshold
+
+// 包含 std::array。
+#include <array>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 std::int8_t 等定宽整数类型。
+#include <cstdint>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::invalid_argument。
+#include <stdexcept>
+// 包含 std::string（用于解析命令行参数）。
+#include <string>
+// 包含 std::conditional_t。
+#include <type_traits>
+// 包含 std::index_sequence。
+#include <utility>
+// 包含 std::vector。
+#include <vector>
+
+// 内核的输入。data 指向按 stride 交错存放的整数列，validity 是空值位图（第 i 位为 1 表示第 i 行非 NULL）。
+struct KernelArgs {
+  const void *data_;
+  const uint64_t *validity_;
+  size_t num_rows_;
+  int64_t threshold_;
+};
+
+struct KernelResult {
+  int64_t sum_;
+  int64_t count_;
+  bool operator==(const KernelResult &other) const { return sum_ == other.sum_ && count_ == other.count_; }
+};
+
+// 运行时参数。
+struct KernelParams {
+  int width_;
+  bool has_nulls_;
+  int stride_;
+  int unroll_;
+};
+
+// 元素宽度（字节）到整数类型的映射。
+template <int kWidth>
+using IntOfWidth = std::conditional_t<
+    kWidth == 1, int8_t, std::conditional_t<kWidth == 2, int16_t, std::conditional_t<kWidth == 4, int32_t, int64_t>>>;
+
+// 特化的内核。所有参数都是编译期常量：
+// - 元素类型在编译期确定，读取就是一条普通的加载指令；
+// - kHasNulls 为 false 时，if constexpr 把空值检查整个删掉；
+// - kStride 是常量，地址计算可以用移位和寻址模式完成；
+// - kUnroll 次的内层循环会被完全展开，并使用 kUnroll 个独立的累加器。
+// 谓词用算术代替分支（v > threshold 的结果是 0 或 1），避免难以预测的条件跳转。
+template <int kWidth, bool kHasNulls, int kStride, int kUnroll>
+KernelResult FilterSumKernel(const KernelArgs &args) {
+  using T = IntOfWidth<kWidth>;
+  const T *data = static_cast<const T *>(args.data_);
+  const int64_t threshold = args.threshold_;
+  std::array<int64_t, kUnroll> sums{};
+  std::array<int64_t, kUnroll> counts{};
+
+  size_t row = 0;
+  for (; row + kUnroll <= args.num_rows_; row += kUnroll) {
+    for (int u = 0; u < kUnroll; u++) {
+      int64_t v = data[(row + u) * kStride];
+      int64_t pass = v > threshold;
+      if constexpr (kHasNulls) {
+        pass &= (args.validity_[(row + u) / 64] >> ((row + u) % 64)) & 1;
+      }
+      sums[u] += v * pass;
+      counts[u] += pass;
+    }
+  }
+  // 处理不足 kUnroll 行的尾部。
+  for (; row < args.num_rows_; row++) {
+    int64_t v = data[row * kStride];
+    int64_t pass = v > threshold;
+    if constexpr (kHasNulls) {
+      pass &= (args.validity_[row / 64] >> (row % 64)) & 1;
+    }
+    sums[0] += v * pass;
+    counts[0] += pass;
+  }
+
+  KernelResult result{0, 0};
+  for (int u = 0; u < kUnroll; u++) {
+    result.sum_ += sums[u];
+    result.count_ += counts[u];
+  }
+  return result;
+}
+
+// 对照组：同样的计算，但每一行都在运行时判断宽度、是否有空值和步长。
+KernelResult FilterSumRuntime(const KernelArgs &args, const KernelParams &params) {
+  KernelResult result{0, 0};
+  for (size_t row = 0; row < args.num_rows_; row++) {
+    size_t index = row * params.stride_;
+    int64_t v;
+    switch (params.width_) {
+      case 1:
+        v = static_cast<const int8_t *>(args.data_)[index];
+        break;
+      case 2:
+        v = static_cast<const int16_t *>(args.data_)[index];
+        break;
+      case 4:
+        v = static_cast<const int32_t *>(args.data_)[index];
+        break;
+      default:
+        v = static_cast<const int64_t *>(args.data_)[index];
+        break;
+    }
+    if (params.has_nulls_ && ((args.validity_[row / 64] >> (row % 64)) & 1) == 0) {
+      continue;
+    }
+    if (v > args.threshold_) {
+      result.sum_ += v;
+      result.count_ += 1;
+    }
+  }
+  return result;
+}
+
+// 每个参数的所有取值。跳转表覆盖它们的笛卡尔积：4 * 2 * 3 * 4 = 96 个特化内核。
+constexpr std::array<int, 4> kWidths = {1, 2, 4, 8};
+constexpr std::array<bool, 2> kNullModes = {false, true};
+constexpr std::array<int, 3> kStrides = {1, 2, 4};
+constexpr std::array<int, 4> kUnrolls = {1, 2, 4, 8};
+constexpr size_t kNumKernels = kWidths.size() * kNullModes.size() * kStrides.size() * kUnrolls.size();
+
+using KernelFn = KernelResult (*)(const KernelArgs &);
+
+// 把表下标 I 拆解为四个参数的下标（混合进制），得到对应的内核实例。
+template <size_t I>
+constexpr KernelFn KernelAt() {
+  constexpr size_t kUnrollIdx = I % kUnrolls.size();
+  constexpr size_t kStrideIdx = (I / kUnrolls.size()) % kStrides.size();
+  constexpr size_t kNullIdx = (I / (kUnrolls.size() * kStrides.size())) % kNullModes.size();
+  constexpr size_t kWidthIdx = I / (kUnrolls.size() * kStrides.size() * kNullModes.size());
+  return &FilterSumKernel<kWidths[kWidthIdx], kNullModes[kNullIdx], kStrides[kStrideIdx], kUnrolls[kUnrollIdx]>;
+}
+
+// 用参数包展开为 0..kNumKernels-1 中的每个下标生成一项，这就是“生成的跳转表”。
+template <size_t... I>
+constexpr std::array<KernelFn, sizeof...(I)> MakeKernelTable(std::index_sequence<I...>) {
+  return {KernelAt<I>()...};
+}
+
+constexpr std::array<KernelFn, kNumKernels> kKernelTable = MakeKernelTable(std::make_index_sequence<kNumKernels>());
+
+// 在 values 中查找 value 的下标，找不到则抛出异常。
+template <typename T, size_t N>
+size_t IndexOf(const std::array<T, N> &values, T value, const char *what) {
+  for (size_t i = 0; i < N; i++) {
+    if (values[i] == value) {
+      return i;
+    }
+  }
+  throw std::invalid_argument(std::string("unsupported ") + what);
+}
+
+// 运行时分派：把参数映射为表下标（与 KernelAt 的拆解方式相反），然后调用特化内核。
+KernelFn SelectKernel(const KernelParams &params) {
+  size_t index = IndexOf(kWidths, params.width_, "width");
+  index = index * kNullModes.size() + IndexOf(kNullModes, params.has_nulls_, "null mode");
+  index = index * kStrides.size() + IndexOf(kStrides, params.stride_, "stride");
+  index = index * kUnrolls.size() + IndexOf(kUnrolls, params.unroll_, "unroll");
+  return kKernelTable[index];
+}
+
+// 生成一列测试数据：num_rows 行，步长为 stride，约 1/8 的行是 NULL。
+// 每种宽度各用一个类型正确的 vector 保存，内核按 T 读取的正是 T 对象，不违反严格别名规则。
+struct Column {
+  std::vector<int8_t> int8_;
+  std::vector<int16_t> int16_;
+  std::vector<int32_t> int32_;
+  std::vector<int64_t> int64_;
+  std::vector<uint64_t> validity_;
+  const void *data_{nullptr};
+};
+
+template <typename T>
+void FillValues(std::vector<T> *values, const std::vector<int64_t> &source, int stride) {
+  values->assign(source.size() * stride, 0);
+  for (size_t row = 0; row < source.size(); row++) {
+    (*values)[row * stride] = static_cast<T>(source[row]);
+  }
+}
+
+Column MakeColumn(int width, int stride, size_t num_rows) {
+  Column column;
+  std::vector<int64_t> source(num_rows);
+  column.validity_.assign((num_rows + 63) / 64, 0);
+  uint64_t rng = 42;
+  for (size_t row = 0; row < num_rows; row++) {
+    rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+    source[row] = static_cast<int8_t>(rng >> 56);
+    if ((rng >> 20) % 8 != 0) {
+      column.validity_[row / 64] |= uint64_t{1} << (row % 64);
+    }
+  }
+  switch (width) {
+    case 1:
+      FillValues(&column.int8_, source, stride);
+      column.data_ = column.int8_.data();
+      break;
+    case 2:
+      FillValues(&column.int16_, source, stride);
+      column.data_ = column.int16_.data();
+      break;
+    case 4:
+      FillValues(&column.int32_, source, stride);
+      column.data_ = column.int32_.data();
+      break;
+    default:
+      FillValues(&column.int64_, source, stride);
+      column.data_ = column.int64_.data();
+      break;
+  }
+  return column;
+}
+
+double MillisSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 比较运行时分支与特化分派在同一组参数上的耗时，并检查结果一致。
+void Bench(const KernelParams &params, size_t num_rows, int reps) {
+  Column column = MakeColumn(params.width_, params.stride_, num_rows);
+  KernelArgs args{column.data_, column.validity_.data(), num_rows, 10};
+
+  KernelResult runtime_result{0, 0};
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < reps; r++) {
+    runtime_result = FilterSumRuntime(args, params);
+  }
+  double runtime_ms = MillisSince(start) / reps;
+
+  KernelResult specialized_result{0, 0};
+  start = std::chrono::steady_clock::now();
+  for (int r = 0; r < reps; r++) {
+    specialized_result = SelectKernel(params)(args);
+  }
+  double specialized_ms = MillisSince(start) / reps;
+
+  std::cout << "width=" << params.width_ << " nulls=" << params.has_nulls_ << " stride=" << params.stride_
+            << " unroll=" << params.unroll_ << ":\truntime branching " << runtime_ms << " ms\tspecialized "
+            << specialized_ms << " ms\tspeedup " << runtime_ms / specialized_ms
+            << (runtime_result == specialized_result ? "" : "\tRESULTS DIFFER!") << "\n";
+}
+
+// 用法：./kernel_specialization [行数]
+int main(int argc, char *argv[]) {
+  size_t num_rows = argc > 1 ? std::stoul(argv[1]) : 4'000'000;
+  const int reps = 5;
+
+  // 第一部分：同一个运行时参数组合，既可以走运行时分支，也可以通过跳转表进入特化内核。
+  std::cout << "Jump table holds " << kKernelTable.size() << " specialized kernels\n";
+  Column column = MakeColumn(4, 1, 1000);
+  KernelArgs args{column.data_, column.validity_.data(), 1000, 0};
+  KernelParams params{4, true, 1, 4};
+  KernelResult result = SelectKernel(params)(args);
+  std::cout << "Printing SUM/COUNT of non-null values > 0: " << result.sum_ << " / " << result.count_ << std::endl;
+
+  // 第二部分：不同参数组合下的性能对比。
+  for (KernelParams p : {KernelParams{1, false, 1, 8}, KernelParams{4, false, 1, 4}, KernelParams{4, true, 1, 4},
+                         KernelParams{8, true, 2, 2}, KernelParams{2, true, 4, 1}}) {
+    Bench(p, num_rows, reps);
+  }
+  return 0;
+}
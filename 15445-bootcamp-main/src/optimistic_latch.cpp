@@ -0,0 +1,372 @@
+/**
+ * @file optimistic_latch.cpp
+ * @brief 乐观版本锁（optimistic versioned latch）的教学示例，用于树索引节点的并发访问。
+ */
+
+// 在 rwlock.cpp 中，即使是只读的访问也要获取 std::shared_mutex 的共享锁，也就是要写锁字（lock word）。
+// 在 B+ 树等索引中，每次查找都要从根节点一路向下加锁，根节点的锁字因此成为所有线程争用的热点，
+// 尽管这些线程大部分只是在读。
+
+// 乐观锁（optimistic lock coupling, OLC）让读者完全不写锁字：
+// 1. 锁字是一个版本号。写者加锁时设置“已锁定”位，解锁时清除该位并把版本号加 1。
+// 2. 读者先记下版本号（如果已锁定就等待），然后直接读取节点内容，最后检查版本号是否变化（validate）。
+//    版本号没变，说明读取期间没有写者修改节点，读到的内容是一致的；否则从头重试（restart）。
+// 3. 读者可以把乐观读“升级”为独占锁：用 CAS 把记下的版本号改为已锁定，成功则说明期间无人修改。
+// 4. 节点被删除或被替换时，写者把它标记为“已废弃”（obsolete）。之后的读者与写者看到该标记都会重试，
+//    从父节点重新找到新节点。
+// 参考论文：Leis et al., "The ART of Practical Synchronization", DaMoN 2016。
+// https://db.in.tum.de/~leis/papers/artsync.pdf
+
+// 锁字布局：第 0 位为 obsolete 位，第 1 位为 locked 位，其余高位为版本号。
+// 写者加锁时加 2（设置 locked 位），解锁时再加 2（清除 locked 位并进位到版本号）。
+
+// 本仓库没有单元测试框架，因此 main 的第一部分用一组自检（Check）验证这些语义，
+// 第二部分是与 std::shared_lock 的性能对比。
+
+// 包含 std::array。
+#include <array>
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 std::exit。
+#include <cstdlib>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 mutex 头文件。
+#include <mutex>
+// 包含 shared_mutex 头文件（用于对比基准）。
+#include <shared_mutex>
+// 包含 std::string（用于解析命令行参数）。
+#include <string>
+// 包含 thread 头文件。
+#include <thread>
+// 包含 std::vector。
+#include <vector>
+
+class OptimisticLatch {
+ public:
+  OptimisticLatch() = default;
+  OptimisticLatch(const OptimisticLatch &) = delete;
+  OptimisticLatch &operator=(const OptimisticLatch &) = delete;
+
+  // 开始一次乐观读：等待写者解锁后，把当前版本写入 *version。
+  // 如果节点已废弃，返回 false，调用者应当从父节点重试。
+  bool TryBeginRead(uint64_t *version) const {
+    uint64_t v = word_.load(std::memory_order_acquire);
+    while (IsLocked(v)) {
+      std::this_thread::yield();
+      v = word_.load(std::memory_order_acquire);
+    }
+    if (IsObsolete(v)) {
+      return false;
+    }
+    *version = v;
+    return true;
+  }
+
+  // 检查自 TryBeginRead 以来节点是否被修改过。返回 false 时，读到的内容不可信，需要重试。
+  // acquire 栅栏保证之前对节点内容的读取不会被重排到这次对锁字的读取之后。
+  bool Validate(uint64_t version) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return word_.load(std::memory_order_relaxed) == version;
+  }
+
+  // 把一次乐观读升级为独占锁。只有在这期间没有其他写者时才会成功。
+  bool TryUpgrade(uint64_t version) {
+    return word_.compare_exchange_strong(version, version + kLockedBit, std::memory_order_acquire,
+                                         std::memory_order_relaxed);
+  }
+
+  // 直接获取独占锁。节点已废弃时返回 false。
+  bool TryLockExclusive() {
+    while (true) {
+      uint64_t version;
+      if (!TryBeginRead(&version)) {
+        return false;
+      }
+      if (TryUpgrade(version)) {
+        return true;
+      }
+    }
+  }
+
+  // 释放独占锁并推进版本号，所有持有旧版本的乐观读者都会校验失败。
+  void UnlockExclusive() { word_.fetch_add(kLockedBit, std::memory_order_release); }
+
+  // 释放独占锁，同时把节点标记为已废弃。
+  void UnlockExclusiveObsolete() { word_.fetch_add(kLockedBit | kObsoleteBit, std::memory_order_release); }
+
+  bool IsObsolete() const { return IsObsolete(word_.load(std::memory_order_acquire)); }
+
+ private:
+  static constexpr uint64_t kObsoleteBit = 1;
+  static constexpr uint64_t kLockedBit = 2;
+
+  static bool IsLocked(uint64_t v) { return (v & kLockedBit) != 0; }
+  static bool IsObsolete(uint64_t v) { return (v & kObsoleteBit) != 0; }
+
+  std::atomic<uint64_t> word_{0};
+};
+
+// 一个简化的叶子节点。乐观读者会与写者并发地读取这些字段，为了在 C++ 内存模型下没有数据竞争，
+// 字段都声明为 std::atomic，并使用 relaxed 读写；顺序由锁字上的 acquire/release 保证。
+// 写者始终让所有 key 等于同一个值，读者据此检查是否读到了不一致的内容。
+struct LeafNode {
+  static constexpr size_t kCapacity = 8;
+
+  OptimisticLatch latch_;
+  std::array<std::atomic<uint64_t>, kCapacity> keys_{};
+};
+
+// 父节点只保存一个指向叶子节点的指针。写者可以用一个新叶子替换旧叶子，并把旧叶子标记为废弃。
+struct InnerNode {
+  OptimisticLatch latch_;
+  std::atomic<LeafNode *> child_{nullptr};
+};
+
+// 带乐观锁耦合的查找：父节点 -> 子节点。任何一步校验失败都从父节点重新开始。
+// 返回叶子中 key 的和；restarts 统计重试次数。
+uint64_t OptimisticLookup(const InnerNode &parent, uint64_t *restarts) {
+  while (true) {
+    uint64_t parent_version;
+    if (!parent.latch_.TryBeginRead(&parent_version)) {
+      *restarts += 1;
+      continue;
+    }
+    LeafNode *leaf = parent.child_.load(std::memory_order_relaxed);
+    uint64_t leaf_version;
+    // 先开始读子节点，再校验父节点：这保证了 leaf 指针在我们开始读子节点时仍然有效（锁耦合）。
+    if (!leaf->latch_.TryBeginRead(&leaf_version) || !parent.latch_.Validate(parent_version)) {
+      *restarts += 1;
+      continue;
+    }
+    uint64_t sum = 0;
+    for (auto &key : leaf->keys_) {
+      sum += key.load(std::memory_order_relaxed);
+    }
+    if (!leaf->latch_.Validate(leaf_version)) {
+      *restarts += 1;
+      continue;
+    }
+    return sum;
+  }
+}
+
+// 原地修改叶子：乐观读到叶子后升级为独占锁。
+void UpdateLeaf(InnerNode &parent, uint64_t value) {
+  while (true) {
+    uint64_t parent_version;
+    if (!parent.latch_.TryBeginRead(&parent_version)) {
+      continue;
+    }
+    LeafNode *leaf = parent.child_.load(std::memory_order_relaxed);
+    uint64_t leaf_version;
+    if (!leaf->latch_.TryBeginRead(&leaf_version) || !parent.latch_.Validate(parent_version)) {
+      continue;
+    }
+    if (!leaf->latch_.TryUpgrade(leaf_version)) {
+      continue;
+    }
+    for (auto &key : leaf->keys_) {
+      key.store(value, std::memory_order_relaxed);
+    }
+    leaf->latch_.UnlockExclusive();
+    return;
+  }
+}
+
+// 用新叶子替换旧叶子（类似 B+ 树中节点分裂或扩容后替换节点）。旧叶子被标记为废弃。
+// 旧叶子的内存不能立刻释放，因为乐观读者可能还在读它；这里把它交给 retired 列表，
+// 真实系统中应使用基于纪元的回收（参见 rcu.cpp）。
+void ReplaceLeaf(InnerNode &parent, uint64_t value, std::vector<LeafNode *> *retired) {
+  if (!parent.latch_.TryLockExclusive()) {
+    return;
+  }
+  LeafNode *old_leaf = parent.child_.load(std::memory_order_relaxed);
+  if (!old_leaf->latch_.TryLockExclusive()) {
+    parent.latch_.UnlockExclusive();
+    return;
+  }
+  auto *new_leaf = new LeafNode;
+  for (auto &key : new_leaf->keys_) {
+    key.store(value, std::memory_order_relaxed);
+  }
+  parent.child_.store(new_leaf, std::memory_order_relaxed);
+  old_leaf->latch_.UnlockExclusiveObsolete();
+  parent.latch_.UnlockExclusive();
+  retired->push_back(old_leaf);
+}
+
+// 自检失败时打印信息并以非零状态退出。
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::cout << "CHECK FAILED: " << what << std::endl;
+    std::exit(1);
+  }
+}
+
+// 单线程下的语义检查。
+void CheckSemantics() {
+  OptimisticLatch latch;
+  uint64_t v1;
+  Check(latch.TryBeginRead(&v1), "read on a fresh latch succeeds");
+  Check(latch.Validate(v1), "validate succeeds without writers");
+
+  // 写者加锁并解锁后，旧版本校验失败，升级也失败。
+  Check(latch.TryLockExclusive(), "exclusive lock on a fresh latch succeeds");
+  latch.UnlockExclusive();
+  Check(!latch.Validate(v1), "validate fails after a write");
+  Check(!latch.TryUpgrade(v1), "upgrade fails after a write");
+
+  // 用新版本可以升级；升级后其他读者的版本失效。
+  uint64_t v2;
+  Check(latch.TryBeginRead(&v2), "read after write succeeds");
+  Check(v2 != v1, "version advances after a write");
+  uint64_t v3 = v2;
+  Check(latch.TryUpgrade(v2), "upgrade with the current version succeeds");
+  Check(!latch.Validate(v3), "validate fails while write-locked");
+  latch.UnlockExclusive();
+
+  // 废弃之后，读者和写者都会失败。
+  Check(latch.TryLockExclusive(), "lock before marking obsolete");
+  latch.UnlockExclusiveObsolete();
+  uint64_t v4;
+  Check(latch.IsObsolete(), "latch is obsolete");
+  Check(!latch.TryBeginRead(&v4), "read on an obsolete latch fails");
+  Check(!latch.TryLockExclusive(), "lock on an obsolete latch fails");
+}
+
+// 并发检查：读者必须只接受一致的快照（所有 key 相等），即使写者在原地修改和替换叶子。
+void CheckConcurrent() {
+  InnerNode parent;
+  parent.child_.store(new LeafNode);
+  std::vector<LeafNode *> retired;
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> bad_reads{0};
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 3; i++) {
+    readers.emplace_back([&] {
+      uint64_t restarts = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        uint64_t sum = OptimisticLookup(parent, &restarts);
+        if (sum % LeafNode::kCapacity != 0) {
+          bad_reads.fetch_add(1);
+        }
+      }
+    });
+  }
+  // 单个写者线程同时负责原地更新和替换，retired 只被它访问。
+  std::thread writer([&] {
+    for (uint64_t i = 1; i <= 20000; i++) {
+      if (i % 100 == 0) {
+        ReplaceLeaf(parent, i, &retired);
+      } else {
+        UpdateLeaf(parent, i);
+      }
+    }
+  });
+  writer.join();
+  stop.store(true);
+  for (auto &r : readers) {
+    r.join();
+  }
+  Check(bad_reads.load() == 0, "optimistic readers never accept a torn leaf");
+  uint64_t restarts = 0;
+  Check(OptimisticLookup(parent, &restarts) == 20000 * LeafNode::kCapacity, "final leaf holds the last write");
+
+  delete parent.child_.load();
+  for (LeafNode *leaf : retired) {
+    delete leaf;
+  }
+}
+
+// 保存读者读到的值，防止编译器把读操作优化掉。
+std::atomic<uint64_t> benchmark_sink{0};
+
+// 基准：readers 个读者反复读取一个叶子的全部 key，writers 个写者持续原地更新它。
+// use_optimistic 为 true 时读者使用乐观读 + 校验，否则使用 std::shared_lock。
+void RunBench(bool use_optimistic, int readers, int writers, std::chrono::milliseconds duration) {
+  InnerNode parent;
+  parent.child_.store(new LeafNode);
+  std::shared_mutex m;
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> read_ops{0};
+  std::atomic<uint64_t> total_restarts{0};
+  std::vector<std::thread> threads;
+
+  for (int r = 0; r < readers; r++) {
+    threads.emplace_back([&] {
+      uint64_t ops = 0;
+      uint64_t restarts = 0;
+      uint64_t sink = 0;
+      LeafNode *leaf = parent.child_.load();
+      while (!stop.load(std::memory_order_relaxed)) {
+        if (use_optimistic) {
+          sink += OptimisticLookup(parent, &restarts);
+        } else {
+          std::shared_lock lk(m);
+          for (auto &key : leaf->keys_) {
+            sink += key.load(std::memory_order_relaxed);
+          }
+        }
+        ops += 1;
+      }
+      read_ops.fetch_add(ops);
+      total_restarts.fetch_add(restarts);
+      benchmark_sink.fetch_add(sink, std::memory_order_relaxed);
+    });
+  }
+  for (int w = 0; w < writers; w++) {
+    threads.emplace_back([&] {
+      uint64_t i = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        i += 1;
+        if (use_optimistic) {
+          UpdateLeaf(parent, i);
+        } else {
+          std::unique_lock lk(m);
+          for (auto &key : parent.child_.load()->keys_) {
+            key.store(i, std::memory_order_relaxed);
+          }
+        }
+        // 写者两次修改之间稍作停顿，模拟读多写少的索引访问。
+        std::this_thread::sleep_for(std::chrono::microseconds(1));
+      }
+    });
+  }
+  std::this_thread::sleep_for(duration);
+  stop.store(true);
+  for (auto &t : threads) {
+    t.join();
+  }
+  delete parent.child_.load();
+
+  double seconds = std::chrono::duration<double>(duration).count();
+  std::cout << "  " << (use_optimistic ? "OptimisticLatch   " : "std::shared_lock  ") << read_ops.load() / seconds / 1e6
+            << " M reads/s";
+  if (use_optimistic) {
+    std::cout << ", restarts per read " << static_cast<double>(total_restarts.load()) / read_ops.load();
+  }
+  std::cout << "\n";
+}
+
+// 用法：./optimistic_latch [读者线程数] [每个配置运行的毫秒数]
+int main(int argc, char *argv[]) {
+  int readers = argc > 1 ? std::stoi(argv[1]) : 4;
+  std::chrono::milliseconds duration(argc > 2 ? std::stoi(argv[2]) : 200);
+
+  // 第一部分：自检。
+  CheckSemantics();
+  CheckConcurrent();
+  std::cout << "All optimistic latch checks passed\n";
+
+  // 第二部分：读-校验开销与共享锁的对比。
+  for (int writers : {0, 1, 2}) {
+    std::cout << readers << " readers, " << writers << " writers\n";
+    RunBench(false, readers, writers, duration);
+    RunBench(true, readers, writers, duration);
+  }
+  return 0;
+}
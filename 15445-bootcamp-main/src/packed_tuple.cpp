@@ -0,0 +1,272 @@
+/**
+ * @file packed_tuple.cpp
+ * @brief 按对齐要求重排成员以减少填充的 packed_tuple<Ts...>，以及利用空基类优化的 compressed_pair。
+ */
+
+// auto.cpp 中的 Abcdefghijklmnopqrstuvwxyz<T, U> 按声明顺序保存两个成员。C++ 规定类的非静态成员
+// 按声明顺序排列，每个成员都要对齐到 alignof(成员类型)，所以顺序不当时会在成员之间插入填充字节。例如
+//   struct { char a; double b; char c; int d; char e; short f; };
+// 实际数据只有 17 字节，但 sizeof 是 32：a 后面填充 7 字节，c 后面填充 3 字节，末尾还要填充到 8 的倍数。
+// std::tuple 同样不会重排元素。当一张表有几百万行时，这些填充就是白白浪费的内存和带宽。
+
+// 本文件的 packed_tuple<Ts...>：
+// 1. 在编译期按 alignof 从大到小（稳定地）排序元素，按排序后的顺序布局，填充最少；
+// 2. get<I> 仍然按声明顺序取第 I 个元素，使用方不需要知道实际布局；
+// 3. 空类型（如无状态的比较器、哈希函数、分配器）不作为成员保存，而是作为基类继承，
+//    借助空基类优化（EBO）不占用任何空间。普通成员即使是空类型也至少占 1 字节，还会带来对齐填充。
+// compressed_pair<T, U> 是只有两个元素的特例，std::unique_ptr 的删除器就是这样保存的。
+
+// 包含 std::array。
+#include <array>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::string（用于解析命令行参数）。
+#include <string>
+// 包含 std::tuple（对比基准），以及 std::tuple_size / std::tuple_element。
+#include <tuple>
+// 包含 std::is_empty_v 等类型萃取。
+#include <type_traits>
+// 包含 std::index_sequence。
+#include <utility>
+// 包含 std::vector。
+#include <vector>
+
+// 第 I 个类型。
+template <size_t I, typename... Ts>
+using TypeAt = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+// 保存一个元素的“叶子”。I 是元素在声明顺序中的下标，使得同一类型的多个元素也是不同的基类。
+// 非空类型作为成员保存。
+template <size_t I, typename T, bool kEmpty = std::is_empty_v<T> && !std::is_final_v<T>>
+class PackedLeaf {
+ public:
+  constexpr PackedLeaf() : value_() {}
+  constexpr explicit PackedLeaf(const T &value) : value_(value) {}
+
+  constexpr T &Get() { return value_; }
+  constexpr const T &Get() const { return value_; }
+
+ private:
+  T value_;
+};
+
+// 空类型作为基类继承，空基类优化使它不占空间。final 类不能被继承，因此只能走上面的通用版本。
+template <size_t I, typename T>
+class PackedLeaf<I, T, true> : private T {
+ public:
+  constexpr PackedLeaf() = default;
+  constexpr explicit PackedLeaf(const T &value) : T(value) {}
+
+  constexpr T &Get() { return *this; }
+  constexpr const T &Get() const { return *this; }
+};
+
+// 编译期计算布局顺序：下标按 alignof 从大到小稳定排序（插入排序）。
+// 对齐要求从大到小排列时，每个成员的起始位置自然满足对齐，成员之间不需要填充。
+template <typename... Ts>
+constexpr std::array<size_t, sizeof...(Ts)> LayoutOrder() {
+  constexpr std::array<size_t, sizeof...(Ts)> aligns = {alignof(Ts)...};
+  std::array<size_t, sizeof...(Ts)> order{};
+  for (size_t i = 0; i < order.size(); i++) {
+    size_t j = i;
+    while (j > 0 && aligns[order[j - 1]] < aligns[i]) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = i;
+  }
+  return order;
+}
+
+// 把 LayoutOrder 的结果转换为 std::index_sequence<P...>，P 是排序后的声明下标。
+template <typename Seq, typename... Ts>
+struct LayoutSequence;
+
+template <size_t... J, typename... Ts>
+struct LayoutSequence<std::index_sequence<J...>, Ts...> {
+  static constexpr std::array<size_t, sizeof...(Ts)> kOrder = LayoutOrder<Ts...>();
+  using type = std::index_sequence<kOrder[J]...>;
+};
+
+// 按排序后的顺序继承各个叶子。基类子对象按基类列表的顺序布局，所以这里的顺序就是内存中的顺序。
+template <typename Order, typename... Ts>
+class PackedStorage;
+
+template <size_t... P, typename... Ts>
+class PackedStorage<std::index_sequence<P...>, Ts...> : public PackedLeaf<P, TypeAt<P, Ts...>>... {
+ public:
+  constexpr PackedStorage() = default;
+
+  // args 按声明顺序传入，每个叶子按自己的声明下标 P 取出对应的参数。
+  constexpr explicit PackedStorage(const std::tuple<const Ts &...> &args)
+      : PackedLeaf<P, TypeAt<P, Ts...>>(std::get<P>(args))... {}
+};
+
+template <typename... Ts>
+class packed_tuple
+    : public PackedStorage<typename LayoutSequence<std::index_sequence_for<Ts...>, Ts...>::type, Ts...> {
+  static_assert(sizeof...(Ts) > 0, "packed_tuple needs at least one element");
+  using Base = PackedStorage<typename LayoutSequence<std::index_sequence_for<Ts...>, Ts...>::type, Ts...>;
+
+ public:
+  constexpr packed_tuple() = default;
+  constexpr explicit packed_tuple(const Ts &...args) : Base(std::tuple<const Ts &...>(args...)) {}
+};
+
+// 按声明顺序访问第 I 个元素：转换到对应的叶子基类即可，与实际布局无关。
+template <size_t I, typename... Ts>
+constexpr TypeAt<I, Ts...> &get(packed_tuple<Ts...> &t) {
+  return static_cast<PackedLeaf<I, TypeAt<I, Ts...>> &>(t).Get();
+}
+
+template <size_t I, typename... Ts>
+constexpr const TypeAt<I, Ts...> &get(const packed_tuple<Ts...> &t) {
+  return static_cast<const PackedLeaf<I, TypeAt<I, Ts...>> &>(t).Get();
+}
+
+// 结构化绑定对 auto [a, b] = t 中隐藏的副本调用 get<I>(std::move(副本))，因此需要右值版本。
+template <size_t I, typename... Ts>
+constexpr TypeAt<I, Ts...> &&get(packed_tuple<Ts...> &&t) {
+  return std::move(get<I>(t));
+}
+
+// 与 auto.cpp 中的 construct_obj 类似的工厂函数。
+template <typename... Ts>
+constexpr packed_tuple<Ts...> make_packed_tuple(const Ts &...args) {
+  return packed_tuple<Ts...>(args...);
+}
+
+// 让 packed_tuple 支持结构化绑定：auto [a, b] = t;
+template <typename... Ts>
+struct std::tuple_size<packed_tuple<Ts...>> : std::integral_constant<size_t, sizeof...(Ts)> {};
+
+template <size_t I, typename... Ts>
+struct std::tuple_element<I, packed_tuple<Ts...>> {
+  using type = TypeAt<I, Ts...>;
+};
+
+// 两个元素的特例，提供 first() / second() 两个更直观的名字。
+template <typename T, typename U>
+class compressed_pair : public packed_tuple<T, U> {
+ public:
+  constexpr compressed_pair() = default;
+  constexpr compressed_pair(const T &first, const U &second) : packed_tuple<T, U>(first, second) {}
+
+  constexpr T &first() { return get<0>(*this); }
+  constexpr const T &first() const { return get<0>(*this); }
+  constexpr U &second() { return get<1>(*this); }
+  constexpr const U &second() const { return get<1>(*this); }
+};
+
+// 与 auto.cpp 中的 Abcdefghijklmnopqrstuvwxyz 相同：按声明顺序保存两个成员。
+template <typename T, typename U>
+struct PlainPair {
+  T instance1_;
+  U instance2_;
+};
+
+// 无状态的哈希函数：一个空类型。
+struct IdentityHash {
+  size_t operator()(size_t key) const { return key; }
+};
+
+// 一行表数据，元素的声明顺序对布局很不友好。
+using RowTuple = std::tuple<char, double, char, int, char, short>;
+using RowPacked = packed_tuple<char, double, char, int, char, short>;
+
+struct RowStruct {
+  char a_;
+  double b_;
+  char c_;
+  int d_;
+  char e_;
+  short f_;
+};
+
+// 17 字节的数据向上对齐到 8 的倍数，就是 24 字节；不重排则需要 32 字节。
+static_assert(sizeof(RowPacked) == 24);
+static_assert(sizeof(compressed_pair<IdentityHash, int>) == sizeof(int));
+
+// 保存扫描结果，防止编译器把循环优化掉。
+volatile double benchmark_sink = 0;
+
+// 扫描 rows 中每一行的 double 与 int 两列并求和，重复若干次，返回每秒处理的行数。
+template <typename Row, typename Fn>
+double ScanRowsPerSecond(const std::vector<Row> &rows, Fn columns_sum) {
+  const int reps = 5;
+  double sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < reps; r++) {
+    for (const Row &row : rows) {
+      sum += columns_sum(row);
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  benchmark_sink = benchmark_sink + sum;
+  return rows.size() * reps / seconds;
+}
+
+void Report(const char *name, size_t row_bytes, size_t n, double rows_per_second) {
+  std::cout << "  " << name << ": sizeof " << row_bytes << ", " << row_bytes * n / 1e6 << " MB, "
+            << rows_per_second / 1e6 << " M rows/s\n";
+}
+
+// 用法：./packed_tuple [行数]
+int main(int argc, char *argv[]) {
+  size_t n = argc > 1 ? std::stoul(argv[1]) : 4'000'000;
+
+  // 第一部分：get<I> 按声明顺序访问，结构化绑定也可以使用。
+  auto row = make_packed_tuple('a', 4.45, 'b', 645, 'c', static_cast<short>(15));
+  std::cout << "Printing get<1>, get<3> of a packed_tuple: " << get<1>(row) << ", " << get<3>(row) << std::endl;
+  auto [a, b, c, d, e, f] = row;
+  std::cout << "Printing structured bindings: " << a << " " << b << " " << c << " " << d << " " << e << " " << f
+            << std::endl;
+
+  // 布局对比：packed_tuple 中各元素的实际偏移。
+  std::cout << "Element offsets in packed_tuple<char, double, char, int, char, short>:";
+  const char *base = reinterpret_cast<const char *>(&row);
+  std::cout << " " << reinterpret_cast<const char *>(&get<0>(row)) - base;
+  std::cout << " " << reinterpret_cast<const char *>(&get<1>(row)) - base;
+  std::cout << " " << reinterpret_cast<const char *>(&get<2>(row)) - base;
+  std::cout << " " << reinterpret_cast<const char *>(&get<3>(row)) - base;
+  std::cout << " " << reinterpret_cast<const char *>(&get<4>(row)) - base;
+  std::cout << " " << reinterpret_cast<const char *>(&get<5>(row)) - base << std::endl;
+
+  std::cout << "sizeof: struct " << sizeof(RowStruct) << ", std::tuple " << sizeof(RowTuple) << ", packed_tuple "
+            << sizeof(RowPacked) << std::endl;
+  std::cout << "sizeof with an empty hash: PlainPair<IdentityHash, int> " << sizeof(PlainPair<IdentityHash, int>)
+            << ", compressed_pair<IdentityHash, int> " << sizeof(compressed_pair<IdentityHash, int>) << std::endl;
+
+  // 第二部分：扫描几百万行中的两列。行越小，同样的缓存和内存带宽能装下的行越多。
+  std::cout << "Scanning " << n << " rows (sum of the double and int columns)\n";
+  {
+    std::vector<RowStruct> rows(n);
+    for (size_t i = 0; i < n; i++) {
+      rows[i].b_ = static_cast<double>(i);
+      rows[i].d_ = static_cast<int>(i);
+    }
+    Report("struct      ", sizeof(RowStruct), n,
+           ScanRowsPerSecond(rows, [](const RowStruct &r) { return r.b_ + r.d_; }));
+  }
+  {
+    std::vector<RowTuple> rows(n);
+    for (size_t i = 0; i < n; i++) {
+      std::get<1>(rows[i]) = static_cast<double>(i);
+      std::get<3>(rows[i]) = static_cast<int>(i);
+    }
+    Report("std::tuple  ", sizeof(RowTuple), n,
+           ScanRowsPerSecond(rows, [](const RowTuple &r) { return std::get<1>(r) + std::get<3>(r); }));
+  }
+  {
+    std::vector<RowPacked> rows(n);
+    for (size_t i = 0; i < n; i++) {
+      get<1>(rows[i]) = static_cast<double>(i);
+      get<3>(rows[i]) = static_cast<int>(i);
+    }
+    Report("packed_tuple", sizeof(RowPacked), n,
+           ScanRowsPerSecond(rows, [](const RowPacked &r) { return get<1>(r) + get<3>(r); }));
+  }
+  return 0;
+}
@@ -0,0 +1,464 @@
+/**
+ * @file parallel_sort.cpp
+ * @brief 并行内存排序：整数键的并行 LSD 基数排序，以及任意比较器的并行样本排序（sample sort），
+ *        都运行在线程池上，临时缓冲区按"首次触碰"（first-touch）原则由使用它的线程初始化。
+ */
+
+// vectors.cpp 中的 std::vector<int> 或 std::vector<Point> 用 std::sort 排序时只用一个核。
+// 本文件提供两种并行排序：
+// 1. 并行 LSD（least significant digit）基数排序，适用于能映射成无符号整数键的元素。
+//    每一趟按键的一个 8 位"数字"做稳定的计数排序：每个线程先统计自己那段输入的直方图，
+//    对所有线程的直方图求前缀和（数字优先、线程其次，保证稳定），再各自把元素分散写到输出中。
+//    输入与临时缓冲区来回交替。如果某一趟所有元素的这个数字都相同（例如小范围的 int 的高位字节），
+//    这一趟不改变顺序，直接跳过。复杂度是 O(n * 键的字节数)，不做任何比较。
+// 2. 并行样本排序，适用于任意严格弱序的比较器。先随机抽取 buckets * kOversample 个样本并排序，
+//    每隔 kOversample 个取一个作为分隔元素（splitter），把值域切成 buckets 个桶；
+//    每个线程用二分查找确定自己那段输入中每个元素所属的桶并计数，前缀和之后分散写入临时缓冲区，
+//    最后线程池动态地领取各个桶，分别用 std::sort 排序并拷回原数组。过采样使各桶的大小接近，
+//    桶数取线程数的若干倍，使动态调度能抹平剩下的不均匀。
+
+// NUMA 友好的缓冲区：Linux 在一个页第一次被写入时才为它分配物理内存，并且分配在执行写入的
+// 那个 CPU 所在的 NUMA 节点上（first-touch 策略）。如果由主线程把临时缓冲区清零
+// （例如 std::vector<T>(n)），整个缓冲区都会落在主线程的节点上，其他节点上的线程每次访问都要
+// 跨节点。这里的临时缓冲区用 new T[n] 分配（不做初始化，不触碰页），再由线程池中的每个线程
+// 初始化自己将要读取的那一段。线程池的 RunOnEachThread(fn) 保证线程 t 总是执行 fn(t)，
+// 所以各个按段划分的阶段中，线程 t 总是读取它自己首次触碰的那一段。
+// （分散写入阶段的写目标由数据决定，无法都在本地；线程也没有绑定到 CPU 上。在单节点的机器上
+// 这些都没有区别。）
+
+// 对比用的 std::execution::par 版本的 std::sort 在 libstdc++ 中由 TBB 实现，需要链接 TBB，
+// 所以只有 CMake 找到 TBB 时才定义 BOOTCAMP_HAVE_PARALLEL_STL 并编译这部分。
+
+// 包含 std::sort、std::upper_bound。
+#include <algorithm>
+// 包含 std::array。
+#include <array>
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 INT_MIN、INT_MAX。
+#include <climits>
+// 包含 std::condition_variable。
+#include <condition_variable>
+// 包含 uint16_t、UINT16_MAX。
+#include <cstdint>
+// 包含 std::exit。
+#include <cstdlib>
+#ifdef BOOTCAMP_HAVE_PARALLEL_STL
+// 包含 std::execution::par。
+#include <execution>
+#endif
+// 包含 std::function。
+#include <functional>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::unique_ptr、std::shared_ptr。
+#include <memory>
+// 包含 std::mutex。
+#include <mutex>
+// 包含 std::mt19937_64（用于生成数据与抽样）。
+#include <random>
+// 包含 std::string（用于解析命令行参数）。
+#include <string>
+// 包含 thread 头文件。
+#include <thread>
+// 包含 std::is_unsigned_v。
+#include <type_traits>
+// 包含 std::swap。
+#include <utility>
+// 包含 std::vector。
+#include <vector>
+
+// 线程池：构造时启动 threads - 1 个工作线程，调用者是第 0 号线程。
+// ParallelFor 动态地分发任务；RunOnEachThread 让第 t 号线程恰好执行一次 fn(t)。
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t threads) {
+    for (size_t i = 1; i < threads; i++) {
+      workers_.emplace_back([this, i] { WorkerLoop(i); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::scoped_lock lk(mutex_);
+      stop_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  size_t Size() const { return workers_.size() + 1; }
+
+  // 对 0..n-1 的每个 i 调用 fn(i)，哪个线程执行哪个 i 不确定，所有任务完成后返回。
+  void ParallelFor(size_t n, const std::function<void(size_t)> &fn) { Submit(std::make_shared<Job>(&fn, n, false)); }
+
+  // 第 t 号线程（0 <= t < Size()）调用 fn(t)，所有线程完成后返回。
+  void RunOnEachThread(const std::function<void(size_t)> &fn) { Submit(std::make_shared<Job>(&fn, Size(), true)); }
+
+ private:
+  struct Job {
+    Job(const std::function<void(size_t)> *fn, size_t n, bool per_thread) : fn_(fn), n_(n), per_thread_(per_thread) {}
+    const std::function<void(size_t)> *fn_;
+    size_t n_;
+    bool per_thread_;
+    std::atomic<size_t> next_{0};
+    std::atomic<size_t> finished_{0};
+  };
+
+  void Submit(const std::shared_ptr<Job> &job) {
+    {
+      std::scoped_lock lk(mutex_);
+      job_ = job;
+      generation_++;
+    }
+    work_cv_.notify_all();
+    Run(job.get(), 0);
+    std::unique_lock lk(mutex_);
+    done_cv_.wait(lk, [&] { return job->finished_.load() == job->n_; });
+    job_.reset();
+  }
+
+  // 动态任务：领取任务直到没有剩余，晚醒来的线程领到的下标都不小于 n_，不会再访问 fn_。
+  // 按线程的任务：每个线程都必须执行一次才算完成，所以工作线程不会错过它。
+  void Run(Job *job, size_t id) {
+    if (job->per_thread_) {
+      (*job->fn_)(id);
+      Finish(job);
+      return;
+    }
+    for (size_t i = job->next_.fetch_add(1); i < job->n_; i = job->next_.fetch_add(1)) {
+      (*job->fn_)(i);
+      Finish(job);
+    }
+  }
+
+  void Finish(Job *job) {
+    if (job->finished_.fetch_add(1) + 1 == job->n_) {
+      std::scoped_lock lk(mutex_);
+      done_cv_.notify_all();
+    }
+  }
+
+  void WorkerLoop(size_t id) {
+    uint64_t seen = 0;
+    std::unique_lock lk(mutex_);
+    while (true) {
+      work_cv_.wait(lk, [&] { return stop_ || generation_ != seen; });
+      if (stop_) {
+        return;
+      }
+      seen = generation_;
+      std::shared_ptr<Job> job = job_;
+      lk.unlock();
+      if (job != nullptr) {
+        Run(job.get(), id);
+      }
+      lk.lock();
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  std::shared_ptr<Job> job_;
+  uint64_t generation_{0};
+  bool stop_{false};
+};
+
+// 把 [0, n) 平均分成 threads 段，返回第 t 段的起点。
+inline size_t ChunkBegin(size_t n, size_t threads, size_t t) { return n * t / threads; }
+
+// 分配 n 个元素的临时缓冲区：new T[n] 不触碰内存，第 t 号线程初始化第 t 段，
+// 这些页于是分配在第 t 号线程所在的 NUMA 节点上。
+template <typename T>
+std::unique_ptr<T[]> AllocateFirstTouch(size_t n, ThreadPool *pool) {
+  std::unique_ptr<T[]> buffer(new T[n]);
+  const size_t threads = pool->Size();
+  pool->RunOnEachThread([&](size_t t) {
+    std::fill(buffer.get() + ChunkBegin(n, threads, t), buffer.get() + ChunkBegin(n, threads, t + 1), T{});
+  });
+  return buffer;
+}
+
+constexpr int kRadixBits = 8;
+constexpr size_t kRadix = size_t{1} << kRadixBits;
+
+// 稳定的并行 LSD 基数排序。key_of(x) 返回一个无符号整数，元素按它的升序排列。
+template <typename T, typename KeyFn>
+void RadixSort(std::vector<T> *data, KeyFn key_of, ThreadPool *pool) {
+  using Key = decltype(key_of(std::declval<const T &>()));
+  static_assert(std::is_unsigned_v<Key>, "radix sort keys must be unsigned integers");
+  const size_t n = data->size();
+  const size_t threads = pool->Size();
+  if (n < 2) {
+    return;
+  }
+  std::unique_ptr<T[]> scratch = AllocateFirstTouch<T>(n, pool);
+  T *src = data->data();
+  T *dst = scratch.get();
+  std::vector<std::array<size_t, kRadix>> histograms(threads);
+
+  for (size_t shift = 0; shift < sizeof(Key) * 8; shift += kRadixBits) {
+    pool->RunOnEachThread([&](size_t t) {
+      auto &histogram = histograms[t];
+      histogram.fill(0);
+      for (size_t i = ChunkBegin(n, threads, t); i < ChunkBegin(n, threads, t + 1); i++) {
+        histogram[(key_of(src[i]) >> shift) & (kRadix - 1)]++;
+      }
+    });
+
+    // 前缀和：数字 d 的元素排在数字 0..d-1 之后；同一个数字中，线程 t 的元素排在线程 0..t-1 之后。
+    // 直方图原地变成每个线程在每个数字中的写入位置。
+    bool trivial = false;
+    size_t offset = 0;
+    for (size_t d = 0; d < kRadix; d++) {
+      size_t digit_begin = offset;
+      for (size_t t = 0; t < threads; t++) {
+        size_t count = histograms[t][d];
+        histograms[t][d] = offset;
+        offset += count;
+      }
+      trivial = trivial || offset - digit_begin == n;
+    }
+    if (trivial) {
+      continue;
+    }
+
+    pool->RunOnEachThread([&](size_t t) {
+      auto &cursor = histograms[t];
+      for (size_t i = ChunkBegin(n, threads, t); i < ChunkBegin(n, threads, t + 1); i++) {
+        dst[cursor[(key_of(src[i]) >> shift) & (kRadix - 1)]++] = src[i];
+      }
+    });
+    std::swap(src, dst);
+  }
+
+  if (src != data->data()) {
+    T *out = data->data();
+    pool->RunOnEachThread([&](size_t t) {
+      std::copy(src + ChunkBegin(n, threads, t), src + ChunkBegin(n, threads, t + 1), out + ChunkBegin(n, threads, t));
+    });
+  }
+}
+
+// 每个线程对应的桶数，以及每个桶的样本数（过采样率）。
+constexpr size_t kBucketsPerThread = 8;
+constexpr size_t kOversample = 64;
+// 平均每个桶至少这么多元素，否则直接用 std::sort。
+constexpr size_t kMinBucketSize = 1024;
+
+// 并行样本排序。comp 是任意严格弱序；结果与 std::sort 一样不保证稳定。
+template <typename T, typename Compare>
+void SampleSort(std::vector<T> *data, Compare comp, ThreadPool *pool) {
+  const size_t n = data->size();
+  const size_t threads = pool->Size();
+  const size_t buckets = std::min({threads * kBucketsPerThread, n / kMinBucketSize, size_t{UINT16_MAX}});
+  if (buckets < 2) {
+    std::sort(data->begin(), data->end(), comp);
+    return;
+  }
+
+  // 抽样并选出 buckets - 1 个分隔元素。桶 b 包含 splitters[b - 1] <= x < splitters[b] 的元素。
+  std::mt19937_64 rng(n);
+  std::vector<T> sample(buckets * kOversample);
+  for (auto &element : sample) {
+    element = (*data)[rng() % n];
+  }
+  std::sort(sample.begin(), sample.end(), comp);
+  std::vector<T> splitters(buckets - 1);
+  for (size_t b = 0; b + 1 < buckets; b++) {
+    splitters[b] = sample[(b + 1) * kOversample];
+  }
+
+  // 分类：记下每个元素的桶号，分散写入时就不用再做一次二分查找。
+  // bucket_of 同样不做初始化，第 t 段由第 t 号线程首次写入。
+  const T *in = data->data();
+  std::unique_ptr<uint16_t[]> bucket_of(new uint16_t[n]);
+  std::vector<std::vector<size_t>> cursors(threads, std::vector<size_t>(buckets, 0));
+  pool->RunOnEachThread([&](size_t t) {
+    auto &count = cursors[t];
+    for (size_t i = ChunkBegin(n, threads, t); i < ChunkBegin(n, threads, t + 1); i++) {
+      auto b = std::upper_bound(splitters.begin(), splitters.end(), in[i], comp) - splitters.begin();
+      bucket_of[i] = static_cast<uint16_t>(b);
+      count[b]++;
+    }
+  });
+
+  std::vector<size_t> bucket_begin(buckets + 1);
+  size_t offset = 0;
+  for (size_t b = 0; b < buckets; b++) {
+    bucket_begin[b] = offset;
+    for (size_t t = 0; t < threads; t++) {
+      size_t count = cursors[t][b];
+      cursors[t][b] = offset;
+      offset += count;
+    }
+  }
+  bucket_begin[buckets] = offset;
+
+  std::unique_ptr<T[]> scratch = AllocateFirstTouch<T>(n, pool);
+  T *buffer = scratch.get();
+  pool->RunOnEachThread([&](size_t t) {
+    auto &cursor = cursors[t];
+    for (size_t i = ChunkBegin(n, threads, t); i < ChunkBegin(n, threads, t + 1); i++) {
+      buffer[cursor[bucket_of[i]]++] = in[i];
+    }
+  });
+
+  // 各个桶互不相交且已按桶的顺序排列，分别排序并趁数据还在缓存中时拷回原数组。
+  T *out = data->data();
+  pool->ParallelFor(buckets, [&](size_t b) {
+    std::sort(buffer + bucket_begin[b], buffer + bucket_begin[b + 1], comp);
+    std::copy(buffer + bucket_begin[b], buffer + bucket_begin[b + 1], out + bucket_begin[b]);
+  });
+}
+
+// 与 vectors.cpp 中的 Point 类似，但是一个简单的聚合体，方便大量生成和比较。
+struct Point {
+  int x_;
+  int y_;
+
+  bool operator==(const Point &other) const { return x_ == other.x_ && y_ == other.y_; }
+};
+
+// 先按 x_，再按 y_ 排序。
+struct PointLess {
+  bool operator()(const Point &a, const Point &b) const { return a.x_ != b.x_ ? a.x_ < b.x_ : a.y_ < b.y_; }
+};
+
+// 翻转符号位，使有符号整数的顺序与无符号整数的顺序一致。
+inline uint32_t IntKey(int x) { return static_cast<uint32_t>(x) ^ 0x80000000U; }
+
+// 与 PointLess 顺序一致的 64 位基数排序键。
+inline uint64_t PointKey(const Point &p) { return static_cast<uint64_t>(IntKey(p.x_)) << 32 | IntKey(p.y_); }
+
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::cout << "CHECK FAILED: " << what << std::endl;
+    std::exit(1);
+  }
+}
+
+double MillisSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 用各种小输入（空数组、大量重复、极端值、按 x_ 的稳定性）与 std::sort 的结果对比。
+void CheckSmallInputs() {
+  ThreadPool pool(3);
+  std::mt19937_64 rng(7);
+  for (size_t n : {0, 1, 2, 3, 1000, 5000, 100000}) {
+    for (int range : {1, 10, INT_MAX}) {
+      std::vector<int> input(n);
+      for (auto &x : input) {
+        x = static_cast<int>(static_cast<int64_t>(rng() % (2 * static_cast<uint64_t>(range) + 1)) - range);
+      }
+      if (n > 2) {
+        input[0] = INT_MIN;
+        input[n - 1] = INT_MAX;
+      }
+      std::vector<int> expected = input;
+      std::sort(expected.begin(), expected.end());
+      std::vector<int> radix = input;
+      RadixSort(&radix, IntKey, &pool);
+      Check(radix == expected, "radix sort matches std::sort");
+      std::vector<int> sample = input;
+      SampleSort(&sample, std::less<int>(), &pool);
+      Check(sample == expected, "sample sort matches std::sort");
+    }
+  }
+
+  // 只按 x_ 做基数排序时，x_ 相同的点保持原来的相对顺序（y_ 记录原来的位置）。
+  std::vector<Point> points(50000);
+  for (size_t i = 0; i < points.size(); i++) {
+    points[i] = Point{static_cast<int>(rng() % 100) - 50, static_cast<int>(i)};
+  }
+  std::vector<Point> expected = points;
+  std::stable_sort(expected.begin(), expected.end(), [](const Point &a, const Point &b) { return a.x_ < b.x_; });
+  std::vector<Point> radix = points;
+  RadixSort(&radix, [](const Point &p) { return IntKey(p.x_); }, &pool);
+  Check(radix == expected, "radix sort is stable");
+  std::cout << "Radix sort and sample sort agree with std::sort on small inputs\n";
+}
+
+// 对 input 的副本分别运行各个排序，检查结果一致并打印耗时。
+template <typename T, typename Compare, typename KeyFn>
+void BenchmarkSorts(const char *name, const std::vector<T> &input, Compare comp, KeyFn key_of, size_t max_threads) {
+  const double millions = static_cast<double>(input.size()) / 1e6;
+  std::cout << name << ", " << input.size() << " elements:\n";
+  auto report = [&](const std::string &label, double ms, double baseline_ms) {
+    std::cout << "  " << label << ms << " ms, " << millions / ms * 1000 << " M elements/s";
+    if (baseline_ms > 0) {
+      std::cout << " (" << baseline_ms / ms << "x)";
+    }
+    std::cout << "\n";
+  };
+
+  std::vector<T> expected = input;
+  auto start = std::chrono::steady_clock::now();
+  std::sort(expected.begin(), expected.end(), comp);
+  double baseline_ms = MillisSince(start);
+  report("std::sort:                       ", baseline_ms, 0);
+
+#ifdef BOOTCAMP_HAVE_PARALLEL_STL
+  {
+    std::vector<T> data = input;
+    start = std::chrono::steady_clock::now();
+    std::sort(std::execution::par, data.begin(), data.end(), comp);
+    double ms = MillisSince(start);
+    Check(data == expected, "std::execution::par sort matches std::sort");
+    report("std::sort(execution::par):       ", ms, baseline_ms);
+  }
+#endif
+
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    ThreadPool pool(threads);
+    std::vector<T> data = input;
+    start = std::chrono::steady_clock::now();
+    RadixSort(&data, key_of, &pool);
+    double ms = MillisSince(start);
+    Check(data == expected, "radix sort matches std::sort");
+    report("radix sort, " + std::to_string(threads) + " thread(s):        ", ms, baseline_ms);
+
+    data = input;
+    start = std::chrono::steady_clock::now();
+    SampleSort(&data, comp, &pool);
+    ms = MillisSince(start);
+    Check(data == expected, "sample sort matches std::sort");
+    report("sample sort, " + std::to_string(threads) + " thread(s):       ", ms, baseline_ms);
+  }
+}
+
+// 用法：./parallel_sort [最大元素数] [最大线程数]
+// 元素数从 1M 开始每次乘 4，直到最大元素数。默认只到 4M 以便几秒内跑完；
+// 1B 个 int 需要约 16 GB 内存（输入、参照结果、工作副本和临时缓冲区各一份）。
+int main(int argc, char *argv[]) {
+  size_t max_elements = argc > 1 ? std::stoul(argv[1]) : 4'000'000;
+  size_t max_threads = argc > 2 ? std::stoul(argv[2]) : 4;
+
+  CheckSmallInputs();
+
+  std::mt19937_64 rng(42);
+  for (size_t n = 1'000'000; n <= max_elements; n *= 4) {
+    std::vector<int> ints(n);
+    for (auto &x : ints) {
+      x = static_cast<int>(rng());
+    }
+    BenchmarkSorts("std::vector<int>", ints, std::less<int>(), IntKey, max_threads);
+
+    std::vector<Point> points(n);
+    for (auto &p : points) {
+      p = Point{static_cast<int>(rng() % 100000), static_cast<int>(rng())};
+    }
+    BenchmarkSorts("std::vector<Point>", points, PointLess(), PointKey, max_threads);
+  }
+  return 0;
+}
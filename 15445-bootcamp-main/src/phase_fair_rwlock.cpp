@@ -0,0 +1,265 @@
+/**
+ * @file phase_fair_rwlock.cpp
+ * @brief 相位公平（phase-fair）读写锁的教学示例，带写者等待时间与读者批大小统计。
+ */
+
+// 当很多线程不停地调用 rwlock.cpp 中的 read_value 时，只要任意时刻都有读者持有共享锁，
+// 写者就可能一直拿不到独占锁，这就是“写者饥饿”。std::shared_mutex 是否偏向读者取决于实现，
+// 某些 libstdc++ 版本在读者饱和的负载下会让 write_value 等待非常久。
+
+// 相位公平读写锁（Brandenburg & Anderson, "Spin-Based Reader-Writer Synchronization for
+// Multiprocessor Real-Time Systems", 2010）把时间划分为交替的“读相位”和“写相位”：
+// 1. 写者到来后，之后到来的读者必须等待；写者只需等已经在临界区内的读者离开。
+// 2. 写者释放锁时，所有在它之后排队的读者作为一批同时进入（一个读相位），哪怕后面还有写者在排队。
+// 3. 写者之间按照票号（ticket）先来先服务。
+// 因此写者最多等待一个读相位加上排在它前面的写者，读者最多等待一个写相位，双方都不会饥饿。
+
+// 下面实现的是论文中的 PF-T（基于票号的相位公平锁）：
+// - rin_ / rout_：进入和离开的读者计数，以 kReaderInc 为步长递增；rin_ 的低两位用来表示
+//   “有写者存在”（kWriterPresent）以及当前写者的相位编号（kPhaseId）。
+// - win_ / wout_：写者的票号。
+// 锁同时记录每个写者的等待时间和每个读相位进入的读者数量，用于观察公平性。
+
+// 包含 std::sort（用于计算分位数）。
+#include <algorithm>
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 mutex 头文件（std::unique_lock）。
+#include <mutex>
+// 包含 shared_mutex 头文件（std::shared_lock 以及对比基准）。
+#include <shared_mutex>
+// 包含 std::string 与 std::to_string。
+#include <string>
+// 包含 thread 头文件。
+#include <thread>
+// 包含 std::vector。
+#include <vector>
+
+class PhaseFairRWLock {
+ public:
+  PhaseFairRWLock() = default;
+  PhaseFairRWLock(const PhaseFairRWLock &) = delete;
+  PhaseFairRWLock &operator=(const PhaseFairRWLock &) = delete;
+
+  // 读者加锁：登记进入。如果此时有写者存在，就等待写者的相位结束（rin_ 的低两位发生变化）。
+  void lock_shared() {
+    uint32_t writer_bits = rin_.fetch_add(kReaderInc, std::memory_order_acquire) & kWriterBits;
+    if (writer_bits != 0) {
+      while ((rin_.load(std::memory_order_acquire) & kWriterBits) == writer_bits) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  // 只有在没有写者存在时才进入。
+  bool try_lock_shared() {
+    uint32_t current = rin_.load(std::memory_order_relaxed);
+    while ((current & kWriterBits) == 0) {
+      if (rin_.compare_exchange_weak(current, current + kReaderInc, std::memory_order_acquire,
+                                     std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void unlock_shared() { rout_.fetch_add(kReaderInc, std::memory_order_release); }
+
+  // 写者加锁：先按票号排队，轮到自己后设置“写者存在”位（挡住新读者），再等已进入的读者全部离开。
+  void lock() {
+    auto start = std::chrono::steady_clock::now();
+    uint32_t ticket = win_.fetch_add(1, std::memory_order_relaxed);
+    while (wout_.load(std::memory_order_acquire) != ticket) {
+      std::this_thread::yield();
+    }
+    uint32_t readers_in = rin_.fetch_add(kWriterPresent | (ticket & kPhaseId), std::memory_order_acquire);
+    while (rout_.load(std::memory_order_acquire) != readers_in) {
+      std::this_thread::yield();
+    }
+    RecordAcquire(start, readers_in);
+  }
+
+  // try_lock 只在没有其他写者、也没有读者时才尝试。抢到票号之后，可能仍有读者在检查与登记之间进入，
+  // 此时需要短暂等待它们离开（这些读者已在临界区内，等待是有界的）。
+  bool try_lock() {
+    uint32_t ticket = wout_.load(std::memory_order_acquire);
+    if (rin_.load(std::memory_order_relaxed) != rout_.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    if (!win_.compare_exchange_strong(ticket, ticket + 1, std::memory_order_relaxed)) {
+      return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    uint32_t readers_in = rin_.fetch_add(kWriterPresent | (ticket & kPhaseId), std::memory_order_acquire);
+    while (rout_.load(std::memory_order_acquire) != readers_in) {
+      std::this_thread::yield();
+    }
+    RecordAcquire(start, readers_in);
+    return true;
+  }
+
+  // 写者解锁：清除 rin_ 的写者位，放行所有等待中的读者（开始一个新的读相位），再把锁交给下一个写者。
+  void unlock() {
+    rin_.fetch_and(~kWriterBits, std::memory_order_release);
+    wout_.fetch_add(1, std::memory_order_release);
+  }
+
+  // 统计信息：写者等待时间（纳秒）与读者批大小。只有持有写锁的线程会写入这些字段，
+  // 因此读取统计时需要保证没有并发的写者（例如在所有线程结束之后）。
+  struct Stats {
+    std::vector<double> writer_wait_ns_;
+    std::vector<uint32_t> reader_batches_;
+  };
+
+  const Stats &GetStats() const { return stats_; }
+
+ private:
+  static constexpr uint32_t kReaderInc = 0x100;
+  static constexpr uint32_t kWriterPresent = 0x2;
+  static constexpr uint32_t kPhaseId = 0x1;
+  static constexpr uint32_t kWriterBits = kWriterPresent | kPhaseId;
+  // rin_ 的高 24 位是读者计数，会自然回绕；计算差值时只保留这 24 位。
+  static constexpr uint32_t kReaderCountMask = 0xFFFFFF;
+
+  // 记录本次写者的等待时间，以及自上一个写相位以来进入的读者数（即上一个读相位的批大小）。
+  void RecordAcquire(std::chrono::steady_clock::time_point start, uint32_t readers_in) {
+    stats_.writer_wait_ns_.push_back(
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+    uint32_t readers = readers_in / kReaderInc;
+    stats_.reader_batches_.push_back((readers - last_readers_in_) & kReaderCountMask);
+    last_readers_in_ = readers;
+  }
+
+  // rin_ 与 rout_ 被读者频繁修改，win_ 与 wout_ 只被写者修改，放在不同的缓存行上。
+  alignas(64) std::atomic<uint32_t> rin_{0};
+  alignas(64) std::atomic<uint32_t> rout_{0};
+  alignas(64) std::atomic<uint32_t> win_{0};
+  std::atomic<uint32_t> wout_{0};
+  uint32_t last_readers_in_{0};
+  Stats stats_;
+};
+
+// 与 rwlock.cpp 相同的例子，只是把 std::shared_mutex 换成了 PhaseFairRWLock。
+int count = 0;
+PhaseFairRWLock m;
+
+void read_value() {
+  std::shared_lock lk(m);
+  std::cout << "Reading value " + std::to_string(count) + "\n" << std::flush;
+}
+
+void write_value() {
+  std::unique_lock lk(m);
+  count += 3;
+}
+
+// 返回 values 的第 p 百分位数（按值传入，在副本上排序）。
+template <typename T>
+double Percentile(std::vector<T> values, double p) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  return values[static_cast<size_t>(p / 100 * (values.size() - 1))];
+}
+
+// 保存读者读到的值，防止编译器把读操作优化掉。
+std::atomic<uint64_t> benchmark_sink{0};
+
+// 读者饱和负载：readers 个读者不停地进出临界区（临界区内做少量工作），
+// writers 个写者每隔 100 微秒请求一次写锁。在锁外部统一测量每次写锁的等待时间。
+template <typename Lock>
+void RunBench(const char *name, Lock &lock, int readers, int writers, std::chrono::milliseconds duration) {
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> read_ops{0};
+  std::vector<std::vector<double>> waits(writers);
+  uint64_t value = 0;
+  std::vector<std::thread> threads;
+
+  for (int r = 0; r < readers; r++) {
+    threads.emplace_back([&] {
+      uint64_t ops = 0;
+      uint64_t sink = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        std::shared_lock lk(lock);
+        for (int i = 0; i < 50; i++) {
+          sink += value + i;
+        }
+        ops += 1;
+      }
+      read_ops.fetch_add(ops);
+      benchmark_sink.fetch_add(sink, std::memory_order_relaxed);
+    });
+  }
+  for (int w = 0; w < writers; w++) {
+    threads.emplace_back([&, w] {
+      while (!stop.load(std::memory_order_relaxed)) {
+        auto start = std::chrono::steady_clock::now();
+        {
+          std::unique_lock lk(lock);
+          waits[w].push_back(
+              std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+          value += 1;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    });
+  }
+  std::this_thread::sleep_for(duration);
+  stop.store(true);
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  std::vector<double> all;
+  for (auto &w : waits) {
+    all.insert(all.end(), w.begin(), w.end());
+  }
+  double seconds = std::chrono::duration<double>(duration).count();
+  std::cout << name << ": " << read_ops.load() / seconds / 1e6 << " M reads/s, " << all.size()
+            << " writes, writer wait p50 " << Percentile(all, 50) << " us, p99 " << Percentile(all, 99)
+            << " us, max " << Percentile(all, 100) << " us\n";
+}
+
+// 用法：./phase_fair_rwlock [读者线程数] [写者线程数] [每个配置运行的毫秒数]
+int main(int argc, char *argv[]) {
+  int readers = argc > 1 ? std::stoi(argv[1]) : 8;
+  int writers = argc > 2 ? std::stoi(argv[2]) : 1;
+  std::chrono::milliseconds duration(argc > 3 ? std::stoi(argv[3]) : 500);
+
+  // 第一部分：rwlock.cpp 的例子。
+  std::thread t1(read_value);
+  std::thread t2(write_value);
+  std::thread t3(read_value);
+  std::thread t4(read_value);
+  std::thread t5(write_value);
+  std::thread t6(read_value);
+  t1.join();
+  t2.join();
+  t3.join();
+  t4.join();
+  t5.join();
+  t6.join();
+
+  // 第二部分：读者饱和负载下写者等待时间的对比。
+  std::cout << readers << " readers, " << writers << " writers\n";
+  {
+    std::shared_mutex baseline;
+    RunBench("  std::shared_mutex", baseline, readers, writers, duration);
+  }
+  {
+    PhaseFairRWLock lock;
+    RunBench("  PhaseFairRWLock  ", lock, readers, writers, duration);
+    // 锁内部的统计：写者等待时间与每个读相位的读者批大小。
+    const auto &stats = lock.GetStats();
+    std::cout << "  PhaseFairRWLock internal stats: writer wait p99 " << Percentile(stats.writer_wait_ns_, 99) / 1000
+              << " us, max " << Percentile(stats.writer_wait_ns_, 100) / 1000 << " us; reader batch size p50 "
+              << Percentile(stats.reader_batches_, 50) << ", p99 " << Percentile(stats.reader_batches_, 99)
+              << ", max " << Percentile(stats.reader_batches_, 100) << "\n";
+  }
+  return 0;
+}
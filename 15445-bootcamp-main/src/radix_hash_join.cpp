@@ -0,0 +1,375 @@
+/**
+ * @file radix_hash_join.cpp
+ * @brief 基数分区（radix-partitioned）的并行哈希连接：两个输入先按哈希值的高位并行分区
+ *        （使用软件写合并缓冲区），再在线程池上逐个分区建哈希表并探测。
+ */
+
+// 最简单的哈希连接用较小的输入（build 侧，R）建一个 std::unordered_map（见 unordered_maps.cpp），
+// 再用较大的输入（probe 侧，S）的每个元组去查它。当 R 很大时，哈希表远大于 CPU 缓存，
+// 每次探测都是一次随机的内存访问，几乎每次都缓存未命中（还有 TLB 未命中），而且只能用一个核。
+// 基数分区连接（Kim 等，VLDB 2009；Balkesen 等，ICDE 2013）先把 R 与 S 按键的哈希值的高 bits 位
+// 分成 2^bits 个分区：R 的第 p 个分区只可能与 S 的第 p 个分区匹配，所以连接变成 2^bits 个
+// 互不相关的小连接。bits 选得使每个 R 分区的哈希表能放进 L2 缓存，探测就几乎都命中缓存，
+// 而各个分区可以交给线程池中的不同线程并行处理。
+
+// 分区本身分三步并行完成：
+// 1. 每个线程统计自己负责的那段输入中每个分区的元组数（直方图）；
+// 2. 对所有线程的直方图求前缀和，得到每个线程在每个分区中的写入起点，线程之间不会写到同一位置；
+// 3. 每个线程把元组分散写到各个分区。分区很多时，这一步会同时向成百上千个不同的地址写入，
+//    造成大量缓存与 TLB 未命中。软件写合并（software write-combining）缓冲区为每个分区准备
+//    一个缓存行大小（64 字节，4 个元组）的小缓冲区，元组先写进这个常驻缓存的缓冲区，
+//    攒满一个缓存行才整体拷贝到输出中。
+// 每个分区的连接使用线性探测的开放寻址哈希表，比 std::unordered_map（每个元素一个链表节点）紧凑得多。
+// 线程池的 ParallelFor(n, fn) 让所有线程（包括调用者）动态地领取 0..n-1 的任务，
+// 空闲的线程自动去做剩下的任务，所以大小不均匀的分区也能较好地负载均衡。
+
+// 包含 std::shuffle。
+#include <algorithm>
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 std::exit。
+#include <cstdlib>
+// 包含 std::memcpy。
+#include <cstring>
+// 包含 std::condition_variable。
+#include <condition_variable>
+// 包含 std::function。
+#include <functional>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::shared_ptr。
+#include <memory>
+// 包含 std::mutex。
+#include <mutex>
+// 包含 std::mt19937_64（用于生成数据）。
+#include <random>
+// 包含 std::string（用于解析命令行参数）。
+#include <string>
+// 包含 thread 头文件。
+#include <thread>
+// 包含 std::unordered_map。
+#include <unordered_map>
+// 包含 std::vector。
+#include <vector>
+
+struct Tuple {
+  uint64_t key_;
+  uint64_t payload_;
+};
+
+// 一个缓存行能放下的元组数。
+constexpr size_t kTuplesPerLine = 64 / sizeof(Tuple);
+// 开放寻址哈希表中表示空槽位的键，生成数据时不会用到它。
+constexpr uint64_t kEmptyKey = ~0ULL;
+
+inline uint64_t Hash(uint64_t key) { return key * 0x9E3779B97F4A7C15ULL; }
+
+// 线程池：构造时启动 threads - 1 个工作线程，调用 ParallelFor 的线程是第 threads 个。
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t threads) {
+    for (size_t i = 1; i < threads; i++) {
+      workers_.emplace_back([this] { WorkerLoop(); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::scoped_lock lk(mutex_);
+      stop_ = true;
+    }
+    work_cv_.notify_all();
+    for (auto &worker : workers_) {
+      worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  size_t Size() const { return workers_.size() + 1; }
+
+  // 对 0..n-1 的每个 i 调用 fn(i)，所有任务完成后返回。
+  void ParallelFor(size_t n, const std::function<void(size_t)> &fn) {
+    auto job = std::make_shared<Job>(&fn, n);
+    {
+      std::scoped_lock lk(mutex_);
+      job_ = job;
+      generation_++;
+    }
+    work_cv_.notify_all();
+    Run(job.get());
+    std::unique_lock lk(mutex_);
+    done_cv_.wait(lk, [&] { return job->finished_.load() == n; });
+    job_.reset();
+  }
+
+ private:
+  struct Job {
+    Job(const std::function<void(size_t)> *fn, size_t n) : fn_(fn), n_(n) {}
+    const std::function<void(size_t)> *fn_;
+    size_t n_;
+    std::atomic<size_t> next_{0};
+    std::atomic<size_t> finished_{0};
+  };
+
+  // 领取任务直到没有剩余。晚醒来的线程领到的下标都不小于 n_，不会再访问 fn_。
+  void Run(Job *job) {
+    for (size_t i = job->next_.fetch_add(1); i < job->n_; i = job->next_.fetch_add(1)) {
+      (*job->fn_)(i);
+      if (job->finished_.fetch_add(1) + 1 == job->n_) {
+        std::scoped_lock lk(mutex_);
+        done_cv_.notify_all();
+      }
+    }
+  }
+
+  void WorkerLoop() {
+    uint64_t seen = 0;
+    std::unique_lock lk(mutex_);
+    while (true) {
+      work_cv_.wait(lk, [&] { return stop_ || generation_ != seen; });
+      if (stop_) {
+        return;
+      }
+      seen = generation_;
+      std::shared_ptr<Job> job = job_;
+      lk.unlock();
+      if (job != nullptr) {
+        Run(job.get());
+      }
+      lk.lock();
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  std::shared_ptr<Job> job_;
+  uint64_t generation_{0};
+  bool stop_{false};
+};
+
+// 分区后的关系：第 p 个分区是 tuples_[offsets_[p], offsets_[p + 1])。
+// tuples_ 不做零初始化（new Tuple[n]），分散写入时才第一次写这块内存。
+struct PartitionedRelation {
+  std::unique_ptr<Tuple[]> tuples_;
+  std::vector<size_t> offsets_;
+};
+
+// 把 input 按 Hash(key) 的高 bits 位分成 2^bits 个分区。
+PartitionedRelation RadixPartition(const std::vector<Tuple> &input, int bits, ThreadPool *pool) {
+  const size_t partitions = size_t{1} << bits;
+  const size_t threads = pool->Size();
+  const int shift = 64 - bits;
+  auto chunk_begin = [&](size_t t) { return input.size() * t / threads; };
+
+  // 第一步：每个线程统计自己那段输入的直方图。
+  std::vector<std::vector<size_t>> histograms(threads, std::vector<size_t>(partitions, 0));
+  pool->ParallelFor(threads, [&](size_t t) {
+    auto &histogram = histograms[t];
+    for (size_t i = chunk_begin(t); i < chunk_begin(t + 1); i++) {
+      histogram[Hash(input[i].key_) >> shift]++;
+    }
+  });
+
+  // 第二步：前缀和。分区 p 中，线程 t 的元组排在线程 0..t-1 的元组之后。
+  PartitionedRelation result;
+  result.tuples_.reset(new Tuple[input.size()]);
+  result.offsets_.assign(partitions + 1, 0);
+  std::vector<std::vector<size_t>> cursors(threads, std::vector<size_t>(partitions));
+  size_t offset = 0;
+  for (size_t p = 0; p < partitions; p++) {
+    result.offsets_[p] = offset;
+    for (size_t t = 0; t < threads; t++) {
+      cursors[t][p] = offset;
+      offset += histograms[t][p];
+    }
+  }
+  result.offsets_[partitions] = offset;
+
+  // 第三步：经过写合并缓冲区分散写入。
+  struct alignas(64) CacheLine {
+    Tuple tuples_[kTuplesPerLine];
+  };
+  Tuple *out = result.tuples_.get();
+  pool->ParallelFor(threads, [&](size_t t) {
+    std::vector<CacheLine> buffers(partitions);
+    std::vector<uint8_t> fill(partitions, 0);
+    auto &cursor = cursors[t];
+    for (size_t i = chunk_begin(t); i < chunk_begin(t + 1); i++) {
+      size_t p = Hash(input[i].key_) >> shift;
+      buffers[p].tuples_[fill[p]++] = input[i];
+      if (fill[p] == kTuplesPerLine) {
+        std::memcpy(out + cursor[p], buffers[p].tuples_, sizeof(CacheLine));
+        cursor[p] += kTuplesPerLine;
+        fill[p] = 0;
+      }
+    }
+    for (size_t p = 0; p < partitions; p++) {
+      std::memcpy(out + cursor[p], buffers[p].tuples_, fill[p] * sizeof(Tuple));
+    }
+  });
+  return result;
+}
+
+struct JoinResult {
+  uint64_t matches_{0};
+  uint64_t checksum_{0};
+
+  bool operator==(const JoinResult &other) const {
+    return matches_ == other.matches_ && checksum_ == other.checksum_;
+  }
+};
+
+// 连接 R 与 S 的一对分区：R 分区建线性探测的哈希表，S 分区逐个探测。R 的键是唯一的（主键），
+// 所以找到一个匹配就可以停下。结果不物化，只统计匹配数与校验和。
+JoinResult JoinPartition(const Tuple *r, size_t r_size, const Tuple *s, size_t s_size, int bits,
+                         std::vector<Tuple> *table) {
+  size_t capacity = 16;
+  while (capacity < 2 * r_size) {
+    capacity *= 2;
+  }
+  table->assign(capacity, Tuple{kEmptyKey, 0});
+  const uint64_t mask = capacity - 1;
+  // 高 bits 位在同一个分区中都相同，所以槽位用哈希值中紧接着的那些位。
+  auto slot_of = [&](uint64_t key) { return (Hash(key) << bits >> 32) & mask; };
+  Tuple *slots = table->data();
+  for (size_t i = 0; i < r_size; i++) {
+    uint64_t slot = slot_of(r[i].key_);
+    while (slots[slot].key_ != kEmptyKey) {
+      slot = (slot + 1) & mask;
+    }
+    slots[slot] = r[i];
+  }
+  JoinResult result;
+  for (size_t i = 0; i < s_size; i++) {
+    for (uint64_t slot = slot_of(s[i].key_); slots[slot].key_ != kEmptyKey; slot = (slot + 1) & mask) {
+      if (slots[slot].key_ == s[i].key_) {
+        result.matches_++;
+        result.checksum_ += slots[slot].payload_ ^ s[i].payload_;
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+// 选择分区数，使每个 R 分区的哈希表（2 倍容量，每个槽位 16 字节）大约不超过 256 KB 的 L2 缓存。
+int ChooseRadixBits(size_t r_size) {
+  const size_t tuples_per_partition = 256 * 1024 / (2 * sizeof(Tuple));
+  int bits = 1;
+  while ((r_size >> bits) > tuples_per_partition && bits < 14) {
+    bits++;
+  }
+  return bits;
+}
+
+struct Timings {
+  double partition_ms_{0};
+  double join_ms_{0};
+};
+
+double MillisSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+JoinResult RadixJoin(const std::vector<Tuple> &r, const std::vector<Tuple> &s, ThreadPool *pool, Timings *timings) {
+  int bits = ChooseRadixBits(r.size());
+  auto start = std::chrono::steady_clock::now();
+  PartitionedRelation r_parts = RadixPartition(r, bits, pool);
+  PartitionedRelation s_parts = RadixPartition(s, bits, pool);
+  timings->partition_ms_ = MillisSince(start);
+
+  start = std::chrono::steady_clock::now();
+  const size_t partitions = size_t{1} << bits;
+  std::vector<JoinResult> results(partitions);
+  pool->ParallelFor(partitions, [&](size_t p) {
+    thread_local std::vector<Tuple> table;
+    results[p] = JoinPartition(r_parts.tuples_.get() + r_parts.offsets_[p], r_parts.offsets_[p + 1] - r_parts.offsets_[p],
+                               s_parts.tuples_.get() + s_parts.offsets_[p], s_parts.offsets_[p + 1] - s_parts.offsets_[p],
+                               bits, &table);
+  });
+  JoinResult total;
+  for (auto &result : results) {
+    total.matches_ += result.matches_;
+    total.checksum_ += result.checksum_;
+  }
+  timings->join_ms_ = MillisSince(start);
+  return total;
+}
+
+// 对比用：单线程，用 std::unordered_map 建整个 R 的哈希表。
+JoinResult NaiveJoin(const std::vector<Tuple> &r, const std::vector<Tuple> &s, Timings *timings) {
+  auto start = std::chrono::steady_clock::now();
+  std::unordered_map<uint64_t, uint64_t> table;
+  table.reserve(r.size());
+  for (auto &tuple : r) {
+    table.emplace(tuple.key_, tuple.payload_);
+  }
+  timings->partition_ms_ = MillisSince(start);
+  start = std::chrono::steady_clock::now();
+  JoinResult result;
+  for (auto &tuple : s) {
+    auto it = table.find(tuple.key_);
+    if (it != table.end()) {
+      result.matches_++;
+      result.checksum_ += it->second ^ tuple.payload_;
+    }
+  }
+  timings->join_ms_ = MillisSince(start);
+  return result;
+}
+
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::cout << "CHECK FAILED: " << what << std::endl;
+    std::exit(1);
+  }
+}
+
+// 用法：./radix_hash_join [R 的元组数] [S 的元组数] [最大线程数]
+// 默认规模比 10M x 100M 小，以便在普通机器上几秒内跑完；可以通过参数放大。
+int main(int argc, char *argv[]) {
+  size_t r_size = argc > 1 ? std::stoul(argv[1]) : 4'000'000;
+  size_t s_size = argc > 2 ? std::stoul(argv[2]) : 16'000'000;
+  size_t max_threads = argc > 3 ? std::stoul(argv[3]) : 4;
+
+  // R 的键是 1..r_size 的一个随机排列；S 的键从 R 的键中均匀抽取（外键），另有 1/10 不匹配。
+  std::mt19937_64 rng(42);
+  std::vector<Tuple> r(r_size);
+  for (size_t i = 0; i < r_size; i++) {
+    r[i] = Tuple{i + 1, rng()};
+  }
+  std::shuffle(r.begin(), r.end(), rng);
+  std::vector<Tuple> s(s_size);
+  for (auto &tuple : s) {
+    uint64_t key = rng() % 10 == 0 ? r_size + 1 + rng() % r_size : rng() % r_size + 1;
+    tuple = Tuple{key, rng()};
+  }
+  double total_tuples = static_cast<double>(r_size + s_size);
+
+  std::cout << "Joining R (" << r_size << " tuples) with S (" << s_size << " tuples), "
+            << (size_t{1} << ChooseRadixBits(r_size)) << " partitions\n";
+  Timings naive_timings;
+  JoinResult expected = NaiveJoin(r, s, &naive_timings);
+  double naive_ms = naive_timings.partition_ms_ + naive_timings.join_ms_;
+  std::cout << "  unordered_map join:       build " << naive_timings.partition_ms_ << " ms, probe "
+            << naive_timings.join_ms_ << " ms, " << total_tuples / naive_ms / 1000 << " M tuples/s ("
+            << expected.matches_ << " matches)\n";
+
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    ThreadPool pool(threads);
+    Timings timings;
+    JoinResult result = RadixJoin(r, s, &pool, &timings);
+    Check(result == expected, "the radix join finds the same matches as the unordered_map join");
+    double ms = timings.partition_ms_ + timings.join_ms_;
+    std::cout << "  radix join, " << threads << " thread(s):  partition " << timings.partition_ms_ << " ms, join "
+              << timings.join_ms_ << " ms, " << total_tuples / ms / 1000 << " M tuples/s (" << naive_ms / ms
+              << "x)\n";
+  }
+  return 0;
+}
@@ -0,0 +1,430 @@
+/**
+ * @file rcu.cpp
+ * @brief 用户态 RCU（Read-Copy-Update）的教学示例：基于纪元（epoch）的宽限期、RAII 读者守卫与后台回收线程。
+ */
+
+// rwlock.cpp 中的 read_value/write_value 可以看作配置表、路由表一类数据的读者与写者：
+// 读者非常多，且绝不能因为写者而阻塞；写者很少，慢一点也没有关系。读写锁无法满足“读者绝不阻塞”，
+// 因为写者持有独占锁时读者必须等待。
+
+// RCU 的思路是：
+// 1. 读者在“读侧临界区”（rcu_read_lock 与 rcu_read_unlock 之间）直接读取共享指针指向的数据，不加任何锁。
+// 2. 写者不原地修改数据，而是拷贝一份、修改副本（copy），然后原子地把共享指针指向新副本（update）。
+// 3. 旧副本不能立刻释放，因为可能还有读者在使用它。写者要等待一个“宽限期”（grace period）：
+//    所有在指针替换之前进入读侧临界区的读者都离开之后，旧副本才能被释放（reclaim）。
+//    写者可以同步等待（synchronize_rcu），也可以把释放操作交给后台线程（call_rcu）。
+
+// 这里使用基于纪元的宽限期检测：全局纪元 global_epoch_ 单调递增，读者进入临界区时把当前纪元记录在
+// 自己的线程记录中，离开时清零。synchronize_rcu 把全局纪元加 1 得到 target，然后等待所有
+// “记录的纪元非零且小于 target”的读者离开。之后才进入临界区的读者一定看到了新指针，不需要等待，
+// 因此源源不断的新读者不会让写者饿死。
+
+// Linux 内核中 RCU 的介绍：https://www.kernel.org/doc/html/latest/RCU/whatisRCU.html
+// 用户态 RCU 库 liburcu：https://liburcu.org/
+
+// 包含 std::sort（用于计算延迟分位数）。
+#include <algorithm>
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 condition_variable 头文件（后台回收线程使用）。
+#include <condition_variable>
+// 包含 std::function，用于保存回收回调。
+#include <functional>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::unique_ptr。
+#include <memory>
+// 包含 mutex 头文件。
+#include <mutex>
+// 包含 shared_mutex 头文件（用于对比基准）。
+#include <shared_mutex>
+// 包含 std::string 与 std::to_string。
+#include <string>
+// 包含 thread 头文件。
+#include <thread>
+// 包含 std::vector。
+#include <vector>
+
+// RcuDomain 管理全局纪元、所有读者线程的记录以及后台回收线程。整个程序只使用一个实例（见 GetRcuDomain）。
+class RcuDomain {
+ public:
+  RcuDomain() : reclaimer_([this] { ReclaimerLoop(); }) {}
+
+  // 析构时先执行完所有尚未执行的回调，再停止后台线程。
+  ~RcuDomain() {
+    Barrier();
+    {
+      std::scoped_lock lk(callbacks_m_);
+      stop_ = true;
+    }
+    callbacks_cv_.notify_all();
+    reclaimer_.join();
+  }
+
+  RcuDomain(const RcuDomain &) = delete;
+  RcuDomain &operator=(const RcuDomain &) = delete;
+
+  // 进入读侧临界区。支持嵌套：只有最外层才记录纪元。
+  // 记录纪元之后的 seq_cst 栅栏与 Synchronize 中的栅栏配对：要么写者看到我们记录的纪元并等待，
+  // 要么我们在栅栏之后读到写者已经发布的新指针。
+  void ReadLock() {
+    ThreadRecord *record = Self();
+    if (record->nesting_++ == 0) {
+      record->epoch_.store(global_epoch_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+  }
+
+  // 离开读侧临界区。release 保证临界区内的读取都发生在清零之前。
+  void ReadUnlock() {
+    ThreadRecord *record = Self();
+    if (--record->nesting_ == 0) {
+      record->epoch_.store(0, std::memory_order_release);
+    }
+  }
+
+  // 等待一个宽限期：返回时，所有在调用之前进入读侧临界区的读者都已离开。
+  // 注意：不能在读侧临界区内调用，否则会等待自己，造成死锁。
+  void Synchronize() {
+    std::scoped_lock sync_lk(synchronize_m_);
+    uint64_t target = global_epoch_.fetch_add(1, std::memory_order_seq_cst) + 1;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // 只在拷贝记录指针时持有 registry_m_，等待时不持有，否则新读者的注册和读者线程的退出会被宽限期阻塞。
+    // 记录从不释放，所以指针一直有效。拷贝之后才注册的读者一定读到不小于 target 的纪元，不需要等待。
+    std::vector<ThreadRecord *> records;
+    {
+      std::scoped_lock registry_lk(registry_m_);
+      records.reserve(records_.size());
+      for (auto &record : records_) {
+        records.push_back(record.get());
+      }
+    }
+    for (ThreadRecord *record : records) {
+      while (true) {
+        uint64_t epoch = record->epoch_.load(std::memory_order_acquire);
+        if (epoch == 0 || epoch >= target) {
+          break;
+        }
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  // 注册一个回调，在当前宽限期结束后由后台线程执行（通常用来释放旧数据）。调用者不会阻塞。
+  void CallRcu(std::function<void()> callback) {
+    {
+      std::scoped_lock lk(callbacks_m_);
+      pending_.push_back(std::move(callback));
+      enqueued_ += 1;
+    }
+    callbacks_cv_.notify_all();
+  }
+
+  // 等待在此之前注册的所有回调执行完毕。
+  void Barrier() {
+    std::unique_lock lk(callbacks_m_);
+    uint64_t target = enqueued_;
+    completed_cv_.wait(lk, [&] { return completed_ >= target; });
+  }
+
+ private:
+  // 每个读者线程的记录。独占一个缓存行，避免不同读者之间伪共享。
+  struct alignas(64) ThreadRecord {
+    std::atomic<uint64_t> epoch_{0};
+    // 只由所属线程访问的嵌套深度。
+    uint64_t nesting_{0};
+    // 线程退出后记录可被新线程复用。
+    bool in_use_{false};
+  };
+
+  // 线程局部的句柄：线程第一次进入读侧临界区时注册记录，线程退出时归还记录。
+  struct ThreadHandle {
+    RcuDomain *domain_{nullptr};
+    ThreadRecord *record_{nullptr};
+    ~ThreadHandle() {
+      if (record_ != nullptr) {
+        std::scoped_lock lk(domain_->registry_m_);
+        record_->in_use_ = false;
+      }
+    }
+  };
+
+  ThreadRecord *Self() {
+    thread_local ThreadHandle handle;
+    if (handle.record_ == nullptr) {
+      handle.domain_ = this;
+      handle.record_ = Register();
+    }
+    return handle.record_;
+  }
+
+  ThreadRecord *Register() {
+    std::scoped_lock lk(registry_m_);
+    for (auto &record : records_) {
+      if (!record->in_use_) {
+        record->in_use_ = true;
+        return record.get();
+      }
+    }
+    records_.push_back(std::make_unique<ThreadRecord>());
+    records_.back()->in_use_ = true;
+    return records_.back().get();
+  }
+
+  // 后台回收线程：每次取走一批回调，等待一个宽限期，然后执行它们。
+  // 一次宽限期服务一整批回调，分摊了 Synchronize 的开销。
+  void ReclaimerLoop() {
+    while (true) {
+      std::vector<std::function<void()>> batch;
+      {
+        std::unique_lock lk(callbacks_m_);
+        callbacks_cv_.wait(lk, [this] { return stop_ || !pending_.empty(); });
+        if (pending_.empty()) {
+          return;
+        }
+        batch.swap(pending_);
+      }
+      Synchronize();
+      for (auto &callback : batch) {
+        callback();
+      }
+      {
+        std::scoped_lock lk(callbacks_m_);
+        completed_ += batch.size();
+      }
+      completed_cv_.notify_all();
+    }
+  }
+
+  std::atomic<uint64_t> global_epoch_{1};
+
+  // 保护 records_。读者只在注册和线程退出时获取它，Synchronize 只在拷贝记录指针时短暂持有它。
+  std::mutex registry_m_;
+  std::vector<std::unique_ptr<ThreadRecord>> records_;
+
+  // 串行化多个同时调用 Synchronize 的写者。
+  std::mutex synchronize_m_;
+
+  std::mutex callbacks_m_;
+  std::condition_variable callbacks_cv_;
+  std::condition_variable completed_cv_;
+  std::vector<std::function<void()>> pending_;
+  uint64_t enqueued_{0};
+  uint64_t completed_{0};
+  bool stop_{false};
+
+  std::thread reclaimer_;
+};
+
+// 全局唯一的 RCU 域，第一次使用时构造。
+RcuDomain &GetRcuDomain() {
+  static RcuDomain domain;
+  return domain;
+}
+
+// 与 liburcu 命名一致的函数式接口。
+void rcu_read_lock() { GetRcuDomain().ReadLock(); }
+void rcu_read_unlock() { GetRcuDomain().ReadUnlock(); }
+void synchronize_rcu() { GetRcuDomain().Synchronize(); }
+void call_rcu(std::function<void()> callback) { GetRcuDomain().CallRcu(std::move(callback)); }
+void rcu_barrier() { GetRcuDomain().Barrier(); }
+
+// RAII 风格的读侧临界区，用法与 std::scoped_lock 类似（参见 scoped_lock.cpp）。
+class RcuReadGuard {
+ public:
+  RcuReadGuard() { rcu_read_lock(); }
+  ~RcuReadGuard() { rcu_read_unlock(); }
+  RcuReadGuard(const RcuReadGuard &) = delete;
+  RcuReadGuard &operator=(const RcuReadGuard &) = delete;
+};
+
+// RcuPtr 是受 RCU 保护的指针，它独占所指向的对象。
+// 读者在持有 RcuReadGuard 时调用 Load，得到的指针在守卫析构之前一直有效。
+// 写者通过 Update 发布一个新对象，旧对象在宽限期结束后被释放。
+template <typename T>
+class RcuPtr {
+ public:
+  explicit RcuPtr(std::unique_ptr<T> init) : ptr_(init.release()) {}
+
+  // 析构时没有读者了，可以直接释放。
+  ~RcuPtr() { delete ptr_.load(); }
+
+  RcuPtr(const RcuPtr &) = delete;
+  RcuPtr &operator=(const RcuPtr &) = delete;
+
+  // 必须在读侧临界区内调用。
+  const T *Load() const { return ptr_.load(std::memory_order_acquire); }
+
+  // 发布新对象，旧对象交给后台线程在宽限期后释放。写者不会阻塞。
+  void Update(std::unique_ptr<T> next) {
+    T *old = ptr_.exchange(next.release(), std::memory_order_acq_rel);
+    call_rcu([old] { delete old; });
+  }
+
+  // 发布新对象，并同步等待宽限期结束后再释放旧对象。
+  void UpdateSync(std::unique_ptr<T> next) {
+    T *old = ptr_.exchange(next.release(), std::memory_order_acq_rel);
+    synchronize_rcu();
+    delete old;
+  }
+
+ private:
+  std::atomic<T *> ptr_;
+};
+
+// 一个简化的“路由表”：写者整体替换，读者查询其中的条目。
+struct RoutingTable {
+  uint64_t version_;
+  std::vector<uint32_t> routes_;
+};
+
+std::unique_ptr<RoutingTable> MakeTable(uint64_t version, size_t size) {
+  auto table = std::make_unique<RoutingTable>();
+  table->version_ = version;
+  table->routes_.assign(size, static_cast<uint32_t>(version));
+  return table;
+}
+
+// 与 rwlock.cpp 相同的例子：读者在读侧临界区内读取 count，写者拷贝-修改-发布。
+// 两个写者之间仍需要互斥（RCU 只解决读者与写者之间的同步），这里用一个普通的 mutex。
+RcuPtr<int> count(std::make_unique<int>(0));
+std::mutex writer_m;
+
+void read_value() {
+  RcuReadGuard guard;
+  std::cout << "Reading value " + std::to_string(*count.Load()) + "\n" << std::flush;
+}
+
+void write_value() {
+  std::scoped_lock lk(writer_m);
+  int current;
+  {
+    RcuReadGuard guard;
+    current = *count.Load();
+  }
+  count.Update(std::make_unique<int>(current + 3));
+}
+
+// 保存读者读到的值，防止编译器把读操作优化掉。
+std::atomic<uint64_t> benchmark_sink{0};
+
+// 打印写者延迟的均值与 p99。
+void ReportLatencies(std::vector<double> &latencies) {
+  std::sort(latencies.begin(), latencies.end());
+  double sum = 0;
+  for (double latency : latencies) {
+    sum += latency;
+  }
+  std::cout << latencies.size() << " updates, update latency avg "
+            << (latencies.empty() ? 0 : sum / latencies.size() / 1000) << " us, p99 "
+            << (latencies.empty() ? 0 : latencies[latencies.size() * 99 / 100] / 1000) << " us\n";
+}
+
+// 基准的公共部分：readers 个读者线程反复调用 read_once，一个写者线程每隔 write_interval 调用一次 update_once。
+template <typename ReadFn, typename UpdateFn>
+void RunBench(const char *name, int readers, std::chrono::milliseconds duration,
+              std::chrono::microseconds write_interval, ReadFn read_once, UpdateFn update_once) {
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> read_ops{0};
+  std::vector<double> latencies;
+  std::vector<std::thread> threads;
+  for (int r = 0; r < readers; r++) {
+    threads.emplace_back([&, r] {
+      uint64_t ops = 0;
+      uint64_t sink = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        sink += read_once(ops + r);
+        ops += 1;
+      }
+      read_ops.fetch_add(ops);
+      benchmark_sink.fetch_add(sink, std::memory_order_relaxed);
+    });
+  }
+  threads.emplace_back([&] {
+    uint64_t version = 1;
+    while (!stop.load(std::memory_order_relaxed)) {
+      version += 1;
+      auto start = std::chrono::steady_clock::now();
+      update_once(version);
+      latencies.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+      std::this_thread::sleep_for(write_interval);
+    }
+  });
+  std::this_thread::sleep_for(duration);
+  stop.store(true);
+  for (auto &t : threads) {
+    t.join();
+  }
+  std::cout << name << ": " << read_ops.load() / std::chrono::duration<double>(duration).count() / 1e6
+            << " M reads/s, ";
+  ReportLatencies(latencies);
+}
+
+// 用法：./rcu [读者线程数] [每个配置运行的毫秒数]
+int main(int argc, char *argv[]) {
+  int readers = argc > 1 ? std::stoi(argv[1]) : 4;
+  std::chrono::milliseconds duration(argc > 2 ? std::stoi(argv[2]) : 300);
+  std::chrono::microseconds write_interval(100);
+  const size_t table_size = 1024;
+
+  // 第一部分：rwlock.cpp 的例子。
+  std::thread t1(read_value);
+  std::thread t2(write_value);
+  std::thread t3(read_value);
+  std::thread t4(read_value);
+  std::thread t5(write_value);
+  std::thread t6(read_value);
+  t1.join();
+  t2.join();
+  t3.join();
+  t4.join();
+  t5.join();
+  t6.join();
+  rcu_barrier();
+
+  // 第二部分：读侧开销与更新延迟。读者查询路由表中的一个条目，写者整体替换路由表。
+  // 对照组：读者持有 std::shared_lock，写者持有 std::unique_lock 替换表。
+  {
+    std::shared_mutex m;
+    std::unique_ptr<RoutingTable> table = MakeTable(1, table_size);
+    RunBench(
+        "std::shared_mutex     ", readers, duration, write_interval,
+        [&](uint64_t i) -> uint64_t {
+          std::shared_lock lk(m);
+          return table->routes_[i % table_size];
+        },
+        [&](uint64_t version) {
+          auto next = MakeTable(version, table_size);
+          std::unique_lock lk(m);
+          table.swap(next);
+        });
+  }
+
+  // RCU + call_rcu：写者发布后立即返回，释放由后台线程完成。
+  {
+    RcuPtr<RoutingTable> table(MakeTable(1, table_size));
+    RunBench(
+        "RCU (call_rcu)        ", readers, duration, write_interval,
+        [&](uint64_t i) -> uint64_t {
+          RcuReadGuard guard;
+          return table.Load()->routes_[i % table_size];
+        },
+        [&](uint64_t version) { table.Update(MakeTable(version, table_size)); });
+    rcu_barrier();
+  }
+
+  // RCU + synchronize_rcu：写者自己等待宽限期，延迟中包含了宽限期的时长。
+  {
+    RcuPtr<RoutingTable> table(MakeTable(1, table_size));
+    RunBench(
+        "RCU (synchronize_rcu) ", readers, duration, write_interval,
+        [&](uint64_t i) -> uint64_t {
+          RcuReadGuard guard;
+          return table.Load()->routes_[i % table_size];
+        },
+        [&](uint64_t version) { table.UpdateSync(MakeTable(version, table_size)); });
+  }
+  return 0;
+}
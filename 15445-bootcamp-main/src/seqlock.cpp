@@ -0,0 +1,282 @@
+/**
+ * @file seqlock.cpp
+ * @brief 顺序锁（sequence lock, seqlock）的教学示例：读者从不写共享内存。
+ */
+
+// rwlock.cpp 中的 count 是一个很小的值，读远多于写。用 std::shared_mutex 保护它时，
+// 每个读者都要修改锁内部的读者计数，读者之间互相争用同一个缓存行。
+
+// 顺序锁换了一种思路：读者不加锁，而是“乐观地”读取数据，然后检查读取期间是否有写者修改过数据，
+// 如果有就重试。具体做法是维护一个序列号 seq_：
+// 1. 写者开始写之前把 seq_ 加 1（变成奇数），写完之后再加 1（变回偶数）。
+// 2. 读者先读 seq_（如果是奇数说明有写者正在写，稍后重试），然后拷贝数据，最后再读一次 seq_。
+//    两次读到的值相同，说明拷贝期间没有写者介入，拷贝出的数据是一致的。
+// 读者只读共享内存，因此任意多个读者之间完全没有争用。代价是写者较多时读者可能反复重试，
+// 并且只能保护可以按字节拷贝（trivially copyable）的数据。
+
+// 一个细节：在 C++ 内存模型中，读者与写者并发地读写同一个普通变量属于数据竞争（未定义行为），
+// 即使读者之后会丢弃这次结果。因此这里把数据存放在一组 std::atomic<uint64_t> 字中，
+// 使用 relaxed 原子操作逐字读写，再用内存栅栏（fence）建立顺序。参见：
+// Hans-J. Boehm, "Can Seqlocks Get Along With Programming Language Memory Models?"
+// https://www.hpl.hp.com/techreports/2012/HPL-2012-68.pdf
+
+// 包含 std::sort（用于计算延迟分位数）。
+#include <algorithm>
+// 包含 std::array。
+#include <array>
+// 包含 std::atomic。
+#include <atomic>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 std::memcpy。
+#include <cstring>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 mutex 头文件。
+#include <mutex>
+// 包含 shared_mutex 头文件（用于对比基准）。
+#include <shared_mutex>
+// 包含 std::string 与 std::to_string。
+#include <string>
+// 包含 thread 头文件。
+#include <thread>
+// 包含 std::is_trivially_copyable。
+#include <type_traits>
+// 包含 std::vector。
+#include <vector>
+
+// SeqLock 保护一个类型为 T 的值。kMultiWriter 为 false 时只允许一个写者（由调用者保证），
+// 写操作只需两次普通的 store；为 true 时写者之间通过对 seq_ 做 CAS 来互斥。
+template <typename T, bool kMultiWriter = false>
+class SeqLock {
+  static_assert(std::is_trivially_copyable_v<T>, "SeqLock can only protect trivially copyable types");
+
+ public:
+  SeqLock() : SeqLock(T{}) {}
+  explicit SeqLock(const T &value) { StoreWords(value); }
+
+  SeqLock(const SeqLock &) = delete;
+  SeqLock &operator=(const SeqLock &) = delete;
+
+  // 乐观读：反复尝试，直到读到一个一致的快照。
+  T Load() const {
+    T value;
+    while (!TryLoad(&value)) {
+    }
+    return value;
+  }
+
+  // 只尝试一次乐观读。成功时返回 true 并写入 *out，失败说明读取期间有写者介入。
+  bool TryLoad(T *out) const {
+    uint64_t before = seq_.load(std::memory_order_acquire);
+    if (before & 1) {
+      return false;
+    }
+    std::array<uint64_t, kNumWords> buf;
+    for (size_t i = 0; i < kNumWords; i++) {
+      buf[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    // acquire 栅栏保证上面对数据的读取不会被重排到下面对 seq_ 的第二次读取之后。
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq_.load(std::memory_order_relaxed) != before) {
+      return false;
+    }
+    std::memcpy(out, buf.data(), sizeof(T));
+    return true;
+  }
+
+  // 写入一个新值。
+  void Store(const T &value) {
+    BeginWrite();
+    StoreWords(value);
+    EndWrite();
+  }
+
+  // 读-改-写：在写者临界区内读取当前值，交给 fn 修改后写回。
+  // 对多写者版本而言，这保证了并发的 Update 不会互相覆盖。
+  template <typename Fn>
+  void Update(Fn &&fn) {
+    BeginWrite();
+    T value = LoadWordsAsWriter();
+    fn(value);
+    StoreWords(value);
+    EndWrite();
+  }
+
+  // 当前序列号，可以用来观察发生了多少次写入（每次写入加 2）。
+  uint64_t Sequence() const { return seq_.load(std::memory_order_relaxed); }
+
+ private:
+  static constexpr size_t kNumWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  void BeginWrite() {
+    if constexpr (kMultiWriter) {
+      // 多写者：把 seq_ 从偶数 CAS 为奇数即获得了写权限，其他写者看到奇数会自旋等待。
+      uint64_t seq = seq_.load(std::memory_order_relaxed);
+      while (true) {
+        if ((seq & 1) == 0 &&
+            seq_.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+          break;
+        }
+        std::this_thread::yield();
+        seq = seq_.load(std::memory_order_relaxed);
+      }
+    } else {
+      seq_.store(seq_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    // release 栅栏保证 seq_ 变为奇数先于之后对数据的写入被其他线程看到。
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+
+  void EndWrite() { seq_.store(seq_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  void StoreWords(const T &value) {
+    std::array<uint64_t, kNumWords> buf{};
+    std::memcpy(buf.data(), &value, sizeof(T));
+    for (size_t i = 0; i < kNumWords; i++) {
+      words_[i].store(buf[i], std::memory_order_relaxed);
+    }
+  }
+
+  // 只有持有写权限的线程才能调用：此时没有其他写者，数据不会变化。
+  T LoadWordsAsWriter() const {
+    std::array<uint64_t, kNumWords> buf;
+    for (size_t i = 0; i < kNumWords; i++) {
+      buf[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    T value;
+    std::memcpy(&value, buf.data(), sizeof(T));
+    return value;
+  }
+
+  std::atomic<uint64_t> seq_{0};
+  std::array<std::atomic<uint64_t>, kNumWords> words_;
+};
+
+// 多写者版本的别名。
+template <typename T>
+using MultiWriterSeqLock = SeqLock<T, true>;
+
+// 与 rwlock.cpp 相同的例子。这里有两个写者线程，所以使用多写者版本。
+MultiWriterSeqLock<int> count;
+
+void read_value() { std::cout << "Reading value " + std::to_string(count.Load()) + "\n" << std::flush; }
+
+void write_value() {
+  count.Update([](int &value) { value += 3; });
+}
+
+// 基准使用的数据：四个字段在每次写入时保持相等，读者据此检查是否读到了“撕裂”的数据。
+struct Quad {
+  uint64_t a_;
+  uint64_t b_;
+  uint64_t c_;
+  uint64_t d_;
+};
+
+// 用 std::shared_mutex 保护 Quad 的对照实现，接口与 SeqLock 相同。
+class SharedMutexQuad {
+ public:
+  Quad Load() const {
+    std::shared_lock lk(m_);
+    return value_;
+  }
+  void Store(const Quad &value) {
+    std::unique_lock lk(m_);
+    value_ = value;
+  }
+
+ private:
+  mutable std::shared_mutex m_;
+  Quad value_{};
+};
+
+// 基准：readers 个读者线程持续读取，writers 个写者线程每隔 write_interval 写入一次。
+// 报告读者吞吐、写者单次写入延迟（均值与 p99）以及读者检测到的不一致次数（应当为 0）。
+template <typename Protected>
+void RunBench(const char *name, int readers, int writers, std::chrono::microseconds write_interval,
+              std::chrono::milliseconds duration) {
+  Protected shared;
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> read_ops{0};
+  std::atomic<uint64_t> torn_reads{0};
+  std::vector<std::vector<double>> write_latencies(writers);
+  std::vector<std::thread> threads;
+
+  for (int r = 0; r < readers; r++) {
+    threads.emplace_back([&] {
+      uint64_t ops = 0;
+      uint64_t torn = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        Quad q = shared.Load();
+        torn += (q.a_ != q.b_ || q.b_ != q.c_ || q.c_ != q.d_) ? 1 : 0;
+        ops += 1;
+      }
+      read_ops.fetch_add(ops);
+      torn_reads.fetch_add(torn);
+    });
+  }
+  for (int w = 0; w < writers; w++) {
+    threads.emplace_back([&, w] {
+      uint64_t i = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        i += 1;
+        auto start = std::chrono::steady_clock::now();
+        shared.Store(Quad{i, i, i, i});
+        write_latencies[w].push_back(
+            std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+        std::this_thread::sleep_for(write_interval);
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(duration);
+  stop.store(true);
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  std::vector<double> all;
+  for (auto &latencies : write_latencies) {
+    all.insert(all.end(), latencies.begin(), latencies.end());
+  }
+  std::sort(all.begin(), all.end());
+  double sum = 0;
+  for (double latency : all) {
+    sum += latency;
+  }
+  double seconds = std::chrono::duration<double>(duration).count();
+  std::cout << name << ": " << read_ops.load() / seconds / 1e6 << " M reads/s, " << all.size() << " writes, "
+            << "write latency avg " << (all.empty() ? 0 : sum / all.size()) << " ns, p99 "
+            << (all.empty() ? 0 : all[all.size() * 99 / 100]) << " ns, torn reads " << torn_reads.load() << "\n";
+}
+
+// 用法：./seqlock [读者线程数] [每个配置运行的毫秒数]
+int main(int argc, char *argv[]) {
+  int readers = argc > 1 ? std::stoi(argv[1]) : 4;
+  std::chrono::milliseconds duration(argc > 2 ? std::stoi(argv[2]) : 300);
+  std::chrono::microseconds write_interval(10);
+
+  // 第一部分：rwlock.cpp 的例子，用 seqlock 代替读写锁。
+  std::thread t1(read_value);
+  std::thread t2(write_value);
+  std::thread t3(read_value);
+  std::thread t4(read_value);
+  std::thread t5(write_value);
+  std::thread t6(read_value);
+  t1.join();
+  t2.join();
+  t3.join();
+  t4.join();
+  t5.join();
+  t6.join();
+
+  // 第二部分：单写者与多写者下，seqlock 与 std::shared_mutex 的读者吞吐和写者延迟对比。
+  std::cout << readers << " readers, 1 writer\n";
+  RunBench<SharedMutexQuad>("  std::shared_mutex ", readers, 1, write_interval, duration);
+  RunBench<SeqLock<Quad>>("  SeqLock           ", readers, 1, write_interval, duration);
+  std::cout << readers << " readers, 2 writers\n";
+  RunBench<SharedMutexQuad>("  std::shared_mutex ", readers, 2, write_interval, duration);
+  RunBench<MultiWriterSeqLock<Quad>>("  MultiWriterSeqLock", readers, 2, write_interval, duration);
+  return 0;
+}
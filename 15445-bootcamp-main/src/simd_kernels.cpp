@@ -0,0 +1,437 @@
+/**
+ * @file simd_kernels.cpp
+ * @brief 在 std::span 上按元素运算的向量化模板函数，运行时根据 CPUID 选择 SSE2/AVX2/AVX-512 实现。
+ */
+
+// templated_functions.cpp 中的 add<T> 只能把两个标量相加。数据库执行引擎常常要对整列数据做同样的运算，
+// 这时最好一次处理一个 SIMD 寄存器宽度的数据：SSE2 一次 16 字节，AVX2 一次 32 字节，AVX-512 一次 64 字节。
+
+// 但是程序编译一次后可能运行在不同的机器上，不能假设所有机器都支持 AVX-512。常见做法是：
+// 1. 为每个指令集（ISA）分别编译一份内核。在 GCC/Clang 中可以用 __attribute__((target("avx2")))
+//    让单个函数使用某个指令集，而不必改变整个文件的编译选项。
+// 2. 程序启动时通过 CPUID（__builtin_cpu_supports）检测 CPU 支持哪些指令集，
+//    选出最好的一组内核，保存在函数指针表中。之后每次调用只需一次间接跳转。
+
+// 为了不为每个指令集手写一遍 intrinsics，这里使用 GCC/Clang 的向量扩展（vector extensions）：
+// typedef T Vec __attribute__((vector_size(N))) 声明一个 N 字节的向量类型，可以直接用 + - * 运算。
+// 通用的内核模板用 always_inline 标记，被内联进带 target 属性的入口函数后，
+// 编译器就会用对应指令集生成代码。
+// 参考：https://gcc.gnu.org/onlinedocs/gcc/Vector-Extensions.html
+//       https://gcc.gnu.org/onlinedocs/gcc/x86-Built-in-Functions.html（__builtin_cpu_supports）
+
+// 本文件使用 std::span，需要 C++20，CMakeLists.txt 只为该目标单独开启了 C++20。
+
+// 包含 std::max。
+#include <algorithm>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 std::abs。
+#include <cmath>
+// 包含 std::int32_t 与 std::int64_t。
+#include <cstdint>
+// 包含 std::memcpy。
+#include <cstring>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::invalid_argument。
+#include <stdexcept>
+// 包含 std::span。
+#include <span>
+// 包含 std::string（用于解析命令行参数）。
+#include <string>
+// 包含 std::is_same_v 等类型萃取。
+#include <type_traits>
+// 包含 std::vector。
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BOOTCAMP_X86 1
+#endif
+
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
+// 支持的指令集等级，按从弱到强排列。
+enum class Isa { kScalar, kSse2, kAvx2, kAvx512 };
+
+const char *IsaName(Isa isa) {
+  switch (isa) {
+    case Isa::kScalar:
+      return "scalar";
+    case Isa::kSse2:
+      return "sse2";
+    case Isa::kAvx2:
+      return "avx2";
+    case Isa::kAvx512:
+      return "avx512";
+  }
+  return "unknown";
+}
+
+// 通过 CPUID 检测当前 CPU 支持的最强指令集。
+// AVX-512 内核对 int64 乘法使用 vpmullq，它属于 AVX-512DQ，所以同时检查 avx512f 与 avx512dq。
+Isa DetectIsa() {
+#ifdef BOOTCAMP_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq")) {
+    return Isa::kAvx512;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return Isa::kAvx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return Isa::kSse2;
+  }
+#endif
+  return Isa::kScalar;
+}
+
+// 只为这四种元素类型提供内核。
+template <typename T>
+concept KernelElement = std::is_same_v<T, std::int32_t> || std::is_same_v<T, std::int64_t> ||
+                        std::is_same_v<T, float> || std::is_same_v<T, double>;
+
+enum class BinaryOp { kAdd, kSub, kMul };
+
+// 对标量或向量执行一次二元运算。参数用引用传递，这样向量类型不会出现在函数的调用约定中。
+template <BinaryOp kOp, typename V>
+ALWAYS_INLINE void Apply(const V &a, const V &b, V *out) {
+  if constexpr (kOp == BinaryOp::kAdd) {
+    *out = a + b;
+  } else if constexpr (kOp == BinaryOp::kSub) {
+    *out = a - b;
+  } else {
+    *out = a * b;
+  }
+}
+
+// 标量实现，同时也是向量实现处理尾部元素的方式。
+template <typename T>
+struct ScalarKernels {
+  template <BinaryOp kOp>
+  static void Binary(const T *a, const T *b, T *out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      Apply<kOp>(a[i], b[i], &out[i]);
+    }
+  }
+
+  static void Fma(const T *a, const T *b, const T *c, T *out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = a[i] * b[i] + c[i];
+    }
+  }
+
+  static T Sum(const T *a, size_t n) {
+    T sum = 0;
+    for (size_t i = 0; i < n; i++) {
+      sum += a[i];
+    }
+    return sum;
+  }
+};
+
+// 通用的向量内核：kVecBytes 是一个向量寄存器的字节数。
+// 所有函数都是 always_inline，实际的指令集由调用它们的、带 target 属性的入口函数决定。
+// 向量只作为局部变量使用，从不按值传入或返回，以免触发与调用约定（ABI）相关的问题。
+template <typename T, size_t kVecBytes>
+struct VectorKernels {
+  typedef T Vec __attribute__((vector_size(kVecBytes)));
+  static constexpr size_t kLanes = kVecBytes / sizeof(T);
+
+  template <BinaryOp kOp>
+  ALWAYS_INLINE static void Binary(const T *a, const T *b, T *out, size_t n) {
+    size_t i = 0;
+    for (; i + kLanes <= n; i += kLanes) {
+      Vec va;
+      Vec vb;
+      // memcpy 是进行非对齐向量加载/存储的可移植写法，编译器会把它变成一条向量指令。
+      std::memcpy(&va, a + i, sizeof(Vec));
+      std::memcpy(&vb, b + i, sizeof(Vec));
+      Vec vr;
+      Apply<kOp>(va, vb, &vr);
+      std::memcpy(out + i, &vr, sizeof(Vec));
+    }
+    ScalarKernels<T>::template Binary<kOp>(a + i, b + i, out + i, n - i);
+  }
+
+  // 对浮点数，启用 fma 指令集后编译器会把 a * b + c 合并为一条融合乘加指令
+  // （GCC 在 GNU 方言下默认允许这种合并），因此不同指令集的结果在最后一位上可能略有差异。
+  ALWAYS_INLINE static void Fma(const T *a, const T *b, const T *c, T *out, size_t n) {
+    size_t i = 0;
+    for (; i + kLanes <= n; i += kLanes) {
+      Vec va;
+      Vec vb;
+      Vec vc;
+      std::memcpy(&va, a + i, sizeof(Vec));
+      std::memcpy(&vb, b + i, sizeof(Vec));
+      std::memcpy(&vc, c + i, sizeof(Vec));
+      Vec vr = va * vb + vc;
+      std::memcpy(out + i, &vr, sizeof(Vec));
+    }
+    ScalarKernels<T>::Fma(a + i, b + i, c + i, out + i, n - i);
+  }
+
+  // 使用四个独立的累加器，打破加法之间的依赖链，让多条向量加法可以流水执行。
+  // 注意这改变了浮点加法的结合顺序，结果与逐个相加可能有微小差异。
+  ALWAYS_INLINE static T Sum(const T *a, size_t n) {
+    Vec acc0 = {};
+    Vec acc1 = {};
+    Vec acc2 = {};
+    Vec acc3 = {};
+    size_t i = 0;
+    for (; i + 4 * kLanes <= n; i += 4 * kLanes) {
+      Vec v0;
+      Vec v1;
+      Vec v2;
+      Vec v3;
+      std::memcpy(&v0, a + i, sizeof(Vec));
+      std::memcpy(&v1, a + i + kLanes, sizeof(Vec));
+      std::memcpy(&v2, a + i + 2 * kLanes, sizeof(Vec));
+      std::memcpy(&v3, a + i + 3 * kLanes, sizeof(Vec));
+      acc0 += v0;
+      acc1 += v1;
+      acc2 += v2;
+      acc3 += v3;
+    }
+    Vec acc = (acc0 + acc1) + (acc2 + acc3);
+    T sum = 0;
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      sum += acc[lane];
+    }
+    return sum + ScalarKernels<T>::Sum(a + i, n - i);
+  }
+};
+
+// 一组内核的函数指针表。每种元素类型、每个指令集各有一张表。
+template <typename T>
+struct KernelTable {
+  void (*add_)(const T *, const T *, T *, size_t);
+  void (*sub_)(const T *, const T *, T *, size_t);
+  void (*mul_)(const T *, const T *, T *, size_t);
+  void (*fma_)(const T *, const T *, const T *, T *, size_t);
+  T (*sum_)(const T *, size_t);
+};
+
+// 为一个指令集生成入口函数。每个入口函数都带有 target 属性，
+// 内联进来的 VectorKernels 因此使用该指令集编译。
+#define DEFINE_ISA_KERNELS(NAME, TARGET, VEC_BYTES)                                              \
+  template <typename T, BinaryOp kOp>                                                            \
+  __attribute__((target(TARGET))) void NAME##Binary(const T *a, const T *b, T *out, size_t n) { \
+    VectorKernels<T, VEC_BYTES>::template Binary<kOp>(a, b, out, n);                             \
+  }                                                                                              \
+  template <typename T>                                                                          \
+  __attribute__((target(TARGET))) void NAME##Fma(const T *a, const T *b, const T *c, T *out,    \
+                                                 size_t n) {                                     \
+    VectorKernels<T, VEC_BYTES>::Fma(a, b, c, out, n);                                           \
+  }                                                                                              \
+  template <typename T>                                                                          \
+  __attribute__((target(TARGET))) T NAME##Sum(const T *a, size_t n) {                            \
+    return VectorKernels<T, VEC_BYTES>::Sum(a, n);                                               \
+  }                                                                                              \
+  template <typename T>                                                                          \
+  constexpr KernelTable<T> NAME##Table() {                                                       \
+    return {NAME##Binary<T, BinaryOp::kAdd>, NAME##Binary<T, BinaryOp::kSub>,                    \
+            NAME##Binary<T, BinaryOp::kMul>, NAME##Fma<T>, NAME##Sum<T>};                         \
+  }
+
+#ifdef BOOTCAMP_X86
+DEFINE_ISA_KERNELS(Sse2, "sse2", 16)
+DEFINE_ISA_KERNELS(Avx2, "avx2,fma", 32)
+DEFINE_ISA_KERNELS(Avx512, "avx512f,avx512dq", 64)
+#endif
+
+template <typename T>
+constexpr KernelTable<T> ScalarTable() {
+  return {ScalarKernels<T>::template Binary<BinaryOp::kAdd>, ScalarKernels<T>::template Binary<BinaryOp::kSub>,
+          ScalarKernels<T>::template Binary<BinaryOp::kMul>, ScalarKernels<T>::Fma, ScalarKernels<T>::Sum};
+}
+
+// 返回指定指令集的内核表。如果该平台没有编译这个指令集，退回标量实现。
+template <KernelElement T>
+KernelTable<T> KernelsFor(Isa isa) {
+#ifdef BOOTCAMP_X86
+  switch (isa) {
+    case Isa::kAvx512:
+      return Avx512Table<T>();
+    case Isa::kAvx2:
+      return Avx2Table<T>();
+    case Isa::kSse2:
+      return Sse2Table<T>();
+    case Isa::kScalar:
+      break;
+  }
+#endif
+  return ScalarTable<T>();
+}
+
+// 当前 CPU 上最好的一组内核。函数内的静态变量只在第一次调用时初始化（线程安全），
+// 之后的调用不再检测 CPUID。
+template <KernelElement T>
+const KernelTable<T> &ActiveKernels() {
+  static const KernelTable<T> table = KernelsFor<T>(DetectIsa());
+  return table;
+}
+
+void CheckSizes(size_t a, size_t b, size_t out) {
+  if (a != b || a != out) {
+    throw std::invalid_argument("span sizes do not match");
+  }
+}
+
+void CheckSizes(size_t a, size_t b, size_t c, size_t out) {
+  if (a != b || a != c || a != out) {
+    throw std::invalid_argument("span sizes do not match");
+  }
+}
+
+// 以下是对外的 span 接口，对应 templated_functions.cpp 中 add<T> 的数组版本。
+// out 可以与输入指向同一块内存（原地运算），但不能与输入部分重叠。
+template <KernelElement T>
+void add(std::span<const T> a, std::span<const T> b, std::span<T> out) {
+  CheckSizes(a.size(), b.size(), out.size());
+  ActiveKernels<T>().add_(a.data(), b.data(), out.data(), out.size());
+}
+
+template <KernelElement T>
+void sub(std::span<const T> a, std::span<const T> b, std::span<T> out) {
+  CheckSizes(a.size(), b.size(), out.size());
+  ActiveKernels<T>().sub_(a.data(), b.data(), out.data(), out.size());
+}
+
+template <KernelElement T>
+void mul(std::span<const T> a, std::span<const T> b, std::span<T> out) {
+  CheckSizes(a.size(), b.size(), out.size());
+  ActiveKernels<T>().mul_(a.data(), b.data(), out.data(), out.size());
+}
+
+// out[i] = a[i] * b[i] + c[i]。
+template <KernelElement T>
+void fma(std::span<const T> a, std::span<const T> b, std::span<const T> c, std::span<T> out) {
+  CheckSizes(a.size(), b.size(), c.size(), out.size());
+  ActiveKernels<T>().fma_(a.data(), b.data(), c.data(), out.data(), out.size());
+}
+
+template <KernelElement T>
+T sum(std::span<const T> a) {
+  return ActiveKernels<T>().sum_(a.data(), a.size());
+}
+
+// 检查某个指令集的内核与标量内核的结果是否一致。整数必须完全相同，浮点数允许微小的相对误差。
+template <typename T>
+bool Close(T expected, T actual) {
+  if constexpr (std::is_integral_v<T>) {
+    return expected == actual;
+  } else {
+    return std::abs(expected - actual) <= 1e-4 * std::max<T>(1, std::abs(expected));
+  }
+}
+
+template <KernelElement T>
+bool VerifyIsa(Isa isa) {
+  // 长度取一个不是任何向量宽度倍数的值，这样尾部处理也会被检查到。
+  const size_t n = 1003;
+  std::vector<T> a(n);
+  std::vector<T> b(n);
+  std::vector<T> c(n);
+  for (size_t i = 0; i < n; i++) {
+    a[i] = static_cast<T>(i % 97) - 40;
+    b[i] = static_cast<T>(i % 13) + 1;
+    c[i] = static_cast<T>(i % 7);
+  }
+  KernelTable<T> scalar = ScalarTable<T>();
+  KernelTable<T> table = KernelsFor<T>(isa);
+  std::vector<T> expected(n);
+  std::vector<T> actual(n);
+  auto compare = [&] {
+    for (size_t i = 0; i < n; i++) {
+      if (!Close(expected[i], actual[i])) {
+        return false;
+      }
+    }
+    return true;
+  };
+  bool ok = true;
+  for (auto [ref, impl] : {std::pair{scalar.add_, table.add_}, {scalar.sub_, table.sub_}, {scalar.mul_, table.mul_}}) {
+    ref(a.data(), b.data(), expected.data(), n);
+    impl(a.data(), b.data(), actual.data(), n);
+    ok = ok && compare();
+  }
+  scalar.fma_(a.data(), b.data(), c.data(), expected.data(), n);
+  table.fma_(a.data(), b.data(), c.data(), actual.data(), n);
+  ok = ok && compare();
+  return ok && Close(scalar.sum_(a.data(), n), table.sum_(a.data(), n));
+}
+
+// 测量一组内核在 n 个元素上的 add 与 sum 带宽（GB/s）。
+// add 每个元素读两个、写一个；sum 每个元素读一个。
+template <KernelElement T>
+void BenchIsa(Isa isa, size_t n) {
+  KernelTable<T> table = KernelsFor<T>(isa);
+  std::vector<T> a(n, 1);
+  std::vector<T> b(n, 2);
+  std::vector<T> out(n);
+  // 重复执行直到总共处理约 5000 万个元素，使小数组的计时也足够稳定。
+  size_t reps = std::max<size_t>(1, 50'000'000 / n);
+
+  auto start = std::chrono::steady_clock::now();
+  for (size_t r = 0; r < reps; r++) {
+    table.add_(a.data(), b.data(), out.data(), n);
+  }
+  double add_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  volatile T sink = 0;
+  start = std::chrono::steady_clock::now();
+  for (size_t r = 0; r < reps; r++) {
+    sink = sink + table.sum_(a.data(), n);
+  }
+  double sum_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  double add_gbps = 3.0 * sizeof(T) * n * reps / add_s / 1e9;
+  double sum_gbps = 1.0 * sizeof(T) * n * reps / sum_s / 1e9;
+  std::cout << "    " << IsaName(isa) << "\tn=" << n << "\tadd " << add_gbps << " GB/s\tsum " << sum_gbps << " GB/s\n";
+}
+
+template <KernelElement T>
+void BenchType(const char *type_name, Isa best, const std::vector<size_t> &sizes) {
+  std::cout << type_name << ":\n";
+  for (Isa isa : {Isa::kScalar, Isa::kSse2, Isa::kAvx2, Isa::kAvx512}) {
+    if (isa > best) {
+      break;
+    }
+    if (!VerifyIsa<T>(isa)) {
+      std::cout << "    " << IsaName(isa) << " kernels disagree with the scalar kernels!\n";
+      continue;
+    }
+    for (size_t n : sizes) {
+      BenchIsa<T>(isa, n);
+    }
+  }
+}
+
+// 用法：./simd_kernels [最大数组长度]
+int main(int argc, char *argv[]) {
+  size_t max_size = argc > 1 ? std::stoul(argv[1]) : (1 << 22);
+
+  // 第一部分：像调用 add<T> 一样调用 span 版本。std::vector 可以隐式转换为 std::span。
+  std::vector<float> a = {1.5f, 2.5f, 3.5f, 4.5f, 5.5f};
+  std::vector<float> b = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f};
+  std::vector<float> out(a.size());
+  add<float>(a, b, out);
+  std::cout << "Printing add<float>(a, b): ";
+  for (float v : out) {
+    std::cout << v << " ";
+  }
+  std::cout << "\nPrinting sum<float>(a): " << sum<float>(a) << std::endl;
+
+  // 第二部分：按指令集与数组大小测量带宽。数组大小从能放进 L1 缓存到远大于 LLC。
+  Isa best = DetectIsa();
+  std::cout << "Best supported ISA: " << IsaName(best) << "\n";
+  std::vector<size_t> sizes;
+  for (size_t n = 1 << 10; n <= max_size; n <<= 4) {
+    sizes.push_back(n);
+  }
+  BenchType<std::int32_t>("int32", best, sizes);
+  BenchType<std::int64_t>("int64", best, sizes);
+  BenchType<float>("float", best, sizes);
+  BenchType<double>("double", best, sizes);
+  return 0;
+}
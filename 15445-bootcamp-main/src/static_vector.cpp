@@ -0,0 +1,396 @@
+/**
+ * @file static_vector.cpp
+ * @brief 以非类型模板参数指定容量的定长容器 static_vector<T, N> 与 ring_buffer<T, N> 的教学示例。
+ */
+
+// templated_classes.cpp 中的 Bar<int T> 只是把非类型模板参数打印出来。非类型模板参数的一个典型用途
+// 是把容器的容量固定在类型里：std::array<T, N> 就是这样做的，但它的大小也是固定的。
+// 在数据库的热路径上（例如一个 B+ 树节点中的键、一个批次中的行号、线程间传递任务的队列），
+// 元素个数有一个已知的上限，但实际个数是变化的。如果用 std::vector 或 std::deque，每次增长都可能
+// 调用内存分配器，分配器可能加锁，而且数据不和所属对象放在一起。
+
+// 本文件提供两个从不分配堆内存的容器：
+// 1. static_vector<T, N>：元素直接存放在对象内部，最多 N 个，接口类似 std::vector
+//    （C++26 的 std::inplace_vector 与之类似）。
+// 2. ring_buffer<T, N>：固定容量的先进先出环形队列。头尾使用只增不减的计数器，
+//    槽位下标是计数器对 N 取模；当 N 是 2 的幂时，取模在编译期就被换成按位与（index & (N - 1)）。
+// 对于平凡类型（如 int、指针），所有操作都是 constexpr 的，可以在编译期使用（析构函数是 constexpr 的，需要 C++20）。
+// 对于非平凡类型（如 std::string），元素在对齐的原始字节中按需构造和析构。
+
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 std::uint32_t 等定宽整数类型。
+#include <cstdint>
+// 包含 std::deque（对比基准）。
+#include <deque>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::unique_ptr（演示只能移动的元素类型）。
+#include <memory>
+// 包含 placement new 与 std::launder。
+#include <new>
+// 包含 std::length_error。
+#include <stdexcept>
+// 包含 std::string（演示非平凡元素类型，以及解析命令行参数）。
+#include <string>
+// 包含 std::is_trivially_default_constructible_v 等类型萃取。
+#include <type_traits>
+// 包含 std::move 与 std::forward。
+#include <utility>
+// 包含 std::vector（对比基准）。
+#include <vector>
+
+// 内联存储的两种实现，由元素类型是否平凡决定。
+// 平凡类型：直接用一个 T 数组保存，构造就是赋值，析构什么都不做。这样所有操作都可以在常量表达式中求值。
+template <typename T, size_t N, bool kTrivial =
+                                    std::is_trivially_default_constructible_v<T> && std::is_trivially_destructible_v<T>>
+class InlineStorage {
+ public:
+  constexpr T *Ptr(size_t i) { return &data_[i]; }
+  constexpr const T *Ptr(size_t i) const { return &data_[i]; }
+
+  template <typename... Args>
+  constexpr void Construct(size_t i, Args &&...args) {
+    data_[i] = T(std::forward<Args>(args)...);
+  }
+
+  constexpr void Destroy(size_t) {}
+
+ private:
+  T data_[N] = {};
+};
+
+// 非平凡类型：保存对齐的原始字节，用 placement new 构造元素，显式调用析构函数销毁元素。
+// 这样未使用的槽位不会被默认构造，T 也不需要有默认构造函数。
+template <typename T, size_t N>
+class InlineStorage<T, N, false> {
+ public:
+  T *Ptr(size_t i) { return std::launder(reinterpret_cast<T *>(bytes_ + i * sizeof(T))); }
+  const T *Ptr(size_t i) const { return std::launder(reinterpret_cast<const T *>(bytes_ + i * sizeof(T))); }
+
+  template <typename... Args>
+  void Construct(size_t i, Args &&...args) {
+    new (bytes_ + i * sizeof(T)) T(std::forward<Args>(args)...);
+  }
+
+  void Destroy(size_t i) { Ptr(i)->~T(); }
+
+ private:
+  alignas(T) unsigned char bytes_[N * sizeof(T)];
+};
+
+// 最多保存 N 个元素的向量，元素存放在对象内部。
+// 与 std::vector 一样，push_back 在容量不足时报告错误（这里抛出 std::length_error），
+// 热路径上可以改用 try_push_back，它在容器已满时返回 false。
+template <typename T, size_t N>
+class static_vector {
+ public:
+  constexpr static_vector() = default;
+
+  constexpr static_vector(const static_vector &other) {
+    for (size_t i = 0; i < other.size_; i++) {
+      storage_.Construct(i, other[i]);
+    }
+    size_ = other.size_;
+  }
+
+  constexpr static_vector &operator=(const static_vector &other) {
+    if (this != &other) {
+      clear();
+      for (size_t i = 0; i < other.size_; i++) {
+        storage_.Construct(i, other[i]);
+      }
+      size_ = other.size_;
+    }
+    return *this;
+  }
+
+  // 移动时逐个移动构造元素（std::string 不会深拷贝，std::unique_ptr 这样只能移动的类型也可以移动），
+  // 然后清空源容器，使它处于有效的空状态。
+  constexpr static_vector(static_vector &&other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    for (size_t i = 0; i < other.size_; i++) {
+      storage_.Construct(i, std::move(other[i]));
+    }
+    size_ = other.size_;
+    other.clear();
+  }
+
+  constexpr static_vector &operator=(static_vector &&other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    if (this != &other) {
+      clear();
+      for (size_t i = 0; i < other.size_; i++) {
+        storage_.Construct(i, std::move(other[i]));
+      }
+      size_ = other.size_;
+      other.clear();
+    }
+    return *this;
+  }
+
+  constexpr ~static_vector() { clear(); }
+
+  template <typename... Args>
+  constexpr bool try_emplace_back(Args &&...args) {
+    if (size_ == N) {
+      return false;
+    }
+    storage_.Construct(size_, std::forward<Args>(args)...);
+    size_ += 1;
+    return true;
+  }
+
+  constexpr bool try_push_back(const T &value) { return try_emplace_back(value); }
+
+  constexpr void push_back(const T &value) {
+    if (!try_emplace_back(value)) {
+      throw std::length_error("static_vector is full");
+    }
+  }
+
+  constexpr void push_back(T &&value) {
+    if (!try_emplace_back(std::move(value))) {
+      throw std::length_error("static_vector is full");
+    }
+  }
+
+  // 与 std::vector 相同，对空容器调用 pop_back 是未定义行为。
+  constexpr void pop_back() {
+    size_ -= 1;
+    storage_.Destroy(size_);
+  }
+
+  constexpr void clear() {
+    while (size_ > 0) {
+      pop_back();
+    }
+  }
+
+  constexpr T &operator[](size_t i) { return *storage_.Ptr(i); }
+  constexpr const T &operator[](size_t i) const { return *storage_.Ptr(i); }
+  constexpr T &back() { return *storage_.Ptr(size_ - 1); }
+
+  constexpr T *begin() { return storage_.Ptr(0); }
+  constexpr T *end() { return storage_.Ptr(0) + size_; }
+  constexpr const T *begin() const { return storage_.Ptr(0); }
+  constexpr const T *end() const { return storage_.Ptr(0) + size_; }
+
+  constexpr size_t size() const { return size_; }
+  constexpr bool empty() const { return size_ == 0; }
+  constexpr bool full() const { return size_ == N; }
+  static constexpr size_t capacity() { return N; }
+
+ private:
+  InlineStorage<T, N> storage_;
+  size_t size_{0};
+};
+
+// 容量为 N 的先进先出环形队列。head_ 与 tail_ 是只增不减的计数器（64 位，不会回绕），
+// 元素个数就是 tail_ - head_，不需要额外的“满/空”标记。
+template <typename T, size_t N>
+class ring_buffer {
+  static_assert(N > 0, "ring_buffer needs a non-zero capacity");
+
+ public:
+  constexpr ring_buffer() = default;
+  ring_buffer(const ring_buffer &) = delete;
+  ring_buffer &operator=(const ring_buffer &) = delete;
+  constexpr ~ring_buffer() { clear(); }
+
+  template <typename... Args>
+  constexpr bool try_emplace_back(Args &&...args) {
+    if (full()) {
+      return false;
+    }
+    storage_.Construct(Slot(tail_), std::forward<Args>(args)...);
+    tail_ += 1;
+    return true;
+  }
+
+  constexpr bool try_push_back(const T &value) { return try_emplace_back(value); }
+
+  constexpr void push_back(const T &value) {
+    if (!try_emplace_back(value)) {
+      throw std::length_error("ring_buffer is full");
+    }
+  }
+
+  // 与 std::deque 相同，对空队列调用 front/pop_front 是未定义行为。
+  constexpr T &front() { return *storage_.Ptr(Slot(head_)); }
+  constexpr T &back() { return *storage_.Ptr(Slot(tail_ - 1)); }
+
+  constexpr void pop_front() {
+    storage_.Destroy(Slot(head_));
+    head_ += 1;
+  }
+
+  // 第 i 个元素（从队头开始计数）。
+  constexpr T &operator[](size_t i) { return *storage_.Ptr(Slot(head_ + i)); }
+
+  constexpr void clear() {
+    while (!empty()) {
+      pop_front();
+    }
+  }
+
+  constexpr size_t size() const { return tail_ - head_; }
+  constexpr bool empty() const { return head_ == tail_; }
+  constexpr bool full() const { return size() == N; }
+  static constexpr size_t capacity() { return N; }
+
+ private:
+  // 计数器到槽位下标的映射。N 是编译期常量，所以 if constexpr 会只保留其中一个分支；
+  // 即使没有这个分支，编译器通常也会把 % N 优化成按位与，这里写出来是为了明确意图。
+  static constexpr size_t Slot(size_t counter) {
+    if constexpr ((N & (N - 1)) == 0) {
+      return counter & (N - 1);
+    } else {
+      return counter % N;
+    }
+  }
+
+  InlineStorage<T, N> storage_;
+  size_t head_{0};
+  size_t tail_{0};
+};
+
+// 在编译期使用两个容器：平凡类型的所有操作都是 constexpr 的。
+constexpr int SumFirstSquares(int n) {
+  static_vector<int, 16> squares;
+  for (int i = 1; i <= n; i++) {
+    squares.push_back(i * i);
+  }
+  static_vector<int, 16> moved = std::move(squares);
+  int sum = 0;
+  for (int v : moved) {
+    sum += v;
+  }
+  return sum;
+}
+
+constexpr int RingLastAfterWrap() {
+  ring_buffer<int, 4> ring;
+  for (int i = 0; i < 10; i++) {
+    if (ring.full()) {
+      ring.pop_front();
+    }
+    ring.push_back(i);
+  }
+  return ring.front() * 100 + ring.back();
+}
+
+static_assert(SumFirstSquares(4) == 30);
+static_assert(RingLastAfterWrap() == 609);
+
+// 只能移动的元素：static_vector 可以按值返回。
+static_vector<std::unique_ptr<int>, 4> MakeOwners() {
+  static_vector<std::unique_ptr<int>, 4> owners;
+  owners.push_back(std::make_unique<int>(445));
+  owners.push_back(std::make_unique<int>(645));
+  return owners;
+}
+
+// 保存每次测量的结果，防止编译器把循环优化掉。
+volatile uint64_t benchmark_sink = 0;
+
+double NanosPerOp(std::chrono::steady_clock::time_point start, size_t ops) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ops;
+}
+
+// 反复往一个小向量里放 kBatch 个元素再清空，模拟“收集一批行号”的热路径。
+// fill_and_clear 接收批号，返回一个结果（用于 benchmark_sink）。
+template <typename Fn>
+void BenchBatches(const char *name, size_t rounds, Fn fill_and_clear) {
+  auto start = std::chrono::steady_clock::now();
+  uint64_t sink = 0;
+  for (size_t r = 0; r < rounds; r++) {
+    sink += fill_and_clear(r);
+  }
+  benchmark_sink = benchmark_sink + sink;
+  std::cout << "  " << name << ": " << NanosPerOp(start, rounds) << " ns per batch\n";
+}
+
+// 稳态的先进先出队列：队列中始终保持 kDepth 个元素，每步入队一个、出队一个。
+template <typename Queue>
+void BenchQueue(const char *name, Queue &queue, size_t ops, size_t depth) {
+  for (size_t i = 0; i < depth; i++) {
+    queue.push_back(i);
+  }
+  auto start = std::chrono::steady_clock::now();
+  uint64_t sink = 0;
+  for (size_t i = 0; i < ops; i++) {
+    queue.push_back(i);
+    sink += queue.front();
+    queue.pop_front();
+  }
+  benchmark_sink = benchmark_sink + sink;
+  std::cout << "  " << name << ": " << NanosPerOp(start, ops) << " ns per push+pop\n";
+}
+
+// 用法：./static_vector [操作次数]
+int main(int argc, char *argv[]) {
+  size_t ops = argc > 1 ? std::stoul(argv[1]) : 20'000'000;
+
+  // 第一部分：容量是类型的一部分，这与 Bar<150> 中的 150 一样是编译期常量。
+  static_vector<std::string, 4> names;
+  names.push_back("andy");
+  names.push_back("jignesh");
+  std::cout << "static_vector<std::string, 4>: size " << names.size() << ", capacity " << names.capacity()
+            << ", back " << names.back() << ", sizeof " << sizeof(names) << std::endl;
+  names.push_back("spam");
+  names.push_back("eggs");
+  try {
+    names.push_back("full");
+  } catch (const std::length_error &e) {
+    std::cout << "Pushing a fifth name throws: " << e.what() << std::endl;
+  }
+  static_vector<std::string, 4> moved_names = std::move(names);
+  auto owners = MakeOwners();
+  std::cout << "After moving, the source has " << names.size() << " names and the target has "
+            << moved_names.size() << "; returned " << owners.size() << " unique_ptrs, back " << *owners.back()
+            << std::endl;
+  std::cout << "Computed at compile time: SumFirstSquares(4) = " << SumFirstSquares(4)
+            << ", RingLastAfterWrap() = " << RingLastAfterWrap() << std::endl;
+
+  // 第二部分：小批次的 push_back/clear。
+  constexpr size_t kBatch = 32;
+  size_t rounds = ops / kBatch;
+  std::cout << "Filling and clearing batches of " << kBatch << " elements\n";
+  BenchBatches("std::vector (new per batch)", rounds, [](size_t r) {
+    std::vector<uint32_t> batch;
+    for (size_t i = 0; i < kBatch; i++) {
+      batch.push_back(static_cast<uint32_t>(r + i));
+    }
+    return batch.back();
+  });
+  std::vector<uint32_t> reused;
+  BenchBatches("std::vector (reused)      ", rounds, [&](size_t r) {
+    reused.clear();
+    for (size_t i = 0; i < kBatch; i++) {
+      reused.push_back(static_cast<uint32_t>(r + i));
+    }
+    return reused.back();
+  });
+  BenchBatches("static_vector             ", rounds, [](size_t r) {
+    static_vector<uint32_t, kBatch> batch;
+    for (size_t i = 0; i < kBatch; i++) {
+      batch.push_back(static_cast<uint32_t>(r + i));
+    }
+    return batch.back();
+  });
+
+  // 第三部分：稳态 FIFO。1000 不是 2 的幂，只能用取模；1024 可以用按位与。
+  std::cout << "FIFO push+pop with ~1000 queued elements\n";
+  {
+    std::deque<uint64_t> queue;
+    BenchQueue("std::deque              ", queue, ops, 999);
+  }
+  {
+    ring_buffer<uint64_t, 1000> queue;
+    BenchQueue("ring_buffer<1000> (mod) ", queue, ops, 999);
+  }
+  {
+    ring_buffer<uint64_t, 1024> queue;
+    BenchQueue("ring_buffer<1024> (mask)", queue, ops, 999);
+  }
+  return 0;
+}
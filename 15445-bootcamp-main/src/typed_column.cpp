@@ -0,0 +1,523 @@
+/**
+ * @file typed_column.cpp
+ * @brief 按元素类型特化的列容器 Column<T> 的教学示例：空值位图、对齐的分块存储，以及
+ *        float/double、bool、std::string 的特化实现。
+ */
+
+// templated_classes.cpp 中的 Foo<T> 只保存一个值，FooSpecial<float> 展示了如何为某个类型提供特化。
+// 在列式数据库中，一列数据可以看作 Foo<T> 的“数组版本”。如果直接用 std::vector<std::optional<T>> 表示
+// 一列可能为 NULL 的数据，会有几个问题：
+// 1. 每个 std::optional<T> 都带一个 bool 标记，并按 T 对齐，int64 列每个元素要占 16 字节。
+// 2. 值与空标记交错存放，聚合时读入缓存的数据有一半是标记。
+// 3. std::vector<std::optional<bool>> 每个元素占 2 字节，而一个 bool 其实只需要 1 位。
+// 4. std::optional<std::string> 每个元素是一个独立的 std::string，长字符串各自在堆上分配。
+
+// Column<T> 使用与 Apache Arrow 类似的布局：
+// - 定长类型：值存放在 64 字节对齐的固定大小块（chunk）中，空值单独用位图表示（每行 1 位）。
+//   分块使得追加数据时不需要搬移已有数据，对齐便于 SIMD 加载。
+// - float/double 特化：浮点加法不满足结合律，编译器不能擅自把逐个累加改写成多路并行累加，
+//   所以特化版本显式使用多个独立的累加器，使求和可以向量化。
+// - bool 特化：值也按位打包，计数用 popcount 指令一次处理 64 行。
+// - std::string 特化：所有字符串的字节连续存放在一个缓冲区中，另用一个偏移数组记录每个字符串的起止位置。
+// 参考：https://arrow.apache.org/docs/format/Columnar.html
+
+// 包含 std::min。
+#include <algorithm>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 std::int64_t 等定宽整数类型。
+#include <cstdint>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::unique_ptr。
+#include <memory>
+// 包含 std::optional。
+#include <optional>
+// 包含 std::string（元素类型之一，也用于解析命令行参数）。
+#include <string>
+// 包含 std::string_view。
+#include <string_view>
+// 包含 std::is_arithmetic_v 等类型萃取。
+#include <type_traits>
+// 包含 std::vector。
+#include <vector>
+
+// 每个块保存的行数。取 64 的倍数，使每个块的位图正好由整数个 64 位字组成。
+constexpr size_t kChunkRows = 4096;
+constexpr size_t kChunkWords = kChunkRows / 64;
+
+inline bool TestBit(const uint64_t *words, size_t i) { return (words[i / 64] >> (i % 64)) & 1; }
+inline void SetBit(uint64_t *words, size_t i) { words[i / 64] |= uint64_t{1} << (i % 64); }
+
+// 定长类型列的公共部分：分块存储、空值位图、追加与按行读取、过滤。
+// 具体的 Column<T> 继承它，并提供适合该类型的聚合实现。
+template <typename T>
+class FixedWidthColumn {
+  static_assert(std::is_arithmetic_v<T>, "FixedWidthColumn only holds fixed-width arithmetic types");
+
+ public:
+  // 聚合结果的类型：整数求和用 int64_t 以免溢出，浮点数用 double。
+  using SumType = std::conditional_t<std::is_integral_v<T>, int64_t, double>;
+
+  void Append(T value) {
+    Chunk &chunk = NextSlot();
+    chunk.values_[size_ % kChunkRows] = value;
+    SetBit(chunk.validity_, size_ % kChunkRows);
+    size_ += 1;
+  }
+
+  void AppendNull() {
+    Chunk &chunk = NextSlot();
+    chunk.values_[size_ % kChunkRows] = T{};
+    size_ += 1;
+  }
+
+  size_t size() const { return size_; }
+
+  bool IsNull(size_t row) const { return !TestBit(chunks_[row / kChunkRows]->validity_, row % kChunkRows); }
+
+  std::optional<T> Get(size_t row) const {
+    if (IsNull(row)) {
+      return std::nullopt;
+    }
+    return chunks_[row / kChunkRows]->values_[row % kChunkRows];
+  }
+
+  // 返回所有非 NULL 且满足 pred 的行号（选择向量）。
+  template <typename Pred>
+  std::vector<uint32_t> Filter(Pred pred) const {
+    std::vector<uint32_t> selection;
+    ForEachChunk([&](const Chunk &chunk, size_t base, size_t rows) {
+      for (size_t i = 0; i < rows; i++) {
+        if (TestBit(chunk.validity_, i) && pred(chunk.values_[i])) {
+          selection.push_back(static_cast<uint32_t>(base + i));
+        }
+      }
+    });
+    return selection;
+  }
+
+  // 非 NULL 的行数。按 64 行一组对位图做 popcount。
+  size_t CountNonNull() const {
+    size_t count = 0;
+    ForEachChunk([&](const Chunk &chunk, size_t, size_t rows) {
+      for (size_t w = 0; w < (rows + 63) / 64; w++) {
+        count += __builtin_popcountll(chunk.validity_[w]);
+      }
+    });
+    return count;
+  }
+
+  // 占用的字节数（只统计块本身）。
+  size_t MemoryBytes() const { return chunks_.size() * sizeof(Chunk); }
+
+ protected:
+  // 一个块：对齐到缓存行的值数组，以及对应的位图。用 new 分配时会遵守 alignas（C++17 起）。
+  struct alignas(64) Chunk {
+    T values_[kChunkRows];
+    uint64_t validity_[kChunkWords] = {};
+  };
+
+  // 依次访问每个块，fn(chunk, 块内第一行的行号, 块内有效行数)。
+  template <typename Fn>
+  void ForEachChunk(Fn fn) const {
+    for (size_t c = 0; c < chunks_.size(); c++) {
+      size_t base = c * kChunkRows;
+      fn(*chunks_[c], base, std::min(kChunkRows, size_ - base));
+    }
+  }
+
+ private:
+  Chunk &NextSlot() {
+    if (size_ % kChunkRows == 0) {
+      chunks_.push_back(std::make_unique<Chunk>());
+    }
+    return *chunks_.back();
+  }
+
+  std::vector<std::unique_ptr<Chunk>> chunks_;
+  size_t size_{0};
+};
+
+// 通用的定长类型列。整数加法满足结合律，编译器可以自行把这个循环向量化。
+// 空值通过“无效行当作 0”参与求和，避免在循环中出现分支。
+template <typename T>
+class Column : public FixedWidthColumn<T> {
+ public:
+  using typename FixedWidthColumn<T>::SumType;
+
+  SumType Sum() const {
+    SumType sum = 0;
+    this->ForEachChunk([&](const auto &chunk, size_t, size_t rows) {
+      for (size_t i = 0; i < rows; i++) {
+        sum += TestBit(chunk.validity_, i) ? static_cast<SumType>(chunk.values_[i]) : 0;
+      }
+    });
+    return sum;
+  }
+};
+
+// float 与 double 共用的实现：kLanes 个独立的累加器。同一个 lane 上的加法仍然按顺序进行，
+// 但不同 lane 之间没有依赖，编译器可以把它们放进一个向量寄存器。
+// 注意：这改变了加法的结合顺序，结果可能与逐个相加在最后几位上不同。
+template <typename T>
+class FloatingColumn : public FixedWidthColumn<T> {
+ public:
+  double Sum() const {
+    constexpr size_t kLanes = 64 / sizeof(T);
+    T acc[kLanes] = {};
+    double tail = 0;
+    this->ForEachChunk([&](const auto &chunk, size_t, size_t rows) {
+      size_t i = 0;
+      for (; i + kLanes <= rows; i += kLanes) {
+        // kLanes 整除 64，所以这一组行的有效位都在同一个 64 位字中。
+        uint64_t bits = chunk.validity_[i / 64] >> (i % 64);
+        for (size_t lane = 0; lane < kLanes; lane++) {
+          acc[lane] += ((bits >> lane) & 1) ? chunk.values_[i + lane] : T{0};
+        }
+      }
+      for (; i < rows; i++) {
+        tail += TestBit(chunk.validity_, i) ? chunk.values_[i] : T{0};
+      }
+    });
+    double sum = tail;
+    for (size_t lane = 0; lane < kLanes; lane++) {
+      sum += acc[lane];
+    }
+    return sum;
+  }
+};
+
+// 针对 float 与 double 的特化，与 templated_classes.cpp 中的 FooSpecial<float> 写法相同。
+template <>
+class Column<float> : public FloatingColumn<float> {};
+
+template <>
+class Column<double> : public FloatingColumn<double> {};
+
+// bool 特化：值按位打包，每 64 行只占一个 uint64_t。
+template <>
+class Column<bool> {
+ public:
+  void Append(bool value) {
+    Grow();
+    if (value) {
+      SetBit(values_.data(), size_);
+    }
+    SetBit(validity_.data(), size_);
+    size_ += 1;
+  }
+
+  void AppendNull() {
+    Grow();
+    size_ += 1;
+  }
+
+  size_t size() const { return size_; }
+  bool IsNull(size_t row) const { return !TestBit(validity_.data(), row); }
+
+  std::optional<bool> Get(size_t row) const {
+    if (IsNull(row)) {
+      return std::nullopt;
+    }
+    return TestBit(values_.data(), row);
+  }
+
+  // 非 NULL 且为 true 的行数：值位图与有效位图按位与，再 popcount，一次处理 64 行。
+  size_t CountTrue() const {
+    size_t count = 0;
+    for (size_t w = 0; w < values_.size(); w++) {
+      count += __builtin_popcountll(values_[w] & validity_[w]);
+    }
+    return count;
+  }
+
+  // 返回所有非 NULL 且值等于 value 的行号。逐字处理，只访问被置位的行。
+  std::vector<uint32_t> Filter(bool value) const {
+    std::vector<uint32_t> selection;
+    for (size_t w = 0; w < values_.size(); w++) {
+      uint64_t bits = (value ? values_[w] : ~values_[w]) & validity_[w];
+      while (bits != 0) {
+        selection.push_back(static_cast<uint32_t>(w * 64 + __builtin_ctzll(bits)));
+        bits &= bits - 1;
+      }
+    }
+    return selection;
+  }
+
+  size_t MemoryBytes() const { return (values_.capacity() + validity_.capacity()) * sizeof(uint64_t); }
+
+ private:
+  void Grow() {
+    if (size_ % 64 == 0) {
+      values_.push_back(0);
+      validity_.push_back(0);
+    }
+  }
+
+  std::vector<uint64_t> values_;
+  std::vector<uint64_t> validity_;
+  size_t size_{0};
+};
+
+// std::string 特化：字节连续存放在 bytes_ 中，第 i 个字符串是 bytes_[offsets_[i], offsets_[i + 1])。
+// NULL 行的长度为 0。读取返回 std::string_view，不产生拷贝。
+template <>
+class Column<std::string> {
+ public:
+  Column() { offsets_.push_back(0); }
+
+  void Append(std::string_view value) {
+    bytes_.insert(bytes_.end(), value.begin(), value.end());
+    offsets_.push_back(bytes_.size());
+    if (size_ % 64 == 0) {
+      validity_.push_back(0);
+    }
+    SetBit(validity_.data(), size_);
+    size_ += 1;
+  }
+
+  void AppendNull() {
+    offsets_.push_back(bytes_.size());
+    if (size_ % 64 == 0) {
+      validity_.push_back(0);
+    }
+    size_ += 1;
+  }
+
+  size_t size() const { return size_; }
+  bool IsNull(size_t row) const { return !TestBit(validity_.data(), row); }
+
+  std::optional<std::string_view> Get(size_t row) const {
+    if (IsNull(row)) {
+      return std::nullopt;
+    }
+    return View(row);
+  }
+
+  // 返回所有非 NULL 且满足 pred(std::string_view) 的行号。
+  template <typename Pred>
+  std::vector<uint32_t> Filter(Pred pred) const {
+    std::vector<uint32_t> selection;
+    for (size_t row = 0; row < size_; row++) {
+      if (TestBit(validity_.data(), row) && pred(View(row))) {
+        selection.push_back(static_cast<uint32_t>(row));
+      }
+    }
+    return selection;
+  }
+
+  // 所有非 NULL 字符串的总长度。只需读偏移数组，完全不用访问字节缓冲区。
+  size_t TotalLength() const { return offsets_.back(); }
+
+  size_t MemoryBytes() const {
+    return bytes_.capacity() + offsets_.capacity() * sizeof(uint64_t) + validity_.capacity() * sizeof(uint64_t);
+  }
+
+ private:
+  std::string_view View(size_t row) const {
+    return std::string_view(bytes_.data() + offsets_[row], offsets_[row + 1] - offsets_[row]);
+  }
+
+  std::vector<char> bytes_;
+  std::vector<uint64_t> offsets_;
+  std::vector<uint64_t> validity_;
+  size_t size_{0};
+};
+
+// 保存聚合结果，防止编译器把计算优化掉。
+volatile double benchmark_sink = 0;
+
+double MillisSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 运行 fn 若干次，返回每次的平均毫秒数。
+template <typename Fn>
+double TimeIt(Fn fn) {
+  const int reps = 5;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < reps; r++) {
+    benchmark_sink = benchmark_sink + static_cast<double>(fn());
+  }
+  return MillisSince(start) / reps;
+}
+
+void Report(const char *what, double column_ms, double optional_ms) {
+  std::cout << "  " << what << ": Column " << column_ms << " ms, vector<optional> " << optional_ms << " ms, speedup "
+            << optional_ms / column_ms << "\n";
+}
+
+// 用同一个伪随机序列生成数据，约 1/10 的行为 NULL。
+struct Rng {
+  uint64_t state_ = 42;
+  uint64_t Next() {
+    state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+    return state_ >> 16;
+  }
+};
+
+// 定长类型（int64 与 double）的求和与过滤对比。
+template <typename T>
+void BenchNumeric(const char *name, size_t n) {
+  Column<T> column;
+  std::vector<std::optional<T>> baseline;
+  Rng rng;
+  for (size_t i = 0; i < n; i++) {
+    uint64_t r = rng.Next();
+    if (r % 10 == 0) {
+      column.AppendNull();
+      baseline.emplace_back(std::nullopt);
+    } else {
+      T value = static_cast<T>(r % 1000);
+      column.Append(value);
+      baseline.emplace_back(value);
+    }
+  }
+  std::cout << name << ": " << column.MemoryBytes() / 1e6 << " MB vs " << baseline.size() * sizeof(std::optional<T>) / 1e6
+            << " MB\n";
+
+  double column_ms = TimeIt([&] { return column.Sum(); });
+  double optional_ms = TimeIt([&] {
+    typename Column<T>::SumType sum = 0;
+    for (const auto &v : baseline) {
+      sum += v.has_value() ? *v : 0;
+    }
+    return sum;
+  });
+  Report("sum          ", column_ms, optional_ms);
+
+  column_ms = TimeIt([&] { return column.Filter([](T v) { return v > 900; }).size(); });
+  optional_ms = TimeIt([&] {
+    std::vector<uint32_t> selection;
+    for (size_t i = 0; i < baseline.size(); i++) {
+      if (baseline[i].has_value() && *baseline[i] > 900) {
+        selection.push_back(static_cast<uint32_t>(i));
+      }
+    }
+    return selection.size();
+  });
+  Report("filter v>900 ", column_ms, optional_ms);
+}
+
+void BenchBool(size_t n) {
+  Column<bool> column;
+  std::vector<std::optional<bool>> baseline;
+  Rng rng;
+  for (size_t i = 0; i < n; i++) {
+    uint64_t r = rng.Next();
+    if (r % 10 == 0) {
+      column.AppendNull();
+      baseline.emplace_back(std::nullopt);
+    } else {
+      column.Append(r % 3 == 0);
+      baseline.emplace_back(r % 3 == 0);
+    }
+  }
+  std::cout << "bool: " << column.MemoryBytes() / 1e6 << " MB vs "
+            << baseline.size() * sizeof(std::optional<bool>) / 1e6 << " MB\n";
+
+  double column_ms = TimeIt([&] { return column.CountTrue(); });
+  double optional_ms = TimeIt([&] {
+    size_t count = 0;
+    for (const auto &v : baseline) {
+      count += v.value_or(false);
+    }
+    return count;
+  });
+  Report("count true   ", column_ms, optional_ms);
+
+  column_ms = TimeIt([&] { return column.Filter(true).size(); });
+  optional_ms = TimeIt([&] {
+    std::vector<uint32_t> selection;
+    for (size_t i = 0; i < baseline.size(); i++) {
+      if (baseline[i].value_or(false)) {
+        selection.push_back(static_cast<uint32_t>(i));
+      }
+    }
+    return selection.size();
+  });
+  Report("filter true  ", column_ms, optional_ms);
+}
+
+void BenchString(size_t n) {
+  Column<std::string> column;
+  std::vector<std::optional<std::string>> baseline;
+  Rng rng;
+  for (size_t i = 0; i < n; i++) {
+    uint64_t r = rng.Next();
+    if (r % 10 == 0) {
+      column.AppendNull();
+      baseline.emplace_back(std::nullopt);
+    } else {
+      // 长度在 4 到 35 之间的字符串，一部分超过短字符串优化（SSO）的长度，需要单独的堆分配。
+      std::string value = (r % 4 == 0 ? "spam-" : "eggs-") + std::string(r % 32, 'x');
+      column.Append(value);
+      baseline.emplace_back(std::move(value));
+    }
+  }
+  size_t baseline_bytes = baseline.size() * sizeof(std::optional<std::string>);
+  for (const auto &v : baseline) {
+    baseline_bytes += (v.has_value() && v->capacity() > 15) ? v->capacity() + 1 : 0;
+  }
+  std::cout << "string: " << column.MemoryBytes() / 1e6 << " MB vs " << baseline_bytes / 1e6 << " MB\n";
+
+  double column_ms = TimeIt([&] { return column.TotalLength(); });
+  double optional_ms = TimeIt([&] {
+    size_t total = 0;
+    for (const auto &v : baseline) {
+      total += v.has_value() ? v->size() : 0;
+    }
+    return total;
+  });
+  Report("total length ", column_ms, optional_ms);
+
+  column_ms = TimeIt([&] { return column.Filter([](std::string_view s) { return s.substr(0, 5) == "spam-"; }).size(); });
+  optional_ms = TimeIt([&] {
+    std::vector<uint32_t> selection;
+    for (size_t i = 0; i < baseline.size(); i++) {
+      if (baseline[i].has_value() && std::string_view(*baseline[i]).substr(0, 5) == "spam-") {
+        selection.push_back(static_cast<uint32_t>(i));
+      }
+    }
+    return selection.size();
+  });
+  Report("filter prefix", column_ms, optional_ms);
+}
+
+// 用法：./typed_column [行数]
+int main(int argc, char *argv[]) {
+  size_t n = argc > 1 ? std::stoul(argv[1]) : 4'000'000;
+
+  // 第一部分：不同元素类型使用不同的特化，但接口相似。
+  Column<int> ints;
+  ints.Append(445);
+  ints.AppendNull();
+  ints.Append(645);
+  std::cout << "Column<int> sum: " << ints.Sum() << ", row 1 is null: " << ints.IsNull(1) << std::endl;
+
+  Column<float> floats;
+  floats.Append(1.5f);
+  floats.Append(2.5f);
+  std::cout << "Column<float> sum: " << floats.Sum() << std::endl;
+
+  Column<bool> bools;
+  bools.Append(true);
+  bools.AppendNull();
+  bools.Append(false);
+  bools.Append(true);
+  std::cout << "Column<bool> count true: " << bools.CountTrue() << std::endl;
+
+  Column<std::string> strings;
+  strings.Append("andy");
+  strings.AppendNull();
+  strings.Append("jignesh");
+  std::cout << "Column<std::string> row 2: " << *strings.Get(2) << std::endl;
+
+  // 第二部分：每种特化的聚合与过滤，与 std::vector<std::optional<T>> 对比。
+  BenchNumeric<int64_t>("int64", n);
+  BenchNumeric<double>("double", n);
+  BenchBool(n);
+  BenchString(n);
+  return 0;
+}
@@ -0,0 +1,787 @@
+/**
+ * @file vectorized_execution.cpp
+ * @brief 向量化（vectorized）查询执行引擎：算子之间传递固定大小的列式批次与选择向量，
+ *        与每次 Next() 只返回一个元组的火山（Volcano）模型在相同的查询计划上对比。
+ */
+
+// 15-445 中的执行器采用迭代器模型（火山模型）：每个算子实现 Init() 与 Next()，
+// 每次 Next() 从子算子拉取一个元组，处理后返回给父算子。这种模型简单、通用，但每处理一个元组，
+// 每个算子都要经过一次虚函数调用，表达式树的每个节点也要经过一次虚函数调用，
+// 这些开销远远大于真正的计算（例如一次整数比较）。
+// 向量化模型（MonetDB/X100，Boncz 等，CIDR 2005）保留了拉取式的迭代器接口，但每次 Next()
+// 返回一个批次（Batch），其中每一列是一段连续的数组（最多 kBatchSize 行）：
+// - 虚函数调用的开销被一个批次中的所有行分摊；
+// - 表达式在整列上用紧凑的循环计算，编译器可以自动向量化（见 simd_kernels.cpp）；
+// - Filter 不移动数据，只生成一个选择向量（selection vector），记录批次中哪些行仍然有效，
+//   之后的算子只处理选择向量中的行。选择向量用无分支的方式生成，不受选择率影响。
+// 表达式在批次上计算时忽略选择向量，对所有行计算：连续的紧凑循环通常比按选择向量逐行访问更快，
+// 而多算的行随后会被选择向量排除。
+// 批次中的列指针直接指向表中的数据（零拷贝），只有 Project 计算出来的新列才需要缓冲区。
+
+// 查询的数据是 vectors.cpp 中的 Point（x、y 两列）与 move_constructors.cpp 中的 Person（age，
+// 加上一个表示所在城市的 city 列），所有列都是 int64_t。两种引擎扫描同一份列式存储，
+// 区别只在于执行模型，所以对比的正是每个元组一次 Next() 与每个批次一次 Next() 的差别。
+
+// 包含 std::sort。
+#include <algorithm>
+// 包含 std::array（元组的存储）。
+#include <array>
+// 包含 std::chrono（用于计时）。
+#include <chrono>
+// 包含 std::exit。
+#include <cstdlib>
+// 包含 std::cout（用于演示输出）。
+#include <iostream>
+// 包含 std::numeric_limits。
+#include <limits>
+// 包含 std::unique_ptr。
+#include <memory>
+// 包含 std::mt19937_64（用于生成数据）。
+#include <random>
+// 包含 std::invalid_argument。
+#include <stdexcept>
+// 包含 std::string。
+#include <string>
+// 包含 std::unordered_map（哈希聚合）。
+#include <unordered_map>
+// 包含 std::move。
+#include <utility>
+// 包含 std::vector。
+#include <vector>
+
+constexpr size_t kBatchSize = 1024;
+constexpr size_t kMaxColumns = 4;
+
+// 列式存储的表。
+struct Table {
+  std::vector<std::vector<int64_t>> columns_;
+  size_t rows_{0};
+};
+
+// 火山模型中的一个元组：定长数组，避免每个元组一次堆分配。
+struct Tuple {
+  std::array<int64_t, kMaxColumns> values_;
+  size_t size_{0};
+};
+
+// 向量化模型中的一个批次。columns_[c][i] 是第 i 行第 c 列的值（0 <= i < count_）。
+// has_selection_ 为 true 时只有 selection_[0..selection_count_) 中的行是有效的。
+struct Batch {
+  size_t count_{0};
+  std::vector<const int64_t *> columns_;
+  // Project 计算出的列存放在这里，columns_ 指向它们。
+  std::vector<std::vector<int64_t>> owned_;
+  bool has_selection_{false};
+  size_t selection_count_{0};
+  uint16_t selection_[kBatchSize];
+
+  size_t ActiveCount() const { return has_selection_ ? selection_count_ : count_; }
+
+  // 对每个有效行的下标调用 fn(i)。有没有选择向量的两种情况各自是一个紧凑的循环。
+  template <typename Fn>
+  void ForEachActive(Fn &&fn) const {
+    if (has_selection_) {
+      for (size_t k = 0; k < selection_count_; k++) {
+        fn(selection_[k]);
+      }
+    } else {
+      for (size_t i = 0; i < count_; i++) {
+        fn(i);
+      }
+    }
+  }
+};
+
+enum class ExprType { kColumn, kConstant, kAdd, kSub, kMul, kLess, kGreater, kLessEqual, kGreaterEqual, kAnd };
+
+// 表达式树。Evaluate 用于火山模型（每个元组调用一次），EvaluateBatch 用于向量化模型（每个批次调用一次），
+// 返回指向 count_ 个结果的指针：列表达式直接返回批次中的列，其余表达式写入自己的缓冲区。
+class Expression {
+ public:
+  virtual ~Expression() = default;
+  virtual int64_t Evaluate(const Tuple &tuple) const = 0;
+  virtual const int64_t *EvaluateBatch(const Batch &batch) const = 0;
+};
+
+class ColumnExpression : public Expression {
+ public:
+  explicit ColumnExpression(size_t column) : column_(column) {}
+  int64_t Evaluate(const Tuple &tuple) const override { return tuple.values_[column_]; }
+  const int64_t *EvaluateBatch(const Batch &batch) const override { return batch.columns_[column_]; }
+
+ private:
+  size_t column_;
+};
+
+class ConstantExpression : public Expression {
+ public:
+  explicit ConstantExpression(int64_t value) : value_(value), buffer_(kBatchSize, value) {}
+  int64_t Evaluate(const Tuple &) const override { return value_; }
+  const int64_t *EvaluateBatch(const Batch &) const override { return buffer_.data(); }
+
+ private:
+  int64_t value_;
+  std::vector<int64_t> buffer_;
+};
+
+class BinaryExpression : public Expression {
+ public:
+  BinaryExpression(ExprType type, std::unique_ptr<Expression> left, std::unique_ptr<Expression> right)
+      : type_(type), left_(std::move(left)), right_(std::move(right)), buffer_(kBatchSize) {}
+
+  int64_t Evaluate(const Tuple &tuple) const override {
+    return Apply(type_, left_->Evaluate(tuple), right_->Evaluate(tuple));
+  }
+
+  // 先计算两个子表达式，再用一个按运算类型特化的紧凑循环计算整个批次。
+  const int64_t *EvaluateBatch(const Batch &batch) const override {
+    const int64_t *left = left_->EvaluateBatch(batch);
+    const int64_t *right = right_->EvaluateBatch(batch);
+    int64_t *out = buffer_.data();
+    switch (type_) {
+      case ExprType::kAdd:
+        return Loop(batch.count_, left, right, out, [](int64_t a, int64_t b) { return a + b; });
+      case ExprType::kSub:
+        return Loop(batch.count_, left, right, out, [](int64_t a, int64_t b) { return a - b; });
+      case ExprType::kMul:
+        return Loop(batch.count_, left, right, out, [](int64_t a, int64_t b) { return a * b; });
+      case ExprType::kLess:
+        return Loop(batch.count_, left, right, out, [](int64_t a, int64_t b) -> int64_t { return a < b; });
+      case ExprType::kGreater:
+        return Loop(batch.count_, left, right, out, [](int64_t a, int64_t b) -> int64_t { return a > b; });
+      case ExprType::kLessEqual:
+        return Loop(batch.count_, left, right, out, [](int64_t a, int64_t b) -> int64_t { return a <= b; });
+      case ExprType::kGreaterEqual:
+        return Loop(batch.count_, left, right, out, [](int64_t a, int64_t b) -> int64_t { return a >= b; });
+      case ExprType::kAnd:
+        return Loop(batch.count_, left, right, out, [](int64_t a, int64_t b) -> int64_t { return (a & b) != 0; });
+      default:
+        throw std::invalid_argument("not a binary expression");
+    }
+  }
+
+ private:
+  static int64_t Apply(ExprType type, int64_t a, int64_t b) {
+    switch (type) {
+      case ExprType::kAdd:
+        return a + b;
+      case ExprType::kSub:
+        return a - b;
+      case ExprType::kMul:
+        return a * b;
+      case ExprType::kLess:
+        return a < b;
+      case ExprType::kGreater:
+        return a > b;
+      case ExprType::kLessEqual:
+        return a <= b;
+      case ExprType::kGreaterEqual:
+        return a >= b;
+      case ExprType::kAnd:
+        return (a & b) != 0;
+      default:
+        throw std::invalid_argument("not a binary expression");
+    }
+  }
+
+  template <typename Op>
+  static const int64_t *Loop(size_t n, const int64_t *left, const int64_t *right, int64_t *out, Op op) {
+    for (size_t i = 0; i < n; i++) {
+      out[i] = op(left[i], right[i]);
+    }
+    return out;
+  }
+
+  ExprType type_;
+  std::unique_ptr<Expression> left_;
+  std::unique_ptr<Expression> right_;
+  mutable std::vector<int64_t> buffer_;
+};
+
+// 构造表达式的辅助函数。
+std::unique_ptr<Expression> Col(size_t column) { return std::make_unique<ColumnExpression>(column); }
+std::unique_ptr<Expression> Const(int64_t value) { return std::make_unique<ConstantExpression>(value); }
+std::unique_ptr<Expression> Op(ExprType type, std::unique_ptr<Expression> left, std::unique_ptr<Expression> right) {
+  return std::make_unique<BinaryExpression>(type, std::move(left), std::move(right));
+}
+
+enum class AggregateType { kCount, kSum, kMin, kMax };
+
+struct AggregateSpec {
+  AggregateType type_;
+  // kCount 不使用表达式，可以为 nullptr。
+  std::unique_ptr<Expression> expr_;
+};
+
+int64_t InitialValue(AggregateType type) {
+  switch (type) {
+    case AggregateType::kMin:
+      return std::numeric_limits<int64_t>::max();
+    case AggregateType::kMax:
+      return std::numeric_limits<int64_t>::min();
+    default:
+      return 0;
+  }
+}
+
+// ============================== 火山模型 ==============================
+
+class TupleOperator {
+ public:
+  virtual ~TupleOperator() = default;
+  virtual void Init() = 0;
+  virtual bool Next(Tuple *tuple) = 0;
+};
+
+class TupleScan : public TupleOperator {
+ public:
+  explicit TupleScan(const Table *table) : table_(table) {}
+  void Init() override { cursor_ = 0; }
+  bool Next(Tuple *tuple) override {
+    if (cursor_ == table_->rows_) {
+      return false;
+    }
+    tuple->size_ = table_->columns_.size();
+    for (size_t c = 0; c < tuple->size_; c++) {
+      tuple->values_[c] = table_->columns_[c][cursor_];
+    }
+    cursor_++;
+    return true;
+  }
+
+ private:
+  const Table *table_;
+  size_t cursor_{0};
+};
+
+class TupleFilter : public TupleOperator {
+ public:
+  TupleFilter(std::unique_ptr<TupleOperator> child, std::unique_ptr<Expression> predicate)
+      : child_(std::move(child)), predicate_(std::move(predicate)) {}
+  void Init() override { child_->Init(); }
+  bool Next(Tuple *tuple) override {
+    while (child_->Next(tuple)) {
+      if (predicate_->Evaluate(*tuple) != 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  std::unique_ptr<TupleOperator> child_;
+  std::unique_ptr<Expression> predicate_;
+};
+
+class TupleProject : public TupleOperator {
+ public:
+  TupleProject(std::unique_ptr<TupleOperator> child, std::vector<std::unique_ptr<Expression>> exprs)
+      : child_(std::move(child)), exprs_(std::move(exprs)) {}
+  void Init() override { child_->Init(); }
+  bool Next(Tuple *tuple) override {
+    Tuple input;
+    if (!child_->Next(&input)) {
+      return false;
+    }
+    tuple->size_ = exprs_.size();
+    for (size_t c = 0; c < exprs_.size(); c++) {
+      tuple->values_[c] = exprs_[c]->Evaluate(input);
+    }
+    return true;
+  }
+
+ private:
+  std::unique_ptr<TupleOperator> child_;
+  std::vector<std::unique_ptr<Expression>> exprs_;
+};
+
+// 哈希聚合：Init 时消费子算子的全部输出。group_by 为 nullptr 时只有一个分组。
+// 输出的每个元组是 [分组键,] 聚合值...
+class TupleAggregate : public TupleOperator {
+ public:
+  TupleAggregate(std::unique_ptr<TupleOperator> child, std::unique_ptr<Expression> group_by,
+                 std::vector<AggregateSpec> aggregates)
+      : child_(std::move(child)), group_by_(std::move(group_by)), aggregates_(std::move(aggregates)) {}
+
+  void Init() override {
+    child_->Init();
+    groups_.clear();
+    keys_.clear();
+    values_.clear();
+    Tuple tuple;
+    while (child_->Next(&tuple)) {
+      int64_t key = group_by_ == nullptr ? 0 : group_by_->Evaluate(tuple);
+      auto [it, inserted] = groups_.try_emplace(key, keys_.size());
+      if (inserted) {
+        keys_.push_back(key);
+        for (auto &aggregate : aggregates_) {
+          values_.push_back(InitialValue(aggregate.type_));
+        }
+      }
+      int64_t *acc = &values_[it->second * aggregates_.size()];
+      for (size_t a = 0; a < aggregates_.size(); a++) {
+        switch (aggregates_[a].type_) {
+          case AggregateType::kCount:
+            acc[a] += 1;
+            break;
+          case AggregateType::kSum:
+            acc[a] += aggregates_[a].expr_->Evaluate(tuple);
+            break;
+          case AggregateType::kMin:
+            acc[a] = std::min(acc[a], aggregates_[a].expr_->Evaluate(tuple));
+            break;
+          case AggregateType::kMax:
+            acc[a] = std::max(acc[a], aggregates_[a].expr_->Evaluate(tuple));
+            break;
+        }
+      }
+    }
+    cursor_ = 0;
+  }
+
+  bool Next(Tuple *tuple) override {
+    if (cursor_ == keys_.size()) {
+      return false;
+    }
+    tuple->size_ = 0;
+    if (group_by_ != nullptr) {
+      tuple->values_[tuple->size_++] = keys_[cursor_];
+    }
+    for (size_t a = 0; a < aggregates_.size(); a++) {
+      tuple->values_[tuple->size_++] = values_[cursor_ * aggregates_.size() + a];
+    }
+    cursor_++;
+    return true;
+  }
+
+ private:
+  std::unique_ptr<TupleOperator> child_;
+  std::unique_ptr<Expression> group_by_;
+  std::vector<AggregateSpec> aggregates_;
+  std::unordered_map<int64_t, size_t> groups_;
+  std::vector<int64_t> keys_;
+  std::vector<int64_t> values_;
+  size_t cursor_{0};
+};
+
+class TupleLimit : public TupleOperator {
+ public:
+  TupleLimit(std::unique_ptr<TupleOperator> child, size_t limit) : child_(std::move(child)), limit_(limit) {}
+  void Init() override {
+    child_->Init();
+    emitted_ = 0;
+  }
+  bool Next(Tuple *tuple) override {
+    if (emitted_ == limit_ || !child_->Next(tuple)) {
+      return false;
+    }
+    emitted_++;
+    return true;
+  }
+
+ private:
+  std::unique_ptr<TupleOperator> child_;
+  size_t limit_;
+  size_t emitted_{0};
+};
+
+// ============================== 向量化模型 ==============================
+
+class VectorOperator {
+ public:
+  virtual ~VectorOperator() = default;
+  virtual void Init() = 0;
+  // 返回下一个非空的批次，没有更多数据时返回 false。
+  virtual bool Next(Batch *batch) = 0;
+};
+
+// 扫描：批次的列直接指向表中的数据。
+class VectorScan : public VectorOperator {
+ public:
+  explicit VectorScan(const Table *table) : table_(table) {}
+  void Init() override { cursor_ = 0; }
+  bool Next(Batch *batch) override {
+    if (cursor_ == table_->rows_) {
+      return false;
+    }
+    batch->count_ = std::min(kBatchSize, table_->rows_ - cursor_);
+    batch->columns_.resize(table_->columns_.size());
+    for (size_t c = 0; c < table_->columns_.size(); c++) {
+      batch->columns_[c] = table_->columns_[c].data() + cursor_;
+    }
+    batch->has_selection_ = false;
+    cursor_ += batch->count_;
+    return true;
+  }
+
+ private:
+  const Table *table_;
+  size_t cursor_{0};
+};
+
+// 过滤：在整个批次上计算谓词，再无分支地收集有效行：每一行都写入选择向量，
+// 但只有谓词为真时才前移写入位置。
+class VectorFilter : public VectorOperator {
+ public:
+  VectorFilter(std::unique_ptr<VectorOperator> child, std::unique_ptr<Expression> predicate)
+      : child_(std::move(child)), predicate_(std::move(predicate)) {}
+  void Init() override { child_->Init(); }
+  bool Next(Batch *batch) override {
+    while (child_->Next(batch)) {
+      const int64_t *keep = predicate_->EvaluateBatch(*batch);
+      size_t count = 0;
+      uint16_t *selection = batch->selection_;
+      batch->ForEachActive([&](size_t i) {
+        selection[count] = static_cast<uint16_t>(i);
+        count += keep[i] != 0;
+      });
+      batch->has_selection_ = true;
+      batch->selection_count_ = count;
+      if (count > 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  std::unique_ptr<VectorOperator> child_;
+  std::unique_ptr<Expression> predicate_;
+};
+
+// 投影：对每个表达式计算出一列，选择向量原样传递。
+class VectorProject : public VectorOperator {
+ public:
+  VectorProject(std::unique_ptr<VectorOperator> child, std::vector<std::unique_ptr<Expression>> exprs)
+      : child_(std::move(child)), exprs_(std::move(exprs)) {}
+  void Init() override { child_->Init(); }
+  bool Next(Batch *batch) override {
+    if (!child_->Next(&input_)) {
+      return false;
+    }
+    batch->count_ = input_.count_;
+    batch->owned_.resize(exprs_.size());
+    batch->columns_.resize(exprs_.size());
+    for (size_t c = 0; c < exprs_.size(); c++) {
+      const int64_t *values = exprs_[c]->EvaluateBatch(input_);
+      batch->owned_[c].assign(values, values + input_.count_);
+      batch->columns_[c] = batch->owned_[c].data();
+    }
+    batch->has_selection_ = input_.has_selection_;
+    batch->selection_count_ = input_.selection_count_;
+    if (input_.has_selection_) {
+      std::copy(input_.selection_, input_.selection_ + input_.selection_count_, batch->selection_);
+    }
+    return true;
+  }
+
+ private:
+  std::unique_ptr<VectorOperator> child_;
+  std::vector<std::unique_ptr<Expression>> exprs_;
+  Batch input_;
+};
+
+// 哈希聚合：每个批次先为所有有效行求出分组编号，再对每个聚合函数各用一个循环更新累加值，
+// 而不是每一行依次更新所有聚合函数。
+class VectorAggregate : public VectorOperator {
+ public:
+  VectorAggregate(std::unique_ptr<VectorOperator> child, std::unique_ptr<Expression> group_by,
+                  std::vector<AggregateSpec> aggregates)
+      : child_(std::move(child)), group_by_(std::move(group_by)), aggregates_(std::move(aggregates)) {}
+
+  void Init() override {
+    child_->Init();
+    groups_.clear();
+    keys_.clear();
+    values_.assign(aggregates_.size(), {});
+    Batch batch;
+    std::vector<uint32_t> group_ids(kBatchSize, 0);
+    while (child_->Next(&batch)) {
+      if (group_by_ == nullptr) {
+        if (keys_.empty()) {
+          AddGroup(0);
+        }
+      } else {
+        const int64_t *keys = group_by_->EvaluateBatch(batch);
+        batch.ForEachActive([&](size_t i) {
+          auto it = groups_.find(keys[i]);
+          group_ids[i] = static_cast<uint32_t>(it != groups_.end() ? it->second : AddGroup(keys[i]));
+        });
+      }
+      for (size_t a = 0; a < aggregates_.size(); a++) {
+        int64_t *acc = values_[a].data();
+        const uint32_t *gid = group_ids.data();
+        if (aggregates_[a].type_ == AggregateType::kCount) {
+          batch.ForEachActive([&](size_t i) { acc[gid[i]] += 1; });
+          continue;
+        }
+        const int64_t *v = aggregates_[a].expr_->EvaluateBatch(batch);
+        switch (aggregates_[a].type_) {
+          case AggregateType::kSum:
+            batch.ForEachActive([&](size_t i) { acc[gid[i]] += v[i]; });
+            break;
+          case AggregateType::kMin:
+            batch.ForEachActive([&](size_t i) { acc[gid[i]] = std::min(acc[gid[i]], v[i]); });
+            break;
+          case AggregateType::kMax:
+            batch.ForEachActive([&](size_t i) { acc[gid[i]] = std::max(acc[gid[i]], v[i]); });
+            break;
+          case AggregateType::kCount:
+            break;
+        }
+      }
+    }
+    cursor_ = 0;
+  }
+
+  bool Next(Batch *batch) override {
+    if (cursor_ == keys_.size()) {
+      return false;
+    }
+    size_t n = std::min(kBatchSize, keys_.size() - cursor_);
+    size_t columns = aggregates_.size() + (group_by_ != nullptr ? 1 : 0);
+    batch->count_ = n;
+    batch->owned_.resize(columns);
+    batch->columns_.resize(columns);
+    size_t c = 0;
+    if (group_by_ != nullptr) {
+      batch->owned_[c++].assign(keys_.begin() + cursor_, keys_.begin() + cursor_ + n);
+    }
+    for (auto &values : values_) {
+      batch->owned_[c++].assign(values.begin() + cursor_, values.begin() + cursor_ + n);
+    }
+    for (c = 0; c < columns; c++) {
+      batch->columns_[c] = batch->owned_[c].data();
+    }
+    batch->has_selection_ = false;
+    cursor_ += n;
+    return true;
+  }
+
+ private:
+  size_t AddGroup(int64_t key) {
+    size_t id = keys_.size();
+    groups_.emplace(key, id);
+    keys_.push_back(key);
+    for (size_t a = 0; a < aggregates_.size(); a++) {
+      values_[a].push_back(InitialValue(aggregates_[a].type_));
+    }
+    return id;
+  }
+
+  std::unique_ptr<VectorOperator> child_;
+  std::unique_ptr<Expression> group_by_;
+  std::vector<AggregateSpec> aggregates_;
+  std::unordered_map<int64_t, size_t> groups_;
+  std::vector<int64_t> keys_;
+  // values_[a][g] 是第 g 个分组的第 a 个聚合值（按聚合函数分列存放）。
+  std::vector<std::vector<int64_t>> values_;
+  size_t cursor_{0};
+};
+
+// LIMIT：截断选择向量。达到上限之后不再向子算子拉取数据。
+class VectorLimit : public VectorOperator {
+ public:
+  VectorLimit(std::unique_ptr<VectorOperator> child, size_t limit) : child_(std::move(child)), limit_(limit) {}
+  void Init() override {
+    child_->Init();
+    emitted_ = 0;
+  }
+  bool Next(Batch *batch) override {
+    if (emitted_ == limit_ || !child_->Next(batch)) {
+      return false;
+    }
+    size_t remaining = limit_ - emitted_;
+    if (batch->ActiveCount() > remaining) {
+      if (!batch->has_selection_) {
+        for (size_t i = 0; i < remaining; i++) {
+          batch->selection_[i] = static_cast<uint16_t>(i);
+        }
+        batch->has_selection_ = true;
+      }
+      batch->selection_count_ = remaining;
+    }
+    emitted_ += batch->ActiveCount();
+    return true;
+  }
+
+ private:
+  std::unique_ptr<VectorOperator> child_;
+  size_t limit_;
+  size_t emitted_{0};
+};
+
+// ============================== 查询计划 ==============================
+
+// 每个查询计划用同一个函数描述，分别实例化为两种引擎的算子。
+struct TupleEngine {
+  using Operator = TupleOperator;
+  using Scan = TupleScan;
+  using Filter = TupleFilter;
+  using Project = TupleProject;
+  using Aggregate = TupleAggregate;
+  using Limit = TupleLimit;
+};
+
+struct VectorEngine {
+  using Operator = VectorOperator;
+  using Scan = VectorScan;
+  using Filter = VectorFilter;
+  using Project = VectorProject;
+  using Aggregate = VectorAggregate;
+  using Limit = VectorLimit;
+};
+
+std::vector<AggregateSpec> Aggregates(std::vector<std::pair<AggregateType, std::unique_ptr<Expression>>> specs) {
+  std::vector<AggregateSpec> result;
+  for (auto &[type, expr] : specs) {
+    result.push_back(AggregateSpec{type, std::move(expr)});
+  }
+  return result;
+}
+
+// Q1：SELECT SUM(x * x + y * y), COUNT(*) FROM points WHERE x < y
+template <typename E>
+std::unique_ptr<typename E::Operator> PointsDistancePlan(const Table *points) {
+  auto scan = std::make_unique<typename E::Scan>(points);
+  auto filter = std::make_unique<typename E::Filter>(std::move(scan), Op(ExprType::kLess, Col(0), Col(1)));
+  std::vector<std::unique_ptr<Expression>> exprs;
+  exprs.push_back(Op(ExprType::kAdd, Op(ExprType::kMul, Col(0), Col(0)), Op(ExprType::kMul, Col(1), Col(1))));
+  auto project = std::make_unique<typename E::Project>(std::move(filter), std::move(exprs));
+  std::vector<std::pair<AggregateType, std::unique_ptr<Expression>>> specs;
+  specs.emplace_back(AggregateType::kSum, Col(0));
+  specs.emplace_back(AggregateType::kCount, nullptr);
+  return std::make_unique<typename E::Aggregate>(std::move(project), nullptr, Aggregates(std::move(specs)));
+}
+
+// Q2：SELECT city, COUNT(*), SUM(age), MAX(age) FROM people WHERE age >= 18 GROUP BY city
+template <typename E>
+std::unique_ptr<typename E::Operator> PeopleByCityPlan(const Table *people) {
+  auto scan = std::make_unique<typename E::Scan>(people);
+  auto filter =
+      std::make_unique<typename E::Filter>(std::move(scan), Op(ExprType::kGreaterEqual, Col(0), Const(18)));
+  std::vector<std::pair<AggregateType, std::unique_ptr<Expression>>> specs;
+  specs.emplace_back(AggregateType::kCount, nullptr);
+  specs.emplace_back(AggregateType::kSum, Col(0));
+  specs.emplace_back(AggregateType::kMax, Col(0));
+  return std::make_unique<typename E::Aggregate>(std::move(filter), Col(1), Aggregates(std::move(specs)));
+}
+
+// Q3：SELECT x + y, x - y FROM points WHERE x > 5000 AND y <= 100 LIMIT limit
+template <typename E>
+std::unique_ptr<typename E::Operator> PointsLimitPlan(const Table *points, size_t limit) {
+  auto scan = std::make_unique<typename E::Scan>(points);
+  auto filter = std::make_unique<typename E::Filter>(
+      std::move(scan), Op(ExprType::kAnd, Op(ExprType::kGreater, Col(0), Const(5000)),
+                          Op(ExprType::kLessEqual, Col(1), Const(100))));
+  std::vector<std::unique_ptr<Expression>> exprs;
+  exprs.push_back(Op(ExprType::kAdd, Col(0), Col(1)));
+  exprs.push_back(Op(ExprType::kSub, Col(0), Col(1)));
+  auto project = std::make_unique<typename E::Project>(std::move(filter), std::move(exprs));
+  return std::make_unique<typename E::Limit>(std::move(project), limit);
+}
+
+using Rows = std::vector<std::vector<int64_t>>;
+
+Rows Drain(TupleOperator *root) {
+  Rows rows;
+  Tuple tuple;
+  root->Init();
+  while (root->Next(&tuple)) {
+    rows.emplace_back(tuple.values_.begin(), tuple.values_.begin() + tuple.size_);
+  }
+  return rows;
+}
+
+Rows Drain(VectorOperator *root) {
+  Rows rows;
+  Batch batch;
+  root->Init();
+  while (root->Next(&batch)) {
+    batch.ForEachActive([&](size_t i) {
+      std::vector<int64_t> row;
+      for (auto *column : batch.columns_) {
+        row.push_back(column[i]);
+      }
+      rows.push_back(std::move(row));
+    });
+  }
+  return rows;
+}
+
+void Check(bool condition, const char *what) {
+  if (!condition) {
+    std::cout << "CHECK FAILED: " << what << std::endl;
+    std::exit(1);
+  }
+}
+
+// Point 表：x、y 在 [0, 10000) 中均匀分布。
+Table MakePoints(size_t rows) {
+  std::mt19937_64 rng(42);
+  Table table{{std::vector<int64_t>(rows), std::vector<int64_t>(rows)}, rows};
+  for (size_t i = 0; i < rows; i++) {
+    table.columns_[0][i] = static_cast<int64_t>(rng() % 10000);
+    table.columns_[1][i] = static_cast<int64_t>(rng() % 10000);
+  }
+  return table;
+}
+
+// Person 表：age 在 [0, 100) 中，city 在 [0, cities) 中。
+Table MakePeople(size_t rows, size_t cities) {
+  std::mt19937_64 rng(7);
+  Table table{{std::vector<int64_t>(rows), std::vector<int64_t>(rows)}, rows};
+  for (size_t i = 0; i < rows; i++) {
+    table.columns_[0][i] = static_cast<int64_t>(rng() % 100);
+    table.columns_[1][i] = static_cast<int64_t>(rng() % cities);
+  }
+  return table;
+}
+
+// 两种引擎执行同一个计划，检查结果相同（聚合结果按分组键排序后比较），输出每秒处理的输入行数。
+template <typename MakePlan>
+void BenchPlan(const char *name, size_t input_rows, MakePlan make_plan, int repeats) {
+  auto tuple_plan = make_plan(TupleEngine{});
+  auto vector_plan = make_plan(VectorEngine{});
+  Rows expected;
+  Rows actual;
+  double seconds[2];
+  for (int engine = 0; engine < 2; engine++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+      if (engine == 0) {
+        expected = Drain(tuple_plan.get());
+      } else {
+        actual = Drain(vector_plan.get());
+      }
+    }
+    seconds[engine] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeats;
+  }
+  std::sort(expected.begin(), expected.end());
+  std::sort(actual.begin(), actual.end());
+  Check(expected == actual, "both engines produce the same result");
+  std::cout << name << " (" << expected.size() << " result rows)\n"
+            << "  tuple-at-a-time: " << input_rows / seconds[0] / 1e6 << " M rows/s\n"
+            << "  vectorized:      " << input_rows / seconds[1] / 1e6 << " M rows/s (" << seconds[0] / seconds[1]
+            << "x)\n";
+}
+
+// 用法：./vectorized_execution [行数]
+int main(int argc, char *argv[]) {
+  size_t rows = argc > 1 ? std::stoul(argv[1]) : 2'000'000;
+  Table points = MakePoints(rows);
+  Table people = MakePeople(rows, 100);
+
+  BenchPlan(
+      "Q1: SELECT SUM(x*x + y*y), COUNT(*) FROM points WHERE x < y", rows,
+      [&](auto engine) { return PointsDistancePlan<decltype(engine)>(&points); }, 3);
+  BenchPlan(
+      "Q2: SELECT city, COUNT(*), SUM(age), MAX(age) FROM people WHERE age >= 18 GROUP BY city", rows,
+      [&](auto engine) { return PeopleByCityPlan<decltype(engine)>(&people); }, 3);
+  // LIMIT 让执行提前结束，所以这里按实际扫描到的行数（大约 limit / 选择率）计算吞吐量。
+  const size_t limit = 1000;
+  BenchPlan(
+      "Q3: SELECT x + y, x - y FROM points WHERE x > 5000 AND y <= 100 LIMIT 1000", limit * 200,
+      [&](auto engine) { return PointsLimitPlan<decltype(engine)>(&points, limit); }, 20);
+  return 0;
+}